@@ -0,0 +1,823 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "protocol.h"
+#include "binary_protocol.h"
+#include "client_protocol.h"
+#include "histogram.h"
+
+// Gerador de carga: N conexões distribuídas entre M threads, cada thread
+// com seu epoll. Cada conexão mantém até --pipeline comandos em voo,
+// sorteados conforme o --mix. Ao final compara o placar do servidor com os
+// votos confirmados.
+
+#define MAX_PIPELINE 256
+#define IN_BUFFER (64 * 1024)
+#define OUT_BUFFER (64 * 1024)
+#define DRAIN_TIMEOUT_NS (5 * 1000000000ULL)
+
+typedef enum {
+    CMD_HELLO_ID,
+    CMD_LIST_ID,
+    CMD_VOTE_ID,
+    CMD_SCORE_ID,
+    BENCH_COMMANDS
+} BenchCommand;
+
+static const char *command_names[BENCH_COMMANDS] = {"HELLO", "LIST", "VOTE", "SCORE"};
+
+typedef struct {
+    const char *host;
+    int port;
+    int connections;
+    int threads;
+    double duration_s;
+    int pipeline;
+    int weights[BENCH_COMMANDS];
+    bool binary;
+    int num_options;
+    unsigned run_id;
+    char **roll_ids;            // --roll: VOTER_IDs dos HELLO, em ordem (NULL: gerados)
+    size_t roll_count;
+    _Atomic size_t roll_next;
+} BenchConfig;
+
+// Comando em voo: as respostas chegam na ordem dos pedidos
+typedef struct {
+    uint8_t command;
+    uint8_t option;
+    uint64_t sent_ns;
+} Pending;
+
+typedef struct {
+    int fd;
+    int index;              // número global da conexão (gera os VOTER_IDs)
+    bool dead;
+    bool voted;             // o votante atual já votou
+    bool want_write;
+    uint64_t voter_seq;
+
+    char in[IN_BUFFER];
+    size_t in_len;
+    char out[OUT_BUFFER];
+    size_t out_len;
+    size_t out_sent;
+
+    Pending queue[MAX_PIPELINE + 1];
+    int head;
+    int count;
+} BenchConn;
+
+typedef struct {
+    int id;
+    int epoll_fd;
+    BenchConfig *config;
+    BenchConn *conns;
+    int num_conns;
+    unsigned seed;
+
+    Histogram hist[BENCH_COMMANDS];
+    uint64_t errors[BENCH_COMMANDS];
+    uint64_t votes[MAX_OPTIONS];        // votos confirmados por opção
+    uint64_t unknown[MAX_OPTIONS];      // votos enviados sem resposta (conexão caiu ou prazo)
+    uint64_t dead_connections;
+
+    uint64_t start_ns;
+    uint64_t end_ns;
+    pthread_t thread;
+} BenchThread;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int connect_server(const BenchConfig *config) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config->port);
+    if (inet_pton(AF_INET, config->host, &addr.sin_addr) <= 0) {
+        if (strcmp(config->host, "localhost") != 0) {
+            fprintf(stderr, "Endereço inválido: %s\n", config->host);
+            exit(1);
+        }
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// ---- Conexão de controle (bloqueante, protocolo de texto) ----
+
+static bool control_command(int fd, const char *command, char *line, size_t size) {
+    if (send(fd, command, strlen(command), 0) < 0) {
+        return false;
+    }
+    size_t len = 0;
+    while (len + 1 < size) {
+        ssize_t n = recv(fd, line + len, 1, 0);
+        if (n <= 0) {
+            return false;
+        }
+        if (line[len] == '\n') {
+            break;
+        }
+        len++;
+    }
+    line[len] = '\0';
+    return true;
+}
+
+// Lê o placar atual e o total de syscalls de E/S do servidor (io_syscalls
+// do ADMIN STATS; 0 se o servidor não tiver). Retorna o número de opções
+// ou -1.
+static int read_score(const BenchConfig *config, uint64_t *counts, bool *final, uint64_t *syscalls) {
+    int fd = connect_server(config);
+    if (fd < 0) {
+        return -1;
+    }
+    char line[MAX_BUFFER];
+    char names[MAX_OPTIONS][MAX_OPTION_NAME];
+    char hello[64];
+    // ADMIN não depende do cadastro de eleitores do servidor
+    snprintf(hello, sizeof(hello), "HELLO ADMIN\n");
+
+    int k = -1;
+    if (control_command(fd, hello, line, sizeof(line)) &&
+        control_command(fd, "SCORE\n", line, sizeof(line))) {
+        k = parse_score(line, names, counts, final);
+    }
+    *syscalls = 0;
+    if (k >= 0 && control_command(fd, "ADMIN STATS\n", line, sizeof(line))) {
+        const char *field = strstr(line, " io_syscalls=");
+        if (field != NULL) {
+            *syscalls = strtoull(field + strlen(" io_syscalls="), NULL, 10);
+        }
+    }
+    close(fd);
+    return k;
+}
+
+// ---- Geração de comandos ----
+
+// Próximo VOTER_ID do --roll (recomeça do início quando acaba)
+static const char *next_roll_id(BenchConfig *config) {
+    size_t i = atomic_fetch_add_explicit(&config->roll_next, 1, memory_order_relaxed);
+    return config->roll_ids[i % config->roll_count];
+}
+
+static void encode_hello(BenchThread *thread, BenchConn *conn) {
+    conn->voter_seq++;
+    conn->voted = false;
+    const char *roll_id = thread->config->roll_ids ? next_roll_id(thread->config) : NULL;
+    if (thread->config->binary) {
+        uint8_t *p = (uint8_t *)conn->out + conn->out_len;
+        uint64_t id = ((uint64_t)thread->config->run_id << 40) | ((uint64_t)conn->index << 24) | conn->voter_seq;
+        if (roll_id != NULL) {
+            id = strtoull(roll_id, NULL, 10);
+        }
+        p[BIN_HEADER_SIZE] = BIN_VERSION;
+        bin_put_u64(p + BIN_HEADER_SIZE + 1, id);
+        bin_put_header(p, BIN_HELLO, 0, 9);
+        conn->out_len += BIN_HEADER_SIZE + 9;
+    } else if (roll_id != NULL) {
+        conn->out_len += sprintf(conn->out + conn->out_len, "HELLO %s\n", roll_id);
+    } else {
+        conn->out_len += sprintf(conn->out + conn->out_len, "HELLO bench%u_%d_%llu\n",
+                                 thread->config->run_id, conn->index, (unsigned long long)conn->voter_seq);
+    }
+}
+
+static void encode_simple(BenchThread *thread, BenchConn *conn, BenchCommand command, int option) {
+    if (thread->config->binary) {
+        uint8_t *p = (uint8_t *)conn->out + conn->out_len;
+        if (command == CMD_VOTE_ID) {
+            size_t len = bin_put_varint(p + BIN_HEADER_SIZE, option);
+            bin_put_header(p, BIN_VOTE, 0, (uint16_t)len);
+            conn->out_len += BIN_HEADER_SIZE + len;
+        } else {
+            bin_put_header(p, command == CMD_LIST_ID ? BIN_LIST : BIN_SCORE, 0, 0);
+            conn->out_len += BIN_HEADER_SIZE;
+        }
+    } else if (command == CMD_VOTE_ID) {
+        conn->out_len += sprintf(conn->out + conn->out_len, "VOTE %d\n", option + 1);
+    } else {
+        conn->out_len += sprintf(conn->out + conn->out_len, "%s\n",
+                                 command == CMD_LIST_ID ? CMD_LIST : CMD_SCORE);
+    }
+}
+
+static void push_pending(BenchConn *conn, BenchCommand command, int option, uint64_t now) {
+    Pending *pending = &conn->queue[(conn->head + conn->count) % (MAX_PIPELINE + 1)];
+    pending->command = command;
+    pending->option = option;
+    pending->sent_ns = now;
+    conn->count++;
+}
+
+static BenchCommand pick_command(BenchThread *thread) {
+    const int *weights = thread->config->weights;
+    int total = 0;
+    for (int i = 0; i < BENCH_COMMANDS; i++) {
+        total += weights[i];
+    }
+    int r = rand_r(&thread->seed) % total;
+    for (int i = 0; i < BENCH_COMMANDS; i++) {
+        if (r < weights[i]) {
+            return i;
+        }
+        r -= weights[i];
+    }
+    return CMD_SCORE_ID;
+}
+
+// Completa a janela de comandos em voo da conexão
+static void refill(BenchThread *thread, BenchConn *conn) {
+    uint64_t now = now_ns();
+
+    // Compacta o que já foi enviado para abrir espaço no buffer
+    if (conn->out_sent > 0) {
+        memmove(conn->out, conn->out + conn->out_sent, conn->out_len - conn->out_sent);
+        conn->out_len -= conn->out_sent;
+        conn->out_sent = 0;
+    }
+
+    while (conn->count < thread->config->pipeline && conn->out_len + 512 < OUT_BUFFER) {
+        BenchCommand command = conn->voter_seq == 0 ? CMD_HELLO_ID : pick_command(thread);
+
+        if (command == CMD_VOTE_ID) {
+            // Cada votante vota uma vez: troca de votante antes de votar de novo
+            if (conn->voted) {
+                encode_hello(thread, conn);
+                push_pending(conn, CMD_HELLO_ID, 0, now);
+            }
+            int option = rand_r(&thread->seed) % thread->config->num_options;
+            encode_simple(thread, conn, CMD_VOTE_ID, option);
+            push_pending(conn, CMD_VOTE_ID, option, now);
+            conn->voted = true;
+        } else if (command == CMD_HELLO_ID) {
+            encode_hello(thread, conn);
+            push_pending(conn, CMD_HELLO_ID, 0, now);
+        } else {
+            encode_simple(thread, conn, command, 0);
+            push_pending(conn, command, 0, now);
+        }
+    }
+}
+
+static void set_write_interest(BenchThread *thread, BenchConn *conn, bool want_write) {
+    if (conn->want_write == want_write) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (want_write ? EPOLLOUT : 0);
+    ev.data.ptr = conn;
+    epoll_ctl(thread->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+    conn->want_write = want_write;
+}
+
+// Desiste dos comandos em voo: o servidor pode ter gravado os VOTE
+// mesmo sem a resposta chegar
+static void abandon_pending(BenchThread *thread, BenchConn *conn) {
+    for (; conn->count > 0; conn->count--) {
+        Pending *pending = &conn->queue[conn->head];
+        if (pending->command == CMD_VOTE_ID) {
+            thread->unknown[pending->option]++;
+        }
+        conn->head = (conn->head + 1) % (MAX_PIPELINE + 1);
+    }
+}
+
+static void kill_connection(BenchThread *thread, BenchConn *conn) {
+    if (conn->dead) {
+        return;
+    }
+    epoll_ctl(thread->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->dead = true;
+    abandon_pending(thread, conn);
+    thread->dead_connections++;
+}
+
+static void flush(BenchThread *thread, BenchConn *conn) {
+    while (conn->out_sent < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + conn->out_sent, conn->out_len - conn->out_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            kill_connection(thread, conn);
+            return;
+        }
+        conn->out_sent += n;
+    }
+    set_write_interest(thread, conn, conn->out_sent < conn->out_len);
+}
+
+// ---- Respostas ----
+
+static bool response_ok(BenchCommand command, const char *line) {
+    switch (command) {
+    case CMD_HELLO_ID:
+        return strncmp(line, RESP_WELCOME, strlen(RESP_WELCOME)) == 0;
+    case CMD_LIST_ID:
+        return strncmp(line, RESP_OPTIONS, strlen(RESP_OPTIONS)) == 0;
+    case CMD_VOTE_ID:
+        return strncmp(line, RESP_OK_VOTED, strlen(RESP_OK_VOTED)) == 0;
+    default:
+        return strncmp(line, RESP_SCORE, strlen(RESP_SCORE)) == 0 ||
+               strncmp(line, RESP_CLOSED, strlen(RESP_CLOSED)) == 0;
+    }
+}
+
+static bool frame_ok(BenchCommand command, uint8_t type) {
+    static const uint8_t expected[BENCH_COMMANDS] = {BIN_WELCOME, BIN_OPTIONS, BIN_VOTED, BIN_SCORE_RESP};
+    return type == expected[command];
+}
+
+static void complete(BenchThread *thread, BenchConn *conn, bool ok, uint64_t now) {
+    Pending *pending = &conn->queue[conn->head];
+    conn->head = (conn->head + 1) % (MAX_PIPELINE + 1);
+    conn->count--;
+
+    histogram_record(&thread->hist[pending->command], now - pending->sent_ns);
+    if (!ok) {
+        thread->errors[pending->command]++;
+    } else if (pending->command == CMD_VOTE_ID) {
+        thread->votes[pending->option]++;
+    }
+}
+
+// Consome as respostas completas do buffer de entrada
+static void parse_responses(BenchThread *thread, BenchConn *conn) {
+    uint64_t now = now_ns();
+    size_t start = 0;
+
+    while (conn->count > 0) {
+        char *data = conn->in + start;
+        size_t available = conn->in_len - start;
+        BenchCommand command = conn->queue[conn->head].command;
+
+        if (thread->config->binary) {
+            if (available < BIN_HEADER_SIZE) {
+                break;
+            }
+            size_t frame_len = BIN_HEADER_SIZE + bin_get_u16((uint8_t *)data + 2);
+            if (available < frame_len) {
+                break;
+            }
+            complete(thread, conn, frame_ok(command, (uint8_t)data[0]), now);
+            start += frame_len;
+        } else {
+            char *newline = memchr(data, '\n', available);
+            if (newline == NULL) {
+                break;
+            }
+            *newline = '\0';
+            complete(thread, conn, response_ok(command, data), now);
+            start = newline - conn->in + 1;
+        }
+    }
+
+    memmove(conn->in, conn->in + start, conn->in_len - start);
+    conn->in_len -= start;
+}
+
+static void handle_input(BenchThread *thread, BenchConn *conn) {
+    while (1) {
+        size_t requested = IN_BUFFER - conn->in_len;
+        ssize_t n = recv(conn->fd, conn->in + conn->in_len, requested, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+        }
+        if (n <= 0) {
+            kill_connection(thread, conn);
+            return;
+        }
+        conn->in_len += n;
+        parse_responses(thread, conn);
+        if ((size_t)n < requested) {
+            break;
+        }
+    }
+}
+
+static int outstanding(BenchThread *thread) {
+    int total = 0;
+    for (int i = 0; i < thread->num_conns; i++) {
+        total += thread->conns[i].count;
+    }
+    return total;
+}
+
+static void *bench_thread(void *arg) {
+    BenchThread *thread = (BenchThread *)arg;
+    struct epoll_event events[256];
+    uint64_t deadline = thread->start_ns + (uint64_t)(thread->config->duration_s * 1e9);
+    bool stopping = false;
+
+    for (int i = 0; i < thread->num_conns; i++) {
+        refill(thread, &thread->conns[i]);
+        flush(thread, &thread->conns[i]);
+    }
+
+    while (1) {
+        uint64_t now = now_ns();
+        if (!stopping && now >= deadline) {
+            stopping = true;
+        }
+        // Depois do prazo só espera as respostas que faltam
+        if (stopping && (outstanding(thread) == 0 || now >= deadline + DRAIN_TIMEOUT_NS)) {
+            break;
+        }
+
+        int n = epoll_wait(thread->epoll_fd, events, 256, 50);
+        for (int i = 0; i < n; i++) {
+            BenchConn *conn = events[i].data.ptr;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                handle_input(thread, conn);
+            }
+            if (conn->dead) {
+                continue;
+            }
+            if (!stopping) {
+                refill(thread, conn);
+            }
+            flush(thread, conn);
+        }
+    }
+
+    thread->end_ns = now_ns();
+    for (int i = 0; i < thread->num_conns; i++) {
+        if (!thread->conns[i].dead) {
+            abandon_pending(thread, &thread->conns[i]);
+            close(thread->conns[i].fd);
+        }
+    }
+    return NULL;
+}
+
+// ---- Configuração ----
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Uso: %s [opções] <servidor> <porta>\n", prog);
+    fprintf(stderr, "  --connections <n>  Conexões simultâneas (padrão: 100)\n");
+    fprintf(stderr, "  --threads <n>      Threads com epoll próprio (padrão: um por núcleo)\n");
+    fprintf(stderr, "  --duration <s>     Duração da medição em segundos (padrão: 10)\n");
+    fprintf(stderr, "  --pipeline <n>     Comandos em voo por conexão (padrão: 1, máx: %d)\n", MAX_PIPELINE);
+    fprintf(stderr, "  --mix <pesos>      Pesos dos comandos, ex.: vote=6,score=3,list=1,hello=0\n");
+    fprintf(stderr, "  --binary           Usa o protocolo binário\n");
+    fprintf(stderr, "  --roll <arquivo>   VOTER_IDs dos HELLO, um por linha (no binário, numéricos)\n");
+}
+
+static void parse_mix(const char *text, int *weights) {
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", text);
+    memset(weights, 0, sizeof(int) * BENCH_COMMANDS);
+
+    int total = 0;
+    for (char *item = strtok(copy, ","); item != NULL; item = strtok(NULL, ",")) {
+        char *eq = strchr(item, '=');
+        if (eq == NULL) {
+            fprintf(stderr, "Mix inválido: %s\n", item);
+            exit(1);
+        }
+        *eq = '\0';
+        int found = -1;
+        for (int i = 0; i < BENCH_COMMANDS; i++) {
+            if (strcasecmp(item, command_names[i]) == 0) {
+                found = i;
+            }
+        }
+        if (found < 0) {
+            fprintf(stderr, "Comando desconhecido no mix: %s\n", item);
+            exit(1);
+        }
+        weights[found] = atoi(eq + 1);
+        total += weights[found];
+    }
+    if (total <= 0) {
+        fprintf(stderr, "Mix sem nenhum comando\n");
+        exit(1);
+    }
+}
+
+// Lê os VOTER_IDs do arquivo (mesmo formato do --roll do servidor: linhas
+// vazias e iniciadas por # são ignoradas)
+static void load_roll(BenchConfig *config, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Erro ao abrir cadastro de eleitores");
+        exit(1);
+    }
+    size_t capacity = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char voter_id[MAX_VOTER_ID];
+        if (sscanf(line, "%63s", voter_id) != 1 || voter_id[0] == '#') {
+            continue;
+        }
+        if (config->binary && strspn(voter_id, "0123456789") != strlen(voter_id)) {
+            fprintf(stderr, "VOTER_ID não numérico no protocolo binário: %s\n", voter_id);
+            exit(1);
+        }
+        if (config->roll_count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            config->roll_ids = realloc(config->roll_ids, capacity * sizeof(char *));
+        }
+        if (config->roll_ids == NULL ||
+            (config->roll_ids[config->roll_count++] = strdup(voter_id)) == NULL) {
+            perror("Erro ao alocar cadastro de eleitores");
+            exit(1);
+        }
+    }
+    fclose(file);
+    if (config->roll_count == 0) {
+        fprintf(stderr, "Cadastro de eleitores vazio: %s\n", path);
+        exit(1);
+    }
+}
+
+static void parse_args(int argc, char *argv[], BenchConfig *config) {
+    static struct option long_options[] = {
+        {"connections", required_argument, NULL, 'c'},
+        {"threads", required_argument, NULL, 't'},
+        {"duration", required_argument, NULL, 'd'},
+        {"pipeline", required_argument, NULL, 'p'},
+        {"mix", required_argument, NULL, 'm'},
+        {"binary", no_argument, NULL, 'b'},
+        {"roll", required_argument, NULL, 'r'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    memset(config, 0, sizeof(*config));
+    config->connections = 100;
+    config->threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    config->duration_s = 10;
+    config->pipeline = 1;
+    parse_mix("vote=6,score=3,list=1", config->weights);
+    const char *roll_path = NULL;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'c':
+                config->connections = atoi(optarg);
+                break;
+            case 't':
+                config->threads = atoi(optarg);
+                break;
+            case 'd':
+                config->duration_s = atof(optarg);
+                break;
+            case 'p':
+                config->pipeline = atoi(optarg);
+                break;
+            case 'm':
+                parse_mix(optarg, config->weights);
+                break;
+            case 'b':
+                config->binary = true;
+                break;
+            case 'r':
+                roll_path = optarg;
+                break;
+            default:
+                print_usage(argv[0]);
+                exit(1);
+        }
+    }
+
+    if (optind != argc - 2) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+    config->host = argv[optind];
+    config->port = atoi(argv[optind + 1]);
+
+    if (config->connections < 1 || config->pipeline < 1 || config->pipeline > MAX_PIPELINE) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+    if (config->threads < 1) {
+        config->threads = 1;
+    }
+    if (config->threads > config->connections) {
+        config->threads = config->connections;
+    }
+    if (roll_path != NULL) {
+        load_roll(config, roll_path);
+    }
+}
+
+// Retorna o total de comandos respondidos
+static uint64_t print_report(BenchConfig *config, BenchThread *threads, double elapsed) {
+    Histogram merged;
+    uint64_t total = 0;
+    uint64_t total_errors = 0;
+
+    printf("\n%-6s %10s %10s %10s %10s %10s %10s %8s\n",
+           "Cmd", "n", "req/s", "p50(us)", "p99(us)", "p99.9(us)", "máx(us)", "erros");
+    for (int c = 0; c < BENCH_COMMANDS; c++) {
+        uint64_t errors = 0;
+        histogram_reset(&merged);
+        for (int t = 0; t < config->threads; t++) {
+            histogram_merge(&merged, &threads[t].hist[c]);
+            errors += threads[t].errors[c];
+        }
+        uint64_t n = atomic_load(&merged.total);
+        if (n == 0) {
+            continue;
+        }
+        printf("%-6s %10llu %10.0f %10.1f %10.1f %10.1f %10.1f %8llu\n",
+               command_names[c], (unsigned long long)n, n / elapsed,
+               histogram_percentile(&merged, 50) / 1000.0,
+               histogram_percentile(&merged, 99) / 1000.0,
+               histogram_percentile(&merged, 99.9) / 1000.0,
+               atomic_load(&merged.max) / 1000.0,
+               (unsigned long long)errors);
+        total += n;
+        total_errors += errors;
+    }
+    printf("\nTotal: %llu comandos em %.2f s (%.0f req/s), %llu erros\n",
+           (unsigned long long)total, elapsed, total / elapsed, (unsigned long long)total_errors);
+    return total;
+}
+
+int main(int argc, char *argv[]) {
+    BenchConfig config;
+    parse_args(argc, argv, &config);
+    config.run_id = ((unsigned)getpid() ^ (unsigned)time(NULL)) & 0xFFFF;
+
+    // Placar inicial: a verificação compara o aumento com os votos aceitos
+    uint64_t before[MAX_OPTIONS];
+    uint64_t syscalls_before;
+    bool final;
+    config.num_options = read_score(&config, before, &final, &syscalls_before);
+    if (config.num_options <= 0) {
+        fprintf(stderr, "Não foi possível ler o placar do servidor %s:%d\n", config.host, config.port);
+        exit(1);
+    }
+    if (final) {
+        fprintf(stderr, "Aviso: votação encerrada, votos vão retornar ERR CLOSED\n");
+    }
+
+    printf("%d conexões em %d threads, pipeline %d, protocolo %s, %.1f s\n",
+           config.connections, config.threads, config.pipeline,
+           config.binary ? "binário" : "texto", config.duration_s);
+
+    BenchThread *threads = calloc(config.threads, sizeof(BenchThread));
+    BenchConn *conns = calloc(config.connections, sizeof(BenchConn));
+    if (threads == NULL || conns == NULL) {
+        perror("Erro ao alocar conexões");
+        exit(1);
+    }
+
+    // Conexões repartidas entre as threads em blocos contíguos
+    int next = 0;
+    for (int t = 0; t < config.threads; t++) {
+        BenchThread *thread = &threads[t];
+        thread->id = t;
+        thread->config = &config;
+        thread->seed = config.run_id * 7919 + t;
+        thread->conns = &conns[next];
+        thread->num_conns = config.connections / config.threads + (t < config.connections % config.threads);
+        for (int c = 0; c < BENCH_COMMANDS; c++) {
+            histogram_reset(&thread->hist[c]);
+        }
+        thread->epoll_fd = epoll_create1(0);
+        if (thread->epoll_fd < 0) {
+            perror("Erro no epoll_create1");
+            exit(1);
+        }
+
+        for (int i = 0; i < thread->num_conns; i++) {
+            BenchConn *conn = &thread->conns[i];
+            conn->index = next + i;
+            conn->fd = connect_server(&config);
+            if (conn->fd < 0) {
+                perror("Erro ao conectar ao servidor");
+                exit(1);
+            }
+            fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL, 0) | O_NONBLOCK);
+
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.ptr = conn;
+            epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev);
+        }
+        next += thread->num_conns;
+    }
+
+    uint64_t start = now_ns();
+    for (int t = 0; t < config.threads; t++) {
+        threads[t].start_ns = start;
+        if (pthread_create(&threads[t].thread, NULL, bench_thread, &threads[t]) != 0) {
+            perror("Erro ao criar thread");
+            exit(1);
+        }
+    }
+
+    uint64_t end = start;
+    uint64_t dead = 0;
+    uint64_t sent_votes[MAX_OPTIONS] = {0};
+    uint64_t unknown_votes[MAX_OPTIONS] = {0};
+    for (int t = 0; t < config.threads; t++) {
+        pthread_join(threads[t].thread, NULL);
+        close(threads[t].epoll_fd);
+        if (threads[t].end_ns > end) {
+            end = threads[t].end_ns;
+        }
+        dead += threads[t].dead_connections;
+        for (int i = 0; i < config.num_options; i++) {
+            sent_votes[i] += threads[t].votes[i];
+            unknown_votes[i] += threads[t].unknown[i];
+        }
+    }
+
+    uint64_t commands = print_report(&config, threads, (end - start) / 1e9);
+    if (dead > 0) {
+        printf("Conexões perdidas: %llu\n", (unsigned long long)dead);
+    }
+
+    // Verificação: o placar deve ter aumentado os votos aceitos, mais no
+    // máximo os que ficaram sem resposta (o servidor pode tê-los gravado)
+    uint64_t after[MAX_OPTIONS];
+    uint64_t syscalls_after;
+    int status = 0;
+    if (read_score(&config, after, &final, &syscalls_after) != config.num_options) {
+        printf("Verificação: não foi possível ler o placar final\n");
+        status = 1;
+    } else {
+        uint64_t accepted = 0;
+        uint64_t unknown = 0;
+        for (int i = 0; i < config.num_options; i++) {
+            uint64_t added = after[i] - before[i];
+            accepted += sent_votes[i];
+            unknown += unknown_votes[i];
+            if (added < sent_votes[i] || added > sent_votes[i] + unknown_votes[i]) {
+                printf("Verificação: opção %d com %llu votos novos no placar, %llu aceitos e %llu sem resposta\n",
+                       i + 1, (unsigned long long)added, (unsigned long long)sent_votes[i],
+                       (unsigned long long)unknown_votes[i]);
+                status = 1;
+            }
+        }
+        printf("Verificação do placar: %s (%llu votos aceitos", status == 0 ? "OK" : "DIVERGENTE",
+               (unsigned long long)accepted);
+        if (unknown > 0) {
+            printf(", %llu sem resposta", (unsigned long long)unknown);
+        }
+        printf(")\n");
+
+        // Inclui as das conexões de controle e de outros clientes no período
+        if (syscalls_after > syscalls_before && commands > 0) {
+            uint64_t syscalls = syscalls_after - syscalls_before;
+            printf("Syscalls de E/S no servidor: %llu (%.3f por comando", (unsigned long long)syscalls,
+                   (double)syscalls / commands);
+            if (accepted > 0) {
+                printf(", %.3f por voto aceito", (double)syscalls / accepted);
+            }
+            printf(")\n");
+        }
+    }
+
+    free(conns);
+    free(threads);
+    return status;
+}
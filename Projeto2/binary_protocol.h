@@ -0,0 +1,72 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "protocol.h"
+
+// Codificação e decodificação dos quadros do protocolo binário, usadas
+// pelo servidor e pelo cliente.
+
+static inline void bin_put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static inline uint16_t bin_get_u16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline void bin_put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static inline uint32_t bin_get_u32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void bin_put_u64(uint8_t *p, uint64_t v) {
+    bin_put_u32(p, (uint32_t)(v >> 32));
+    bin_put_u32(p + 4, (uint32_t)v);
+}
+
+static inline uint64_t bin_get_u64(const uint8_t *p) {
+    return ((uint64_t)bin_get_u32(p) << 32) | bin_get_u32(p + 4);
+}
+
+// Varint sem sinal (LEB128). Retorna o número de bytes escritos.
+static inline size_t bin_put_varint(uint8_t *p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+// Lê um varint de no máximo len bytes. Retorna os bytes consumidos ou 0
+// se o varint estiver incompleto ou for maior que 64 bits.
+static inline size_t bin_get_varint(const uint8_t *p, size_t len, uint64_t *v) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < len && i < 10; i++) {
+        result |= (uint64_t)(p[i] & 0x7F) << (7 * i);
+        if ((p[i] & 0x80) == 0) {
+            *v = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Escreve o cabeçalho do quadro; o payload começa em p + BIN_HEADER_SIZE
+static inline void bin_put_header(uint8_t *p, uint8_t type, uint8_t flags, uint16_t payload_len) {
+    p[0] = type;
+    p[1] = flags;
+    bin_put_u16(p + 2, payload_len);
+}
+
+#endif
@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "checkpoint.h"
+
+// Registros acumulados antes de cada write() no processo filho
+#define CHECKPOINT_BATCH 512
+
+typedef struct {
+    Election *election;
+    char path[256];
+    unsigned interval_s;
+} CheckpointThread;
+
+int checkpoint_load(Election *election, const char *path, uint64_t *journal_lsn) {
+    *journal_lsn = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(CheckpointHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    const CheckpointHeader *header = map;
+    const CheckpointVoter *voters = (const CheckpointVoter *)(header + 1);
+    if (header->magic != CHECKPOINT_MAGIC || header->version != CHECKPOINT_VERSION ||
+        header->num_options != (uint32_t)election->num_options ||
+        header->options_hash != election->options_hash ||
+        (size_t)st.st_size != sizeof(CheckpointHeader) + header->voter_count * sizeof(CheckpointVoter)) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    uint64_t *counts = calloc(election->num_options, sizeof(uint64_t));
+    if (counts == NULL) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+    for (uint64_t i = 0; i < header->voter_count; i++) {
+        const CheckpointVoter *voter = &voters[i];
+        if (voter->option_index < (uint32_t)election->num_options &&
+            voter_table_mark_voted(&election->voters, voter->voter_id, voter->hash,
+                                   voter->option_index, NULL, NULL) == VOTER_MARKED) {
+            counts[voter->option_index]++;
+        }
+    }
+    for (int i = 0; i < election->num_options; i++) {
+        tally_add(&election->tally, i, counts[i]);
+    }
+    free(counts);
+    if (header->closed) {
+        atomic_store(&election->closing, true);
+        atomic_store(&election->closed, true);
+    }
+    *journal_lsn = header->journal_lsn;
+
+    munmap(map, st.st_size);
+    return 1;
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Executado no processo filho: só chamadas async-signal-safe (nada de
+// malloc, stdio ou locks, que podiam estar com outra thread no fork)
+static int write_snapshot(Election *election, const char *tmp_path, uint64_t journal_lsn) {
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CHECKPOINT_MAGIC;
+    header.version = CHECKPOINT_VERSION;
+    header.num_options = election->num_options;
+    header.closed = atomic_load(&election->closed);
+    header.options_hash = election->options_hash;
+    header.journal_lsn = journal_lsn;
+    header.created = (uint64_t)time(NULL);
+
+    if (lseek(fd, sizeof(header), SEEK_SET) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    CheckpointVoter batch[CHECKPOINT_BATCH];
+    size_t used = 0;
+    for (int s = 0; s < VOTER_TABLE_STRIPES; s++) {
+        VoterStripe *stripe = &election->voters.stripes[s];
+        const char *voter_id = voter_stripe_first_id(stripe);
+        for (size_t i = 0; i < stripe->count; i++, voter_id = voter_stripe_next_id(voter_id)) {
+            if (!voter_stripe_voted(stripe, i)) {
+                continue;
+            }
+            CheckpointVoter *record = &batch[used++];
+            memset(record, 0, sizeof(*record));
+            record->hash = voter_hash(voter_id);
+            record->option_index = voter_stripe_choice(stripe, i);
+            strcpy(record->voter_id, voter_id);
+            header.voter_count++;
+
+            if (used == CHECKPOINT_BATCH) {
+                if (write_all(fd, batch, sizeof(batch)) < 0) {
+                    close(fd);
+                    return -1;
+                }
+                used = 0;
+            }
+        }
+    }
+
+    if (write_all(fd, batch, used * sizeof(CheckpointVoter)) < 0 ||
+        pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        fsync(fd) < 0) {
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+int checkpoint_write(Election *election, const char *path) {
+    char tmp_path[512];
+    char dir[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    snprintf(dir, sizeof(dir), "%s", path);
+
+    uint64_t start = monotonic_ns();
+
+    // Retrato consistente: nenhum voto marcado nem acrescentado ao journal
+    // durante o fork. A marcação e o registro no journal acontecem sob o
+    // mesmo lock de stripe, então todo voto marcado no retrato está no
+    // journal até journal_lsn.
+    voter_table_lock_all(&election->voters);
+    uint64_t journal_lsn = journal_pause(&election->journal);
+    pid_t pid = fork();
+    if (pid == 0) {
+        _exit(write_snapshot(election, tmp_path, journal_lsn) < 0 ? 1 : 0);
+    }
+    journal_resume(&election->journal);
+    voter_table_unlock_all(&election->voters);
+
+    uint64_t paused = monotonic_ns() - start;
+    if (pid < 0) {
+        LOG_ERROR(election, "Checkpoint: erro no fork (%s)", strerror(errno));
+        return -1;
+    }
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        LOG_ERROR(election, "Checkpoint: falha ao gravar %s", path);
+        return -1;
+    }
+
+    // O retrato pode ter votos do lote que o journal ainda não sincronizou:
+    // só vale como checkpoint quando o journal estiver em disco até o LSN
+    // dele (senão uma queda deixaria o journal mais curto que o LSN, e
+    // votos novos confirmados depois seriam lidos a partir do meio de um
+    // registro). rename atômico: quem lê nunca vê um checkpoint pela metade.
+    journal_wait(&election->journal, journal_lsn);
+    if (rename(tmp_path, path) < 0) {
+        LOG_ERROR(election, "Checkpoint: erro ao renomear %s (%s)", tmp_path, strerror(errno));
+        return -1;
+    }
+
+    // Torna o rename durável
+    int dir_fd = open(dirname(dir), O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+
+    LOG_INFO(election, "Checkpoint gravado (LSN %llu): %.1f ms, votação parada por %.2f ms",
+             (unsigned long long)journal_lsn, (monotonic_ns() - start) / 1e6, paused / 1e6);
+    return 0;
+}
+
+static void *checkpoint_thread(void *arg) {
+    CheckpointThread *ctx = (CheckpointThread *)arg;
+    Election *election = ctx->election;
+    uint64_t last_lsn = journal_durable(&election->journal);
+
+    while (1) {
+        sleep(ctx->interval_s);
+
+        uint64_t lsn = journal_durable(&election->journal);
+        if (lsn == last_lsn) {
+            continue;
+        }
+        if (checkpoint_write(election, ctx->path) == 0) {
+            last_lsn = lsn;
+        }
+    }
+    return NULL;
+}
+
+void checkpoint_start(Election *election, const char *path, unsigned interval_s) {
+    if (interval_s == 0 || !election->journal.enabled) {
+        return;
+    }
+
+    CheckpointThread *ctx = malloc(sizeof(CheckpointThread));
+    pthread_t thread;
+    if (ctx == NULL) {
+        perror("Erro ao alocar thread de checkpoint");
+        exit(1);
+    }
+    ctx->election = election;
+    snprintf(ctx->path, sizeof(ctx->path), "%s", path);
+    ctx->interval_s = interval_s;
+
+    if (pthread_create(&thread, NULL, checkpoint_thread, ctx) != 0) {
+        perror("Erro ao criar thread de checkpoint");
+        exit(1);
+    }
+    pthread_detach(thread);
+}
@@ -0,0 +1,49 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include "server.h"
+
+// Checkpoint: retrato da eleição num arquivo plano que pode ser mapeado
+// com mmap. Inteiros na ordem de bytes nativa (o arquivo não é portável
+// entre arquiteturas). Layout: CheckpointHeader seguido de voter_count
+// registros CheckpointVoter (só votantes que votaram); o placar é a soma
+// dos registros.
+#define CHECKPOINT_MAGIC 0x564F5443U        // "VOTC"
+#define CHECKPOINT_VERSION 2
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_options;
+    uint32_t closed;
+    uint64_t options_hash;      // mesmo hash do cabeçalho do journal
+    uint64_t journal_lsn;       // registros do journal até aqui já estão no arquivo
+    uint64_t voter_count;
+    uint64_t created;           // time_t
+} CheckpointHeader;
+
+typedef struct {
+    uint64_t hash;              // voter_hash(voter_id)
+    uint32_t option_index;
+    uint32_t reserved;
+    char voter_id[MAX_VOTER_ID];
+} CheckpointVoter;
+
+// Carrega o checkpoint na eleição (tabela de votantes, placar e estado da
+// eleição). Retorna 1 se carregou, 0 se não existe e -1 se é inválido ou
+// de outra lista de opções. *journal_lsn recebe o ponto do journal a
+// partir do qual os votos ainda precisam ser reaplicados.
+int checkpoint_load(Election *election, const char *path, uint64_t *journal_lsn);
+
+// Grava um checkpoint sem parar a votação: com todos os stripes e o
+// journal travados o processo faz fork(), e o filho grava o retrato
+// (copy-on-write) enquanto o pai volta a aceitar votos. Retorna 0 se o
+// arquivo foi gravado (em path, via rename atômico).
+int checkpoint_write(Election *election, const char *path);
+
+// Thread que grava um checkpoint a cada interval_s segundos, se o journal
+// avançou desde o último
+void checkpoint_start(Election *election, const char *path, unsigned interval_s);
+
+#endif
@@ -3,16 +3,22 @@
 #include <string.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include "protocol.h"
+#include "binary_protocol.h"
+#include "client_protocol.h"
+#include "client_batch.h"
 
 void print_menu() {
     printf("\n=== MENU DE VOTAÇÃO ===\n");
     printf("LIST          - Listar opções disponíveis\n");
     printf("VOTE <numero> - Votar na opção (ex: VOTE 1)\n");
     printf("SCORE         - Ver placar parcial\n");
+    printf("WATCH         - Acompanhar o placar até o resultado final\n");
     printf("BYE           - Encerrar sessão\n");
     printf("========================\n\n");
 }
@@ -20,21 +26,254 @@ void print_menu() {
 void print_admin_menu() {
     printf("\n=== MENU ADMINISTRATIVO ===\n");
     printf("ADMIN CLOSE - Encerrar votação\n");
+    printf("ADMIN STATS - Métricas do servidor\n");
+    printf("ADMIN EXPORT - Exportar o resultado atual (relatório, CSV e JSON)\n");
     printf("SCORE       - Ver placar\n");
     printf("BYE         - Encerrar sessão\n");
     printf("===========================\n\n");
 }
 
+// Mostra uma resposta do servidor (uma linha, sem \n). Retorna false
+// quando a sessão foi encerrada.
+bool print_response(char *buffer) {
+    char names[MAX_OPTIONS][MAX_OPTION_NAME];
+    uint64_t counts[MAX_OPTIONS];
+    bool final;
+    int count;
+    
+    if ((count = parse_options(buffer, names)) >= 0) {
+        printf("\n=== OPÇÕES DE VOTAÇÃO ===\n");
+        for (int i = 0; i < count; i++) {
+            printf("%d. %s\n", i + 1, names[i]);
+        }
+        printf("========================\n");
+    }
+    else if (strncmp(buffer, RESP_OK_VOTED, strlen(RESP_OK_VOTED)) == 0) {
+        printf("✓ Voto registrado com sucesso!\n");
+        printf("%s\n", buffer);
+    }
+    else if (strcmp(buffer, RESP_ERR_DUPLICATE) == 0) {
+        printf("✗ Erro: Você já votou anteriormente!\n");
+    }
+    else if (strcmp(buffer, RESP_ERR_INVALID) == 0) {
+        printf("✗ Erro: Opção inválida!\n");
+    }
+    else if (strcmp(buffer, RESP_ERR_CLOSED) == 0) {
+        printf("✗ Erro: A votação foi encerrada!\n");
+    }
+    else if ((count = parse_score(buffer, names, counts, &final)) >= 0 && !final) {
+        printf("\n=== PLACAR PARCIAL ===\n");
+        for (int i = 0; i < count; i++) {
+            printf("%-40s: %llu votos\n", names[i], (unsigned long long)counts[i]);
+        }
+        printf("======================\n");
+    }
+    else if (count >= 0) {
+        // CLOSED FINAL: placar com porcentagens
+        printf("\n=== RESULTADO FINAL ===\n");
+        
+        uint64_t total_votes = 0;
+        for (int i = 0; i < count; i++) {
+            total_votes += counts[i];
+        }
+        for (int i = 0; i < count; i++) {
+            double percentage = total_votes > 0 ? (counts[i] * 100.0 / total_votes) : 0.0;
+            printf("%-40s: %llu votos (%.2f%%)\n", names[i], (unsigned long long)counts[i], percentage);
+        }
+        
+        printf("\nTotal de votos: %llu\n", (unsigned long long)total_votes);
+        printf("=======================\n");
+    }
+    else if (strcmp(buffer, RESP_BYE) == 0) {
+        printf("Sessão encerrada. Até logo!\n");
+        return false;
+    }
+    else if (strcmp(buffer, RESP_WATCHING) == 0) {
+        printf("✓ Acompanhando o placar (Ctrl+C para sair)\n");
+    }
+    else if (strncmp(buffer, "OK ELECTION_CLOSED", 18) == 0) {
+        printf("✓ Votação encerrada com sucesso!\n");
+    }
+    else if (strncmp(buffer, RESP_STATS " ", strlen(RESP_STATS) + 1) == 0) {
+        printf("\n=== MÉTRICAS DO SERVIDOR ===\n");
+        for (char *save = NULL, *field = strtok_r(buffer + strlen(RESP_STATS) + 1, " ", &save);
+             field != NULL; field = strtok_r(NULL, " ", &save)) {
+            printf("%s\n", field);
+        }
+        printf("============================\n");
+    }
+    else if (strncmp(buffer, "ERR NOT_AUTHORIZED", 18) == 0) {
+        printf("✗ Erro: Você não tem permissão para executar este comando!\n");
+    }
+    else {
+        printf("Servidor: %s\n", buffer);
+    }
+    return true;
+}
+
+// Recebe exatamente len bytes
+static bool recv_all(int sock, void *buffer, size_t len) {
+    char *p = buffer;
+    while (len > 0) {
+        ssize_t n = recv(sock, p, len, 0);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Recebe um quadro binário completo (cabeçalho + payload) em frame
+bool recv_frame(int sock, uint8_t *frame) {
+    if (!recv_all(sock, frame, BIN_HEADER_SIZE)) {
+        return false;
+    }
+    size_t payload_len = bin_get_u16(frame + 2);
+    if (payload_len > MAX_BUFFER - BIN_HEADER_SIZE) {
+        return false;
+    }
+    return recv_all(sock, frame + BIN_HEADER_SIZE, payload_len);
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Uso: %s [--binary] [--election <nome>] <servidor> <porta> <VOTER_ID>\n", prog);
+    fprintf(stderr, "     %s --batch [opções] <servidor> <porta> [arquivo]\n", prog);
+    fprintf(stderr, "Exemplo: %s localhost 8080 VOTER001\n", prog);
+    fprintf(stderr, "         %s --binary localhost 8080 1001\n", prog);
+    fprintf(stderr, "         %s --election prefeitura localhost 8080 VOTER001\n", prog);
+    fprintf(stderr, "         %s --batch --connections 8 --window 64 localhost 8080 votos.txt\n", prog);
+    fprintf(stderr, "Modo batch (linhas \"<VOTER_ID> <COMANDO>\", saída em JSON):\n");
+    fprintf(stderr, "  --connections <n>  Conexões com o servidor (padrão: 4)\n");
+    fprintf(stderr, "  --window <n>       Pedidos em voo por conexão (padrão: 32, máx. %d)\n", BATCH_MAX_WINDOW);
+}
+
+// WATCH: mostra cada placar enviado pelo servidor até o resultado final.
+// Retorna false se a conexão caiu.
+static bool watch_scores(int sock, bool binary, char names[][MAX_OPTION_NAME], int *num_names) {
+    char pending[MAX_BUFFER];
+    size_t pending_len = 0;
+    char line[MAX_BUFFER];
+    uint8_t frame[MAX_BUFFER];
+    
+    while (1) {
+        if (binary) {
+            if (!recv_frame(sock, frame)) {
+                printf("Servidor desconectado.\n");
+                return false;
+            }
+            decode_response(frame, names, num_names, line);
+        } else {
+            // Uma linha por atualização; um recv pode trazer várias
+            char *newline;
+            while ((newline = memchr(pending, '\n', pending_len)) == NULL) {
+                ssize_t n = recv(sock, pending + pending_len, sizeof(pending) - 1 - pending_len, 0);
+                if (n <= 0) {
+                    printf("Servidor desconectado.\n");
+                    return false;
+                }
+                pending_len += n;
+            }
+            size_t line_len = newline - pending;
+            memcpy(line, pending, line_len);
+            line[line_len] = '\0';
+            pending_len -= line_len + 1;
+            memmove(pending, newline + 1, pending_len);
+        }
+        
+        print_response(line);
+        if (strncmp(line, RESP_CLOSED, strlen(RESP_CLOSED)) == 0 || strncmp(line, "ERR", 3) == 0) {
+            return true;
+        }
+    }
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        fprintf(stderr, "Uso: %s <servidor> <porta> <VOTER_ID>\n", argv[0]);
-        fprintf(stderr, "Exemplo: %s localhost 8080 VOTER001\n", argv[0]);
+    static struct option long_options[] = {
+        {"binary", no_argument, NULL, 'b'},
+        {"batch", no_argument, NULL, 'B'},
+        {"connections", required_argument, NULL, 'c'},
+        {"window", required_argument, NULL, 'w'},
+        {"election", required_argument, NULL, 'e'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    
+    // --binary usa o protocolo binário (VOTER_ID numérico)
+    bool binary = false;
+    bool batch = false;
+    int connections = 4;
+    int window = 32;
+    // --election escolhe a eleição no HELLO (sem ela, a padrão do servidor)
+    const char *election = NULL;
+    
+    int c;
+    while ((c = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'b':
+                binary = true;
+                break;
+            case 'B':
+                batch = true;
+                break;
+            case 'c':
+                connections = atoi(optarg);
+                break;
+            case 'w':
+                window = atoi(optarg);
+                break;
+            case 'e':
+                election = optarg;
+                break;
+            default:
+                print_usage(argv[0]);
+                exit(1);
+        }
+    }
+    
+    if (batch) {
+        int args = argc - optind;
+        if (args < 2 || args > 3 || connections < 1 || window < 1 || window > BATCH_MAX_WINDOW) {
+            print_usage(argv[0]);
+            exit(1);
+        }
+        
+        BatchConfig config = {
+            .host = argv[optind],
+            .port = atoi(argv[optind + 1]),
+            .connections = connections,
+            .window = window,
+            .binary = binary,
+            .election = election,
+            .input_fd = STDIN_FILENO
+        };
+        // Sem arquivo (ou "-") os comandos vêm da entrada padrão
+        if (args == 3 && strcmp(argv[optind + 2], "-") != 0) {
+            config.input_fd = open(argv[optind + 2], O_RDONLY);
+            if (config.input_fd < 0) {
+                perror("Erro ao abrir arquivo de comandos");
+                exit(1);
+            }
+        }
+        return run_batch(&config);
+    }
+    
+    if (argc - optind != 3) {
+        print_usage(argv[0]);
         exit(1);
     }
     
-    char *server_host = argv[1];
-    int server_port = atoi(argv[2]);
-    char *voter_id = argv[3];
+    char *server_host = argv[optind];
+    int server_port = atoi(argv[optind + 1]);
+    char *voter_id = argv[optind + 2];
+    
+    char *id_end;
+    unsigned long long numeric_id = strtoull(voter_id, &id_end, 10);
+    if (binary && (*voter_id == '\0' || *id_end != '\0')) {
+        fprintf(stderr, "No protocolo binário o VOTER_ID deve ser numérico\n");
+        exit(1);
+    }
     
     // Cria socket
     int sock = socket(AF_INET, SOCK_STREAM, 0);
@@ -68,13 +307,43 @@ int main(int argc, char *argv[]) {
     
     // Envia HELLO
     char buffer[MAX_BUFFER];
-    sprintf(buffer, "HELLO %s\n", voter_id);
-    send(sock, buffer, strlen(buffer), 0);
+    uint8_t frame[MAX_BUFFER];
+    char names[MAX_OPTIONS][MAX_OPTION_NAME];
+    int num_names = 0;
     
-    // Recebe WELCOME
-    memset(buffer, 0, MAX_BUFFER);
-    recv(sock, buffer, MAX_BUFFER - 1, 0);
-    printf("Servidor: %s", buffer);
+    if (binary) {
+        send(sock, frame, encode_hello_frame(numeric_id, election, frame), 0);
+        
+        // Recebe WELCOME e, sem mostrar, a lista de opções para traduzir
+        // os índices das respostas
+        if (!recv_frame(sock, frame)) {
+            printf("Servidor desconectado.\n");
+            exit(1);
+        }
+        decode_response(frame, names, &num_names, buffer);
+        printf("Servidor: %s\n", buffer);
+        if (strncmp(buffer, "ERR", 3) == 0) {
+            exit(1);
+        }
+        
+        char list_line[MAX_BUFFER];
+        bin_put_header(frame, BIN_LIST, 0, 0);
+        send(sock, frame, BIN_HEADER_SIZE, 0);
+        if (recv_frame(sock, frame)) {
+            decode_response(frame, names, &num_names, list_line);
+        }
+    } else {
+        sprintf(buffer, "HELLO %s%s%s\n", voter_id, election ? " " : "", election ? election : "");
+        send(sock, buffer, strlen(buffer), 0);
+        
+        // Recebe WELCOME (ou ERR UNKNOWN_ELECTION / ERR NOT_ELIGIBLE)
+        memset(buffer, 0, MAX_BUFFER);
+        recv(sock, buffer, MAX_BUFFER - 1, 0);
+        printf("Servidor: %s", buffer);
+        if (strncmp(buffer, "ERR", 3) == 0) {
+            exit(1);
+        }
+    }
     
     // Verifica se é ADMIN
     bool is_admin = (strcmp(voter_id, "ADMIN") == 0);
@@ -105,6 +374,38 @@ int main(int argc, char *argv[]) {
             continue;
         }
         
+        if (strcmp(command, CMD_WATCH) == 0) {
+            if (binary) {
+                send(sock, frame, encode_command(command, frame), 0);
+            } else {
+                send(sock, CMD_WATCH "\n", strlen(CMD_WATCH) + 1, 0);
+            }
+            if (!watch_scores(sock, binary, names, &num_names)) {
+                break;
+            }
+            continue;
+        }
+        
+        if (binary) {
+            size_t frame_len = encode_command(command, frame);
+            if (frame_len == 0) {
+                printf("Comando não disponível no protocolo binário\n");
+                continue;
+            }
+            send(sock, frame, frame_len, 0);
+            
+            if (!recv_frame(sock, frame)) {
+                printf("Servidor desconectado.\n");
+                break;
+            }
+            decode_response(frame, names, &num_names, buffer);
+            
+            if (!print_response(buffer)) {
+                break;
+            }
+            continue;
+        }
+        
         // Adiciona newline para protocolo
         strcat(command, "\n");
         
@@ -123,130 +424,9 @@ int main(int argc, char *argv[]) {
         // Remove newline da resposta
         buffer[strcspn(buffer, "\n")] = 0;
         
-        // Processa resposta
-        if (strncmp(buffer, RESP_OPTIONS, strlen(RESP_OPTIONS)) == 0) {
-            // Parse OPTIONS response
-            int num_options;
-            char *ptr = buffer + strlen(RESP_OPTIONS) + 1;
-            sscanf(ptr, "%d", &num_options);
-            
-            printf("\n=== OPÇÕES DE VOTAÇÃO ===\n");
-            
-            // Avança para as opções (separadas por |)
-            ptr = strchr(ptr, '|');
-            if (ptr) {
-                ptr++; // Pula o primeiro |
-                int option_num = 1;
-                char *option = strtok(ptr, "|");
-                while (option != NULL && option_num <= num_options) {
-                    // Remove possível \n no final
-                    option[strcspn(option, "\n\r")] = 0;
-                    printf("%d. %s\n", option_num++, option);
-                    option = strtok(NULL, "|");
-                }
-            }
-            printf("========================\n");
-        }
-        else if (strncmp(buffer, RESP_OK_VOTED, strlen(RESP_OK_VOTED)) == 0) {
-            printf("✓ Voto registrado com sucesso!\n");
-            printf("%s\n", buffer);
-        }
-        else if (strcmp(buffer, RESP_ERR_DUPLICATE) == 0) {
-            printf("✗ Erro: Você já votou anteriormente!\n");
-        }
-        else if (strcmp(buffer, RESP_ERR_INVALID) == 0) {
-            printf("✗ Erro: Opção inválida!\n");
-        }
-        else if (strcmp(buffer, RESP_ERR_CLOSED) == 0) {
-            printf("✗ Erro: A votação foi encerrada!\n");
-        }
-        else if (strncmp(buffer, RESP_SCORE, strlen(RESP_SCORE)) == 0) {
-            // Parse SCORE response
-            int num_options;
-            char *ptr = buffer + strlen(RESP_SCORE) + 1;
-            sscanf(ptr, "%d", &num_options);
-            
-            printf("\n=== PLACAR PARCIAL ===\n");
-            
-            // Avança para os resultados (separados por |)
-            ptr = strchr(ptr, '|');
-            if (ptr) {
-                ptr++; // Pula o primeiro |
-                char *result = strtok(ptr, "|");
-                while (result != NULL) {
-                    char option[MAX_OPTION_NAME];
-                    int votes;
-                    // Remove possível \n
-                    result[strcspn(result, "\n\r")] = 0;
-                    if (sscanf(result, "%[^:]:%d", option, &votes) == 2) {
-                        printf("%-40s: %d votos\n", option, votes);
-                    }
-                    result = strtok(NULL, "|");
-                }
-            }
-            printf("======================\n");
-        }
-        else if (strncmp(buffer, RESP_CLOSED, strlen(RESP_CLOSED)) == 0) {
-            // Parse CLOSED FINAL response
-            int num_options;
-            char *ptr = buffer + strlen(RESP_CLOSED) + 1;
-            sscanf(ptr, "%d", &num_options);
-            
-            printf("\n=== RESULTADO FINAL ===\n");
-            
-            // Avança para os resultados (separados por |)
-            ptr = strchr(ptr, '|');
-            if (ptr) {
-                ptr++; // Pula o primeiro |
-                
-                // Remove newline do buffer
-                char temp_buffer[MAX_BUFFER];
-                strncpy(temp_buffer, ptr, MAX_BUFFER - 1);
-                temp_buffer[strcspn(temp_buffer, "\n\r")] = 0;
-                
-                // Primeiro, calcula total
-                char results_copy[MAX_BUFFER];
-                strcpy(results_copy, temp_buffer);
-                int total_votes = 0;
-                char *temp = strtok(results_copy, "|");
-                while (temp != NULL) {
-                    int votes;
-                    char option[MAX_OPTION_NAME];
-                    if (sscanf(temp, "%[^:]:%d", option, &votes) == 2) {
-                        total_votes += votes;
-                    }
-                    temp = strtok(NULL, "|");
-                }
-                
-                // Agora imprime com porcentagens
-                char *result = strtok(temp_buffer, "|");
-                while (result != NULL) {
-                    char option[MAX_OPTION_NAME];
-                    int votes;
-                    if (sscanf(result, "%[^:]:%d", option, &votes) == 2) {
-                        double percentage = total_votes > 0 ? (votes * 100.0 / total_votes) : 0.0;
-                        printf("%-40s: %d votos (%.2f%%)\n", option, votes, percentage);
-                    }
-                    result = strtok(NULL, "|");
-                }
-                
-                printf("\nTotal de votos: %d\n", total_votes);
-            }
-            printf("=======================\n");
-        }
-        else if (strcmp(buffer, RESP_BYE) == 0) {
-            printf("Sessão encerrada. Até logo!\n");
+        if (!print_response(buffer)) {
             break;
         }
-        else if (strncmp(buffer, "OK ELECTION_CLOSED", 18) == 0) {
-            printf("✓ Votação encerrada com sucesso!\n");
-        }
-        else if (strncmp(buffer, "ERR NOT_AUTHORIZED", 18) == 0) {
-            printf("✗ Erro: Você não tem permissão para executar este comando!\n");
-        }
-        else {
-            printf("Servidor: %s\n", buffer);
-        }
     }
     
     close(sock);
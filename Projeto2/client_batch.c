@@ -0,0 +1,592 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "protocol.h"
+#include "binary_protocol.h"
+#include "client_protocol.h"
+#include "client_batch.h"
+
+// Cada votante fica preso a uma conexão (hash do VOTER_ID), então seus
+// comandos chegam ao servidor na ordem do arquivo. Quando o votante da
+// linha não é o da sessão atual da conexão, um HELLO implícito é enviado
+// antes do comando. Tudo roda numa única thread com poll.
+
+#define MAX_COMMAND 64
+#define IN_BUFFER (64 * 1024)
+#define OUT_BUFFER (64 * 1024)
+#define INPUT_BUFFER (64 * 1024)
+// Um comando pode precisar de HELLO e LIST implícitos antes dele
+#define QUEUE_SIZE (BATCH_MAX_WINDOW + 2)
+
+typedef enum {
+    REQUEST_INPUT,      // linha da entrada: gera uma linha JSON
+    REQUEST_HELLO,      // HELLO implícito na troca de votante
+    REQUEST_LIST        // LIST implícito (binário) para conhecer os nomes
+} RequestKind;
+
+typedef struct {
+    RequestKind kind;
+    unsigned long line;
+    char voter_id[MAX_VOTER_ID];
+    char command[MAX_COMMAND];
+} BatchRequest;
+
+typedef struct {
+    int fd;
+    bool dead;
+    bool has_session;
+    char voter_id[MAX_VOTER_ID];    // votante depois dos pedidos já enfileirados
+    bool names_requested;
+    char names[MAX_OPTIONS][MAX_OPTION_NAME];
+    int num_names;
+
+    char in[IN_BUFFER];
+    size_t in_len;
+    char out[OUT_BUFFER];
+    size_t out_len;
+    size_t out_sent;
+
+    BatchRequest queue[QUEUE_SIZE];
+    int head;
+    int count;
+
+    // HELLO ou LIST implícito recusado: o comando da mesma linha (que vem
+    // logo depois na fila) sai como failed com este erro
+    unsigned long implicit_line;
+    char implicit_error[MAX_BUFFER];
+} BatchConn;
+
+typedef struct {
+    const BatchConfig *config;
+    BatchConn *conns;
+
+    char input[INPUT_BUFFER];
+    size_t input_len;
+    bool input_eof;
+    bool discarding;        // descartando o resto de uma linha longa demais
+    unsigned long line;
+
+    // Linha já interpretada esperando espaço na janela da sua conexão
+    bool stalled;
+    BatchRequest next;
+
+    unsigned long answered;
+    unsigned long skipped;
+    unsigned long failed;
+} Batch;
+
+static int connect_server(const BatchConfig *config) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config->port);
+    if (inet_pton(AF_INET, config->host, &addr.sin_addr) <= 0) {
+        if (strcmp(config->host, "localhost") != 0) {
+            fprintf(stderr, "Endereço inválido: %s\n", config->host);
+            exit(1);
+        }
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// ---- Saída JSON ----
+
+static void json_string(const char *s) {
+    putchar('"');
+    for (; *s != '\0'; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            putchar('\\');
+            putchar(c);
+        } else if (c < 0x20) {
+            printf("\\u%04x", c);
+        } else {
+            putchar(c);
+        }
+    }
+    putchar('"');
+}
+
+static void emit_request(const BatchRequest *request, const char *status) {
+    printf("{\"line\":%lu,\"voter\":", request->line);
+    json_string(request->voter_id);
+    printf(",\"command\":");
+    json_string(request->command);
+    printf(",\"status\":\"%s\"", status);
+}
+
+// Comando que não chegou ao servidor: status "skipped" ou "failed"
+static void emit_failure(const BatchRequest *request, const char *status, const char *reason) {
+    emit_request(request, status);
+    printf(",\"error\":");
+    json_string(reason);
+    printf("}\n");
+}
+
+// Resposta do servidor, com as opções ou o placar já separados
+static void emit_response(const BatchRequest *request, const char *response) {
+    char names[MAX_OPTIONS][MAX_OPTION_NAME];
+    uint64_t counts[MAX_OPTIONS];
+    bool final;
+    int count;
+
+    emit_request(request, strncmp(response, "ERR", 3) == 0 ? "error" : "ok");
+    printf(",\"response\":");
+    json_string(response);
+
+    if ((count = parse_options(response, names)) >= 0) {
+        printf(",\"options\":[");
+        for (int i = 0; i < count; i++) {
+            if (i > 0) {
+                putchar(',');
+            }
+            json_string(names[i]);
+        }
+        putchar(']');
+    } else if ((count = parse_score(response, names, counts, &final)) >= 0) {
+        printf(",\"final\":%s,\"scores\":{", final ? "true" : "false");
+        for (int i = 0; i < count; i++) {
+            if (i > 0) {
+                putchar(',');
+            }
+            json_string(names[i]);
+            printf(":%llu", (unsigned long long)counts[i]);
+        }
+        putchar('}');
+    }
+    printf("}\n");
+}
+
+// ---- Envio ----
+
+static bool is_hello(const char *command) {
+    return strncmp(command, CMD_HELLO, strlen(CMD_HELLO)) == 0;
+}
+
+static void push_request(BatchConn *conn, const BatchRequest *request, RequestKind kind) {
+    BatchRequest *slot = &conn->queue[(conn->head + conn->count) % QUEUE_SIZE];
+    *slot = *request;
+    slot->kind = kind;
+    conn->count++;
+}
+
+static void send_hello(Batch *batch, BatchConn *conn, const char *voter_id) {
+    const char *election = batch->config->election;
+    if (batch->config->binary) {
+        conn->out_len += encode_hello_frame(strtoull(voter_id, NULL, 10), election,
+                                            (uint8_t *)conn->out + conn->out_len);
+    } else {
+        conn->out_len += sprintf(conn->out + conn->out_len, "%s %s%s%s\n", CMD_HELLO, voter_id,
+                                 election ? " " : "", election ? election : "");
+    }
+    strcpy(conn->voter_id, voter_id);
+    conn->has_session = true;
+}
+
+static void encode_text(Batch *batch, BatchConn *conn, const char *command) {
+    if (batch->config->binary) {
+        conn->out_len += encode_command(command, (uint8_t *)conn->out + conn->out_len);
+    } else {
+        conn->out_len += sprintf(conn->out + conn->out_len, "%s\n", command);
+    }
+}
+
+// Pedidos que o comando ocupa na janela, contando os implícitos
+static int requests_needed(Batch *batch, BatchConn *conn, const BatchRequest *request) {
+    bool hello = is_hello(request->command);
+    bool switch_voter = !hello && (!conn->has_session || strcmp(conn->voter_id, request->voter_id) != 0);
+    bool list = batch->config->binary && !conn->names_requested && (hello || switch_voter);
+    return 1 + switch_voter + list;
+}
+
+// Enfileira o comando (e os pedidos implícitos) no buffer de saída
+static void enqueue(Batch *batch, BatchConn *conn, const BatchRequest *request) {
+    if (conn->out_sent > 0) {
+        memmove(conn->out, conn->out + conn->out_sent, conn->out_len - conn->out_sent);
+        conn->out_len -= conn->out_sent;
+        conn->out_sent = 0;
+    }
+
+    if (is_hello(request->command)) {
+        send_hello(batch, conn, request->voter_id);
+        push_request(conn, request, REQUEST_INPUT);
+    } else if (!conn->has_session || strcmp(conn->voter_id, request->voter_id) != 0) {
+        send_hello(batch, conn, request->voter_id);
+        push_request(conn, request, REQUEST_HELLO);
+    }
+
+    // No binário VOTED e SCORE trazem só índices: busca os nomes uma vez
+    if (batch->config->binary && !conn->names_requested) {
+        encode_text(batch, conn, CMD_LIST);
+        push_request(conn, request, REQUEST_LIST);
+        conn->names_requested = true;
+    }
+
+    if (!is_hello(request->command)) {
+        encode_text(batch, conn, request->command);
+        push_request(conn, request, REQUEST_INPUT);
+    }
+}
+
+// Conexão perdida: os comandos em voo nunca terão resposta
+static void fail_connection(Batch *batch, BatchConn *conn) {
+    if (conn->dead) {
+        return;
+    }
+    close(conn->fd);
+    conn->dead = true;
+    while (conn->count > 0) {
+        BatchRequest *request = &conn->queue[conn->head];
+        if (request->kind == REQUEST_INPUT) {
+            emit_failure(request, "failed", "conexão encerrada");
+            batch->failed++;
+        }
+        conn->head = (conn->head + 1) % QUEUE_SIZE;
+        conn->count--;
+    }
+    conn->out_len = conn->out_sent = 0;
+}
+
+static void flush(Batch *batch, BatchConn *conn) {
+    while (!conn->dead && conn->out_sent < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + conn->out_sent, conn->out_len - conn->out_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                fail_connection(batch, conn);
+            }
+            return;
+        }
+        conn->out_sent += n;
+    }
+}
+
+// ---- Entrada ----
+
+// Interpreta "<VOTER_ID> <COMANDO>". Retorna 1 se há um comando para
+// enviar, 0 para linhas vazias e comentários (#) e -1 se a linha foi
+// rejeitada (já reportada).
+static int parse_line(Batch *batch, char *text, BatchRequest *request) {
+    text[strcspn(text, "\r")] = '\0';
+    text += strspn(text, " \t");
+    if (*text == '\0' || *text == '#') {
+        return 0;
+    }
+
+    memset(request, 0, sizeof(*request));
+    request->line = batch->line;
+    char *command = text + strcspn(text, " \t");
+    size_t id_len = command - text;
+    command += strspn(command, " \t");
+
+    const char *reason = NULL;
+    if (id_len >= MAX_VOTER_ID) {
+        reason = "VOTER_ID longo demais";
+        id_len = MAX_VOTER_ID - 1;
+    }
+    memcpy(request->voter_id, text, id_len);
+    snprintf(request->command, MAX_COMMAND, "%s", command);
+
+    uint8_t frame[MAX_BUFFER];
+    char *id_end;
+    strtoull(request->voter_id, &id_end, 10);
+
+    if (reason != NULL) {
+        // Já definido
+    } else if (*command == '\0') {
+        reason = "linha sem comando";
+    } else if (strlen(command) >= MAX_COMMAND) {
+        reason = "comando longo demais";
+    } else if (strcmp(command, CMD_BYE) == 0) {
+        reason = "BYE encerraria a conexão compartilhada";
+    } else if (strcmp(command, CMD_WATCH) == 0 || strcmp(command, CMD_UNWATCH) == 0) {
+        reason = "WATCH misturaria placares enviados às respostas";
+    } else if (batch->config->binary && *id_end != '\0') {
+        reason = "no protocolo binário o VOTER_ID deve ser numérico";
+    } else if (batch->config->binary && !is_hello(command) && encode_command(command, frame) == 0) {
+        reason = "comando não disponível no protocolo binário";
+    }
+
+    if (reason != NULL) {
+        emit_failure(request, "skipped", reason);
+        batch->skipped++;
+        return -1;
+    }
+    return 1;
+}
+
+static unsigned pick_connection(const Batch *batch, const char *voter_id) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char *p = voter_id; *p != '\0'; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    return hash % batch->config->connections;
+}
+
+// Distribui as linhas completas da entrada enquanto houver espaço nas
+// janelas. Para na primeira linha cuja conexão está cheia.
+static void dispatch_input(Batch *batch) {
+    size_t start = 0;
+
+    while (1) {
+        if (!batch->stalled) {
+            char *text = batch->input + start;
+            size_t available = batch->input_len - start;
+            char *newline = memchr(text, '\n', available);
+            size_t line_len;
+
+            if (newline != NULL) {
+                line_len = newline - text;
+                start += line_len + 1;
+            } else if (available == INPUT_BUFFER - 1 || (batch->input_eof && available > 0)) {
+                // Linha longa demais (o resto é descartado) ou última linha sem \n
+                line_len = available;
+                start += available;
+            } else {
+                break;
+            }
+
+            bool discard = batch->discarding;
+            batch->discarding = newline == NULL && !batch->input_eof;
+            if (discard) {
+                continue;
+            }
+            text[line_len] = '\0';
+            batch->line++;
+            if (parse_line(batch, text, &batch->next) <= 0) {
+                continue;
+            }
+            batch->stalled = true;
+        }
+
+        BatchConn *conn = &batch->conns[pick_connection(batch, batch->next.voter_id)];
+        if (conn->dead) {
+            emit_failure(&batch->next, "failed", "conexão encerrada");
+            batch->failed++;
+            batch->stalled = false;
+            continue;
+        }
+        int needed = requests_needed(batch, conn, &batch->next);
+        if (conn->count > 0 && conn->count + needed > batch->config->window) {
+            break;
+        }
+        enqueue(batch, conn, &batch->next);
+        batch->stalled = false;
+    }
+
+    memmove(batch->input, batch->input + start, batch->input_len - start);
+    batch->input_len -= start;
+}
+
+static void read_input(Batch *batch) {
+    // A linha longa demais ocupa o buffer inteiro; o '\0' vai no lugar do último byte
+    ssize_t n = read(batch->config->input_fd, batch->input + batch->input_len,
+                     INPUT_BUFFER - 1 - batch->input_len);
+    if (n < 0 && errno == EINTR) {
+        return;
+    }
+    if (n < 0) {
+        perror("Erro ao ler a entrada");
+    }
+    if (n <= 0) {
+        batch->input_eof = true;
+        return;
+    }
+    batch->input_len += n;
+}
+
+// ---- Respostas ----
+
+static void complete(Batch *batch, BatchConn *conn, const char *response) {
+    BatchRequest *request = &conn->queue[conn->head];
+    conn->head = (conn->head + 1) % QUEUE_SIZE;
+    conn->count--;
+    bool error = strncmp(response, "ERR", 3) == 0;
+
+    // HELLO recusado: o servidor derrubou a sessão, então a próxima linha
+    // deste votante refaz o HELLO (se nenhum outro já foi enfileirado)
+    if (error &&
+        (request->kind == REQUEST_HELLO || (request->kind == REQUEST_INPUT && is_hello(request->command))) &&
+        conn->has_session && strcmp(conn->voter_id, request->voter_id) == 0) {
+        conn->has_session = false;
+    }
+    if (error && request->kind == REQUEST_LIST) {
+        conn->names_requested = false;
+    }
+    if (request->kind != REQUEST_INPUT) {
+        // Vale o primeiro erro: o do HELLO, não o NOT_AUTHENTICATED do LIST
+        if (error && (conn->implicit_error[0] == '\0' || conn->implicit_line != request->line)) {
+            conn->implicit_line = request->line;
+            snprintf(conn->implicit_error, sizeof(conn->implicit_error), "%s", response);
+        }
+        return;
+    }
+
+    if (conn->implicit_error[0] != '\0' && conn->implicit_line == request->line) {
+        emit_failure(request, "failed", conn->implicit_error);
+        batch->failed++;
+    } else {
+        emit_response(request, response);
+        batch->answered++;
+    }
+    conn->implicit_error[0] = '\0';
+}
+
+static void parse_responses(Batch *batch, BatchConn *conn) {
+    char line[MAX_BUFFER];
+    size_t start = 0;
+
+    while (conn->count > 0) {
+        char *data = conn->in + start;
+        size_t available = conn->in_len - start;
+
+        if (batch->config->binary) {
+            if (available < BIN_HEADER_SIZE) {
+                break;
+            }
+            size_t frame_len = BIN_HEADER_SIZE + bin_get_u16((uint8_t *)data + 2);
+            if (available < frame_len) {
+                break;
+            }
+            decode_response((uint8_t *)data, conn->names, &conn->num_names, line);
+            start += frame_len;
+        } else {
+            char *newline = memchr(data, '\n', available);
+            if (newline == NULL) {
+                break;
+            }
+            size_t len = newline - data;
+            if (len >= MAX_BUFFER) {
+                len = MAX_BUFFER - 1;
+            }
+            memcpy(line, data, len);
+            line[len] = '\0';
+            line[strcspn(line, "\r")] = '\0';
+            start = newline - conn->in + 1;
+        }
+        complete(batch, conn, line);
+    }
+
+    // Sem pedidos em voo não há resposta parcial: o resto é descartado
+    if (conn->count == 0) {
+        start = conn->in_len;
+    }
+    memmove(conn->in, conn->in + start, conn->in_len - start);
+    conn->in_len -= start;
+}
+
+static void handle_input(Batch *batch, BatchConn *conn) {
+    ssize_t n = recv(conn->fd, conn->in + conn->in_len, IN_BUFFER - conn->in_len, 0);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+    }
+    if (n <= 0) {
+        fail_connection(batch, conn);
+        return;
+    }
+    conn->in_len += n;
+    parse_responses(batch, conn);
+}
+
+int run_batch(const BatchConfig *config) {
+    Batch *batch = calloc(1, sizeof(Batch));
+    BatchConn *conns = calloc(config->connections, sizeof(BatchConn));
+    struct pollfd *fds = calloc(config->connections + 1, sizeof(struct pollfd));
+    if (batch == NULL || conns == NULL || fds == NULL) {
+        perror("Erro ao alocar conexões");
+        exit(1);
+    }
+    batch->config = config;
+    batch->conns = conns;
+
+    for (int i = 0; i < config->connections; i++) {
+        conns[i].fd = connect_server(config);
+        if (conns[i].fd < 0) {
+            perror("Erro ao conectar ao servidor");
+            exit(1);
+        }
+        fcntl(conns[i].fd, F_SETFL, fcntl(conns[i].fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+
+    while (1) {
+        dispatch_input(batch);
+
+        int outstanding = 0;
+        for (int i = 0; i < config->connections; i++) {
+            flush(batch, &conns[i]);
+            outstanding += conns[i].count;
+        }
+        if (batch->input_eof && !batch->stalled && outstanding == 0) {
+            break;
+        }
+
+        // Quem consome a saída (um gateway, por exemplo) vê cada lote de
+        // respostas assim que ele chega
+        fflush(stdout);
+
+        // A entrada só é lida enquanto a linha anterior já foi despachada
+        fds[0].fd = batch->input_eof || batch->stalled ? -1 : config->input_fd;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < config->connections; i++) {
+            BatchConn *conn = &conns[i];
+            fds[i + 1].fd = conn->dead ? -1 : conn->fd;
+            fds[i + 1].events = POLLIN | (conn->out_sent < conn->out_len ? POLLOUT : 0);
+        }
+
+        if (poll(fds, config->connections + 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Erro no poll");
+            exit(1);
+        }
+
+        if (fds[0].revents != 0) {
+            read_input(batch);
+        }
+        for (int i = 0; i < config->connections; i++) {
+            if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+                handle_input(batch, &conns[i]);
+            }
+        }
+    }
+
+    fflush(stdout);
+    fprintf(stderr, "%lu comandos respondidos, %lu ignorados, %lu sem resposta\n",
+            batch->answered, batch->skipped, batch->failed);
+    int status = batch->skipped > 0 || batch->failed > 0 ? 1 : 0;
+
+    for (int i = 0; i < config->connections; i++) {
+        if (!conns[i].dead) {
+            close(conns[i].fd);
+        }
+    }
+    free(fds);
+    free(conns);
+    free(batch);
+    return status;
+}
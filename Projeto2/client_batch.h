@@ -0,0 +1,27 @@
+#ifndef CLIENT_BATCH_H
+#define CLIENT_BATCH_H
+
+#include <stdbool.h>
+
+// Modo batch do cliente: lê linhas "<VOTER_ID> <COMANDO>" de um arquivo ou
+// da entrada padrão e distribui as sessões entre um conjunto de conexões,
+// cada uma com até window pedidos em voo. Escreve uma linha JSON por
+// comando na saída padrão.
+
+#define BATCH_MAX_WINDOW 256
+
+typedef struct {
+    const char *host;
+    int port;
+    int connections;
+    int window;
+    bool binary;
+    const char *election;       // NULL: eleição padrão do servidor
+    int input_fd;
+} BatchConfig;
+
+// Processa a entrada até o fim. Retorna 0 se todos os comandos foram
+// respondidos pelo servidor ou 1 se algum foi ignorado ou perdido.
+int run_batch(const BatchConfig *config);
+
+#endif
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "binary_protocol.h"
+#include "client_protocol.h"
+
+// Copia o campo [start, end) para dst, truncando em MAX_OPTION_NAME
+static void copy_field(char *dst, const char *start, const char *end) {
+    size_t len = end - start;
+    if (len >= MAX_OPTION_NAME) {
+        len = MAX_OPTION_NAME - 1;
+    }
+    memcpy(dst, start, len);
+    dst[len] = '\0';
+}
+
+int parse_options(const char *line, char names[][MAX_OPTION_NAME]) {
+    size_t prefix = strlen(RESP_OPTIONS);
+    if (strncmp(line, RESP_OPTIONS, prefix) != 0 || line[prefix] != ' ') {
+        return -1;
+    }
+
+    int declared = atoi(line + prefix + 1);
+    int count = 0;
+    const char *field = strchr(line, '|');
+    while (field != NULL && count < declared && count < MAX_OPTIONS) {
+        field++;
+        const char *end = field + strcspn(field, "|\r\n");
+        copy_field(names[count++], field, end);
+        field = *end == '|' ? end : NULL;
+    }
+    return count;
+}
+
+int parse_score(const char *line, char names[][MAX_OPTION_NAME], uint64_t *counts, bool *final) {
+    const char *rest;
+    if (strncmp(line, RESP_CLOSED " ", strlen(RESP_CLOSED) + 1) == 0) {
+        *final = true;
+        rest = line + strlen(RESP_CLOSED) + 1;
+    } else if (strncmp(line, RESP_SCORE " ", strlen(RESP_SCORE) + 1) == 0) {
+        *final = false;
+        rest = line + strlen(RESP_SCORE) + 1;
+    } else {
+        return -1;
+    }
+
+    int declared = atoi(rest);
+    int count = 0;
+    const char *field = strchr(rest, '|');
+    while (field != NULL && count < declared && count < MAX_OPTIONS) {
+        field++;
+        const char *end = field + strcspn(field, "|\r\n");
+        // O nome pode conter ':'; a contagem vem depois do último
+        const char *colon = NULL;
+        for (const char *p = field; p < end; p++) {
+            if (*p == ':') {
+                colon = p;
+            }
+        }
+        if (colon == NULL) {
+            break;
+        }
+        copy_field(names[count], field, colon);
+        counts[count] = strtoull(colon + 1, NULL, 10);
+        count++;
+        field = *end == '|' ? end : NULL;
+    }
+    return count;
+}
+
+size_t encode_hello_frame(uint64_t voter_id, const char *election, uint8_t *frame) {
+    uint8_t *payload = frame + BIN_HEADER_SIZE;
+    size_t election_len = election ? strnlen(election, MAX_ELECTION_NAME - 1) : 0;
+
+    payload[0] = BIN_VERSION;
+    bin_put_u64(payload + 1, voter_id);
+    memcpy(payload + 9, election, election_len);
+    bin_put_header(frame, BIN_HELLO, 0, (uint16_t)(9 + election_len));
+    return BIN_HEADER_SIZE + 9 + election_len;
+}
+
+size_t encode_command(const char *command, uint8_t *frame) {
+    uint8_t *payload = frame + BIN_HEADER_SIZE;
+    size_t len = 0;
+    int option_num;
+
+    if (strcmp(command, CMD_LIST) == 0) {
+        bin_put_header(frame, BIN_LIST, 0, 0);
+    } else if (strcmp(command, CMD_SCORE) == 0) {
+        bin_put_header(frame, BIN_SCORE, 0, 0);
+    } else if (strcmp(command, CMD_BYE) == 0) {
+        bin_put_header(frame, BIN_BYE, 0, 0);
+    } else if (strcmp(command, CMD_WATCH) == 0 || strcmp(command, CMD_UNWATCH) == 0) {
+        payload[0] = strcmp(command, CMD_WATCH) == 0;
+        len = 1;
+        bin_put_header(frame, BIN_WATCH, 0, 1);
+    } else if (sscanf(command, "VOTE %d", &option_num) == 1) {
+        // Números fora da faixa viram um índice que o servidor rejeita
+        len = bin_put_varint(payload, option_num > 0 ? (uint64_t)(option_num - 1) : UINT32_MAX);
+        bin_put_header(frame, BIN_VOTE, 0, (uint16_t)len);
+    } else {
+        return 0;
+    }
+    return BIN_HEADER_SIZE + len;
+}
+
+void decode_response(const uint8_t *frame, char names[][MAX_OPTION_NAME], int *num_names, char *line) {
+    const uint8_t *payload = frame + BIN_HEADER_SIZE;
+    size_t payload_len = bin_get_u16(frame + 2);
+    // Um varint truncado não escreve o valor: lê como 0
+    uint64_t value = 0;
+    size_t pos;
+
+    switch (frame[0]) {
+    case BIN_WELCOME:
+        sprintf(line, "%s %llu", RESP_WELCOME, (unsigned long long)bin_get_u64(payload));
+        break;
+    case BIN_OPTIONS:
+        pos = bin_get_varint(payload, payload_len, &value);
+        *num_names = 0;
+        line += sprintf(line, "%s %d", RESP_OPTIONS, (int)value);
+        for (uint64_t i = 0; i < value && i < MAX_OPTIONS; i++) {
+            uint64_t name_len = 0;
+            pos += bin_get_varint(payload + pos, payload_len - pos, &name_len);
+            if (name_len >= MAX_OPTION_NAME || pos + name_len > payload_len) {
+                break;
+            }
+            memcpy(names[i], payload + pos, name_len);
+            names[i][name_len] = '\0';
+            pos += name_len;
+            (*num_names)++;
+            line += sprintf(line, "|%s", names[i]);
+        }
+        break;
+    case BIN_VOTED:
+        bin_get_varint(payload, payload_len, &value);
+        sprintf(line, "%s %s", RESP_OK_VOTED, value < (uint64_t)*num_names ? names[value] : "?");
+        break;
+    case BIN_SCORE_RESP:
+        pos = bin_get_varint(payload, payload_len, &value);
+        line += sprintf(line, "%s %d", (frame[1] & BIN_FLAG_FINAL) ? RESP_CLOSED : RESP_SCORE, (int)value);
+        for (uint64_t i = 0; i < value && pos + 4 <= payload_len; i++, pos += 4) {
+            line += sprintf(line, "|%s:%u", i < (uint64_t)*num_names ? names[i] : "?",
+                            bin_get_u32(payload + pos));
+        }
+        break;
+    case BIN_WATCH_RESP:
+        strcpy(line, payload_len > 0 && payload[0] ? RESP_WATCHING : RESP_UNWATCHED);
+        break;
+    case BIN_BYE_RESP:
+        strcpy(line, RESP_BYE);
+        break;
+    case BIN_ERROR:
+        switch (payload_len > 0 ? payload[0] : 0) {
+        case BIN_ERR_DUPLICATE: strcpy(line, RESP_ERR_DUPLICATE); break;
+        case BIN_ERR_INVALID_OPTION: strcpy(line, RESP_ERR_INVALID); break;
+        case BIN_ERR_CLOSED: strcpy(line, RESP_ERR_CLOSED); break;
+        case BIN_ERR_NOT_AUTHENTICATED: strcpy(line, "ERR NOT_AUTHENTICATED"); break;
+        case BIN_ERR_UNKNOWN_COMMAND: strcpy(line, "ERR UNKNOWN_COMMAND"); break;
+        case BIN_ERR_UNKNOWN_ELECTION: strcpy(line, RESP_ERR_UNKNOWN_ELECTION); break;
+        case BIN_ERR_BUSY: strcpy(line, RESP_ERR_BUSY); break;
+        case BIN_ERR_UNAVAILABLE: strcpy(line, RESP_ERR_UNAVAILABLE); break;
+        case BIN_ERR_TIMEOUT: strcpy(line, RESP_ERR_TIMEOUT); break;
+        case BIN_ERR_NOT_ELIGIBLE: strcpy(line, RESP_ERR_NOT_ELIGIBLE); break;
+        default: strcpy(line, "ERR BAD_FRAME"); break;
+        }
+        break;
+    default:
+        sprintf(line, "Quadro desconhecido 0x%02x", frame[0]);
+        break;
+    }
+}
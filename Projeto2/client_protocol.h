@@ -0,0 +1,32 @@
+#ifndef CLIENT_PROTOCOL_H
+#define CLIENT_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "protocol.h"
+
+// Interpretação das respostas do servidor no lado do cliente (client e
+// bench). As linhas não incluem o \n final.
+
+// "OPTIONS k|nome1|...|nomek". Retorna k ou -1 se a linha não é OPTIONS.
+int parse_options(const char *line, char names[][MAX_OPTION_NAME]);
+
+// "SCORE k|nome:votos|..." ou "CLOSED FINAL k|nome:votos|...". Retorna k
+// ou -1 se a linha não é um placar. *final indica CLOSED FINAL.
+int parse_score(const char *line, char names[][MAX_OPTION_NAME], uint64_t *counts, bool *final);
+
+// Quadro BIN_HELLO com o VOTER_ID numérico e, se election não for NULL,
+// o nome da eleição. Retorna o tamanho do quadro.
+size_t encode_hello_frame(uint64_t voter_id, const char *election, uint8_t *frame);
+
+// Traduz um comando de texto (sem HELLO) para um quadro binário. Retorna o
+// tamanho do quadro ou 0 se o comando não existe no protocolo binário.
+size_t encode_command(const char *command, uint8_t *frame);
+
+// Converte um quadro de resposta na linha equivalente do protocolo de
+// texto. As respostas de VOTE e SCORE só trazem índices; os nomes vêm da
+// última resposta de LIST, guardada em names/num_names.
+void decode_response(const uint8_t *frame, char names[][MAX_OPTION_NAME], int *num_names, char *line);
+
+#endif
@@ -0,0 +1,731 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "cluster.h"
+#include "election.h"
+
+// Espaço da leitora além da maior resposta
+#define PEER_READ_SLACK MAX_BUFFER
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static struct timespec deadline_after(int timeout_ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static bool send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+// ---- Conexões com os vizinhos ----
+
+typedef struct {
+    PeerLink *link;
+    int fd;
+    size_t max_line;
+} PeerReader;
+
+// Conclui o pedido mais antigo com a linha recebida (ok) ou com falha
+static void complete(PeerLink *link, const char *line) {
+    PeerRequest *req = link->head;
+    if (req == NULL) {
+        return;
+    }
+    link->head = req->next;
+    if (link->head == NULL) {
+        link->tail = NULL;
+    }
+    if (line != NULL) {
+        snprintf(req->response, req->size, "%s", line);
+        req->ok = true;
+    }
+    req->done = true;
+    pthread_cond_signal(&req->cond);
+}
+
+// Lê as respostas de um vizinho, na ordem dos pedidos
+static void *peer_reader(void *arg) {
+    PeerReader *reader = (PeerReader *)arg;
+    PeerLink *link = reader->link;
+    size_t cap = reader->max_line + PEER_READ_SLACK;
+    char *buf = malloc(cap);
+    size_t len = 0;
+
+    while (buf != NULL) {
+        ssize_t n = recv(reader->fd, buf + len, cap - len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        len += n;
+
+        size_t start = 0;
+        char *newline;
+        pthread_mutex_lock(&link->lock);
+        while ((newline = memchr(buf + start, '\n', len - start)) != NULL) {
+            *newline = '\0';
+            complete(link, buf + start);
+            start = newline - buf + 1;
+        }
+        pthread_mutex_unlock(&link->lock);
+        memmove(buf, buf + start, len - start);
+        len -= start;
+        if (len == cap) {
+            break;      // linha maior que qualquer resposta: protocolo quebrado
+        }
+    }
+
+    // Os pedidos pendentes falham; o próximo envio reconecta
+    shutdown(reader->fd, SHUT_RDWR);
+    pthread_mutex_lock(&link->lock);
+    link->broken = true;
+    link->reader_fd = -1;
+    while (link->head != NULL) {
+        complete(link, NULL);
+    }
+    pthread_mutex_unlock(&link->lock);
+    free(buf);
+    free(reader);
+    return NULL;
+}
+
+// connect() com prazo: não bloqueante, esperando o fim com poll
+static bool connect_timeout(int fd, const struct sockaddr_in *addr, int timeout_ms) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        return false;
+    }
+    if (connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) < 0) {
+        if (errno != EINPROGRESS) {
+            return false;
+        }
+        struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+        int ready;
+        do {
+            ready = poll(&pfd, 1, timeout_ms);
+        } while (ready < 0 && errno == EINTR);
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (ready <= 0 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+            return false;
+        }
+    }
+    return fcntl(fd, F_SETFL, flags) == 0;
+}
+
+// Conecta ao vizinho e inicia a leitora (send_lock já adquirido). Depois de
+// uma falha, novas tentativas falham direto por PEER_RETRY_MS: um nó fora do
+// ar não custa o prazo de conexão a cada voto encaminhado.
+static int peer_connect(Cluster *cluster, PeerLink *link) {
+    if (now_ns() < link->retry_ns) {
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (!connect_timeout(fd, &link->addr, PEER_CONNECT_TIMEOUT_MS)) {
+        close(fd);
+        link->retry_ns = now_ns() + PEER_RETRY_MS * 1000000ULL;
+        return -1;
+    }
+    // Pedidos pequenos em pipeline: sem esperar o Nagle. Um vizinho que
+    // para de ler não prende o envio além do prazo de um pedido.
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval send_timeout = {.tv_sec = PEER_REQUEST_TIMEOUT_MS / 1000,
+                                   .tv_usec = (PEER_REQUEST_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+    PeerReader *reader = malloc(sizeof(PeerReader));
+    pthread_t thread;
+    if (reader == NULL) {
+        close(fd);
+        return -1;
+    }
+    reader->link = link;
+    reader->fd = fd;
+    reader->max_line = cluster->server->max_response;
+    pthread_mutex_lock(&link->lock);
+    link->reader_fd = fd;
+    pthread_mutex_unlock(&link->lock);
+    if (pthread_create(&thread, NULL, peer_reader, reader) != 0) {
+        pthread_mutex_lock(&link->lock);
+        link->reader_fd = -1;
+        pthread_mutex_unlock(&link->lock);
+        free(reader);
+        close(fd);
+        return -1;
+    }
+    pthread_detach(thread);
+    link->fd = fd;
+    return 0;
+}
+
+// Envia o pedido (line termina em \n) sem esperar a resposta
+static void peer_submit(Cluster *cluster, int node, const char *line, PeerRequest *req) {
+    PeerLink *link = &cluster->links[node];
+    req->done = false;
+    req->ok = false;
+    req->next = NULL;
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&req->cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_mutex_lock(&link->send_lock);
+    pthread_mutex_lock(&link->lock);
+    bool broken = link->broken;
+    link->broken = false;
+    pthread_mutex_unlock(&link->lock);
+    if (broken && link->fd >= 0) {
+        close(link->fd);
+        link->fd = -1;
+    }
+    if (link->fd < 0 && peer_connect(cluster, link) < 0) {
+        pthread_mutex_unlock(&link->send_lock);
+        req->done = true;
+        return;
+    }
+
+    // A leitora da conexão atual pode ter acabado de falhar: nesse caso o
+    // pedido não entra na fila
+    pthread_mutex_lock(&link->lock);
+    if (link->broken) {
+        req->done = true;
+    } else if (link->tail != NULL) {
+        link->tail->next = req;
+        link->tail = req;
+    } else {
+        link->head = link->tail = req;
+    }
+    pthread_mutex_unlock(&link->lock);
+
+    if (!req->done && !send_all(link->fd, line, strlen(line))) {
+        shutdown(link->fd, SHUT_RDWR);
+    }
+    pthread_mutex_unlock(&link->send_lock);
+}
+
+// Espera a resposta de peer_submit. Retorna false se o vizinho não respondeu
+// em PEER_REQUEST_TIMEOUT_MS: o pedido está na pilha de quem pediu e não
+// pode sair do meio da fila, então a conexão é derrubada e a leitora falha
+// todos os pendentes (este inclusive) logo em seguida.
+static bool peer_wait(Cluster *cluster, int node, PeerRequest *req) {
+    PeerLink *link = &cluster->links[node];
+    struct timespec deadline = deadline_after(PEER_REQUEST_TIMEOUT_MS);
+    bool expired = false;
+    pthread_mutex_lock(&link->lock);
+    while (!req->done) {
+        if (expired) {
+            pthread_cond_wait(&req->cond, &link->lock);
+        } else if (pthread_cond_timedwait(&req->cond, &link->lock, &deadline) == ETIMEDOUT && !req->done) {
+            expired = true;
+            if (link->reader_fd >= 0) {
+                shutdown(link->reader_fd, SHUT_RDWR);
+            }
+        }
+    }
+    pthread_mutex_unlock(&link->lock);
+    pthread_cond_destroy(&req->cond);
+    return req->ok;
+}
+
+// ---- Totais de todos os nós ----
+
+// "TALLY <final> <votantes> <hash> <k> <votos>..." de um vizinho
+static bool parse_tally(Election *election, const char *line, uint64_t *counts, uint64_t *voters, bool *final) {
+    int final_flag, k, used;
+    unsigned long long voter_count, hash;
+    if (sscanf(line, RESP_TALLY " %d %llu %llx %d%n", &final_flag, &voter_count, &hash, &k, &used) != 4 ||
+        hash != election->options_hash || k != election->num_options) {
+        return false;
+    }
+    line += used;
+    for (int i = 0; i < k; i++) {
+        char *end;
+        counts[i] = strtoull(line, &end, 10);
+        if (end == line) {
+            return false;
+        }
+        line = end;
+    }
+    *voters = voter_count;
+    *final = *final || final_flag;
+    return true;
+}
+
+// Relê os totais de todos os nós (pedidos em paralelo) e serializa o placar
+// somado. Um nó que não responde entra com os últimos totais conhecidos.
+// Chamada com o lock do placar e sem outra releitura em curso; o lock é
+// solto durante a rodada de rede, em que counts, voters e replies são só
+// desta thread, e readquirido para publicar. Retorna os nós que não
+// responderam (bit por nó); com algum faltando o placar nunca é final.
+static uint32_t refresh(Cluster *cluster, Election *election, ClusterTally *tally) {
+    tally->refreshing = true;
+    pthread_mutex_unlock(&tally->lock);
+
+    uint64_t start = now_ns();
+    size_t max_line = cluster->server->max_response;
+    PeerRequest requests[CLUSTER_MAX_NODES];
+    char line[MAX_ELECTION_NAME + 16];
+    snprintf(line, sizeof(line), CMD_PEER_TALLY " %s\n", election->name);
+
+    for (int node = 0; node < cluster->num_nodes; node++) {
+        if (node != cluster->self) {
+            requests[node].response = tally->replies + node * max_line;
+            requests[node].size = max_line;
+            peer_submit(cluster, node, line, &requests[node]);
+        }
+    }
+
+    int k = election->num_options;
+    bool final = atomic_load(&election->closed);
+    tally_snapshot(&election->tally, tally->counts + cluster->self * k, NULL);
+    tally->voters[cluster->self] = voter_table_count(&election->voters);
+
+    uint32_t missing = 0;
+    for (int node = 0; node < cluster->num_nodes; node++) {
+        if (node == cluster->self) {
+            continue;
+        }
+        if (!peer_wait(cluster, node, &requests[node]) ||
+            !parse_tally(election, requests[node].response, tally->counts + node * k,
+                         &tally->voters[node], &final)) {
+            LOG_ERROR(election, "Cluster: nó %d não respondeu aos totais de %s (%s)", node, election->name,
+                      requests[node].ok ? requests[node].response : "sem conexão");
+            missing |= 1u << node;
+        }
+    }
+
+    pthread_mutex_lock(&tally->lock);
+    memset(tally->totals, 0, k * sizeof(uint64_t));
+    for (int node = 0; node < cluster->num_nodes; node++) {
+        for (int i = 0; i < k; i++) {
+            tally->totals[i] += tally->counts[node * k + i];
+        }
+    }
+    final = final && missing == 0;
+    tally->final = final;
+    tally->missing = missing;
+    tally->fetched_ns = now_ns();
+    aggregate_record(&cluster->tcp_stats, tally->fetched_ns - start);
+    response_cache_format_score(&election->responses, tally->totals, final, 0, tally->text, &tally->text_len,
+                                tally->binary, &tally->binary_len);
+    tally->refreshing = false;
+    pthread_cond_broadcast(&tally->refreshed);
+    return missing;
+}
+
+// Totais atualizados (lock do placar já adquirido). O fim da eleição
+// ignora o TTL, a não ser que a última releitura tenha ficado sem algum
+// nó; com totais externos só o estado final é atualizado aqui (antes da
+// primeira publicação vale o FTALLY). Com outra thread relendo valem os
+// totais anteriores, e só se ainda não houver nenhum espera a releitura.
+static void current_totals(Cluster *cluster, Election *election, ClusterTally *tally) {
+    bool closed = atomic_load(&election->closed);
+    if (cluster->external_totals && tally->fetched_ns != 0) {
+        if (closed && !tally->final) {
+            tally->final = true;
+            response_cache_format_score(&election->responses, tally->totals, true, 0, tally->text,
+                                        &tally->text_len, tally->binary, &tally->binary_len);
+        }
+        return;
+    }
+    while (tally->fetched_ns == 0 || now_ns() - tally->fetched_ns >= cluster->ttl_ns ||
+           (closed && !tally->final && tally->missing == 0)) {
+        if (!tally->refreshing) {
+            refresh(cluster, election, tally);
+            return;
+        }
+        if (tally->fetched_ns != 0) {
+            return;
+        }
+        pthread_cond_wait(&tally->refreshed, &tally->lock);
+    }
+}
+
+void cluster_set_totals(Cluster *cluster, Election *election, const uint64_t *totals, bool final) {
+    ClusterTally *tally = &cluster->tallies[election->index];
+    pthread_mutex_lock(&tally->lock);
+    memcpy(tally->totals, totals, election->num_options * sizeof(uint64_t));
+    tally->final = final || atomic_load(&election->closed);
+    tally->fetched_ns = now_ns();
+    response_cache_format_score(&election->responses, tally->totals, tally->final, 0, tally->text,
+                                &tally->text_len, tally->binary, &tally->binary_len);
+    pthread_mutex_unlock(&tally->lock);
+}
+
+void aggregate_record(AggregateStats *stats, uint64_t elapsed_ns) {
+    atomic_fetch_add_explicit(&stats->rounds, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->total_ns, elapsed_ns, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&stats->max_ns, memory_order_relaxed);
+    while (elapsed_ns > max &&
+           !atomic_compare_exchange_weak_explicit(&stats->max_ns, &max, elapsed_ns,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+size_t cluster_score(Cluster *cluster, Election *election, bool binary, void *out) {
+    ClusterTally *tally = &cluster->tallies[election->index];
+    pthread_mutex_lock(&tally->lock);
+    current_totals(cluster, election, tally);
+    size_t len = binary ? tally->binary_len : tally->text_len;
+    memcpy(out, binary ? (const void *)tally->binary : tally->text, len);
+    pthread_mutex_unlock(&tally->lock);
+    return len;
+}
+
+uint64_t cluster_watch_counts(void *ctx, uint64_t *counts) {
+    Election *election = (Election *)ctx;
+    ClusterTally *tally = &election->cluster->tallies[election->index];
+    uint64_t version = 0;
+
+    pthread_mutex_lock(&tally->lock);
+    current_totals(election->cluster, election, tally);
+    for (int i = 0; i < election->num_options; i++) {
+        counts[i] = tally->totals[i];
+        version += counts[i];
+    }
+    pthread_mutex_unlock(&tally->lock);
+    return version;
+}
+
+// ---- Votos e encerramento ----
+
+VoteResult cluster_forward_vote(Cluster *cluster, Election *election, const char *voter_id, int option_index) {
+    int owner = cluster_owner(cluster, voter_hash(voter_id));
+    char line[MAX_ELECTION_NAME + MAX_VOTER_ID + 32];
+    char response[MAX_BUFFER];
+    PeerRequest request = {.response = response, .size = sizeof(response)};
+
+    snprintf(line, sizeof(line), CMD_PEER_VOTE " %s %s %d\n", election->name, voter_id, option_index + 1);
+    peer_submit(cluster, owner, line, &request);
+    if (!peer_wait(cluster, owner, &request)) {
+        LOG_ERROR(election, "Cluster: voto de %s não encaminhado ao nó %d", voter_id, owner);
+        return VOTE_UNAVAILABLE;
+    }
+
+    LOG_DEBUG(election, "Voto de %s encaminhado ao nó %d: %s", voter_id, owner, response);
+    if (strncmp(response, RESP_OK_VOTED, strlen(RESP_OK_VOTED)) == 0) {
+        return VOTE_RECORDED;
+    }
+    if (strcmp(response, RESP_ERR_DUPLICATE) == 0) {
+        return VOTE_DUPLICATE;
+    }
+    if (strcmp(response, RESP_ERR_INVALID) == 0) {
+        return VOTE_INVALID_OPTION;
+    }
+    if (strcmp(response, RESP_ERR_CLOSED) == 0) {
+        return VOTE_CLOSED;
+    }
+    return VOTE_UNAVAILABLE;
+}
+
+bool cluster_close(Cluster *cluster, Election *election) {
+    close_election(election);
+    if (cluster->external_totals) {
+        // server_mpi: o encerramento chega aos outros ranks na próxima
+        // redução, e o rank 0 grava o resultado somado
+        return true;
+    }
+
+    // Este nó coordena: o resultado somado substitui o da sua partição. Os
+    // nós que não confirmaram o FCLOSE ou não mandaram os totais são
+    // tentados de novo algumas vezes; os totais são copiados e o lock é
+    // solto antes de gravar.
+    ClusterTally *tally = &cluster->tallies[election->index];
+    uint64_t *totals = malloc(election->num_options * sizeof(uint64_t));
+    if (totals == NULL) {
+        LOG_ERROR(election, "Cluster: sem memória para o resultado somado de %s", election->name);
+        return false;
+    }
+    uint32_t unconfirmed = ((1u << cluster->num_nodes) - 1) & ~(1u << cluster->self);
+    uint32_t missing = 0;
+    uint64_t voters = 0;
+    char line[MAX_ELECTION_NAME + 16];
+    snprintf(line, sizeof(line), CMD_PEER_CLOSE " %s\n", election->name);
+
+    for (int attempt = 1; attempt <= CLUSTER_CLOSE_ATTEMPTS; attempt++) {
+        PeerRequest requests[CLUSTER_MAX_NODES];
+        char responses[CLUSTER_MAX_NODES][64];
+        for (int node = 0; node < cluster->num_nodes; node++) {
+            if (unconfirmed & (1u << node)) {
+                requests[node].response = responses[node];
+                requests[node].size = sizeof(responses[node]);
+                peer_submit(cluster, node, line, &requests[node]);
+            }
+        }
+        for (int node = 0; node < cluster->num_nodes; node++) {
+            if (!(unconfirmed & (1u << node))) {
+                continue;
+            }
+            if (peer_wait(cluster, node, &requests[node]) && strcmp(responses[node], "OK ELECTION_CLOSED") == 0) {
+                unconfirmed &= ~(1u << node);
+            } else {
+                LOG_ERROR(election, "Cluster: nó %d não confirmou o encerramento de %s (tentativa %d)", node,
+                          election->name, attempt);
+            }
+        }
+
+        pthread_mutex_lock(&tally->lock);
+        while (tally->refreshing) {
+            pthread_cond_wait(&tally->refreshed, &tally->lock);
+        }
+        missing = refresh(cluster, election, tally) | unconfirmed;
+        voters = 0;
+        for (int node = 0; node < cluster->num_nodes; node++) {
+            voters += tally->voters[node];
+        }
+        memcpy(totals, tally->totals, election->num_options * sizeof(uint64_t));
+        pthread_mutex_unlock(&tally->lock);
+        if (missing == 0) {
+            break;
+        }
+    }
+
+    char note[96];
+    if (missing == 0) {
+        snprintf(note, sizeof(note), "Cluster: soma dos %d nós (coordenador: nó %d)", cluster->num_nodes,
+                 cluster->self);
+    } else {
+        // Sem algum nó a soma não é o resultado do cluster: fica marcada
+        int len = snprintf(note, sizeof(note), "Cluster: RESULTADO PARCIAL, sem os nós");
+        for (int node = 0; node < cluster->num_nodes; node++) {
+            if (missing & (1u << node)) {
+                len += snprintf(note + len, sizeof(note) - len, " %d", node);
+            }
+        }
+        LOG_ERROR(election, "Cluster: resultado de %s gravado como parcial", election->name);
+    }
+    save_results(election, totals, voters, note);
+    free(totals);
+    return missing == 0;
+}
+
+// ---- Porta de peers ----
+
+// Eleição do comando; espera o journal da eleição anterior da conexão antes
+// de trocar, como no HELLO (o LSN retido é de um journal só)
+static Election *peer_election(Cluster *cluster, Session *session, const char *name) {
+    Election *election = find_election(cluster->server, name);
+    if (election != NULL && session->election != election) {
+        if (session->election != NULL) {
+            journal_wait(&session->election->journal, session->durable_lsn);
+            session->durable_lsn = 0;
+        }
+        session->election = election;
+    }
+    return election;
+}
+
+SessionAction cluster_peer_command(Cluster *cluster, Session *session, const char *command, char *response) {
+    char name[MAX_ELECTION_NAME] = {0};
+    char voter_id[MAX_VOTER_ID] = {0};
+    int option_num = 0;
+    Election *election;
+
+    if (sscanf(command, CMD_PEER_VOTE " %31s %63s %d", name, voter_id, &option_num) == 3) {
+        if ((election = peer_election(cluster, session, name)) == NULL) {
+            sprintf(response, "%s\n", RESP_ERR_UNKNOWN_ELECTION);
+            return SESSION_CONTINUE;
+        }
+        // A resposta sai depois do journal gravar (send_pending); eleição
+        // encerrada é recusada por record_vote
+        uint64_t lsn;
+        VoteResult result = record_vote(election, voter_id, voter_hash(voter_id), option_num - 1, &lsn);
+        if (lsn > session->durable_lsn) {
+            session->durable_lsn = lsn;
+        }
+        format_vote_response(election, result, option_num - 1, response);
+    } else if (sscanf(command, CMD_PEER_TALLY " %31s", name) == 1) {
+        if ((election = find_election(cluster->server, name)) == NULL) {
+            sprintf(response, "%s\n", RESP_ERR_UNKNOWN_ELECTION);
+            return SESSION_CONTINUE;
+        }
+        // Os contadores por opção ficam logo depois do cabeçalho
+        uint64_t *counts = malloc(election->num_options * sizeof(uint64_t));
+        if (counts == NULL) {
+            sprintf(response, "ERR NO_MEMORY\n");
+            return SESSION_CONTINUE;
+        }
+        bool final = atomic_load(&election->closed);
+        tally_snapshot(&election->tally, counts, NULL);
+        char *p = response + sprintf(response, RESP_TALLY " %d %zu %llx %d", final,
+                                     voter_table_count(&election->voters),
+                                     (unsigned long long)election->options_hash, election->num_options);
+        for (int i = 0; i < election->num_options; i++) {
+            p += sprintf(p, " %llu", (unsigned long long)counts[i]);
+        }
+        strcpy(p, "\n");
+        free(counts);
+    } else if (sscanf(command, CMD_PEER_CLOSE " %31s", name) == 1) {
+        if ((election = find_election(cluster->server, name)) == NULL) {
+            sprintf(response, "%s\n", RESP_ERR_UNKNOWN_ELECTION);
+            return SESSION_CONTINUE;
+        }
+        if (!atomic_load(&election->closed)) {
+            LOG_INFO(election, "Eleição %s encerrada pelo coordenador do cluster", election->name);
+            close_election(election);
+        }
+        sprintf(response, "OK ELECTION_CLOSED\n");
+    } else {
+        sprintf(response, "ERR UNKNOWN_COMMAND\n");
+    }
+    return SESSION_CONTINUE;
+}
+
+// Aceita as conexões dos vizinhos, cada uma com sua thread: o atendimento
+// de um pedido nunca espera outro nó, então os nós não travam uns aos
+// outros mesmo com todos os loops esperando respostas
+static void *listener_thread(void *arg) {
+    Cluster *cluster = (Cluster *)arg;
+
+    while (1) {
+        int client_socket = accept(cluster->listen_socket, NULL, NULL);
+        if (client_socket < 0) {
+            if (errno != EINTR) {
+                perror("Erro no accept de peers");
+            }
+            continue;
+        }
+        int one = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        ClientData *client_data = malloc(sizeof(ClientData));
+        pthread_t thread;
+        if (client_data == NULL) {
+            close(client_socket);
+            continue;
+        }
+        client_data->socket = client_socket;
+        client_data->server = cluster->server;
+        client_data->peer = true;
+        if (pthread_create(&thread, NULL, handle_client, client_data) != 0) {
+            close(client_socket);
+            free(client_data);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+// ---- Configuração ----
+
+Cluster *cluster_create(ElectionServer *server, const char *nodes, int self, unsigned long ttl_ms) {
+    Cluster *cluster = calloc(1, sizeof(Cluster));
+    char *list = strdup(nodes);
+    if (cluster == NULL || list == NULL) {
+        perror("Erro ao alocar cluster");
+        exit(1);
+    }
+    cluster->server = server;
+    cluster->self = self;
+    cluster->ttl_ns = ttl_ms * 1000000ULL;
+
+    char *save = NULL;
+    for (char *node = strtok_r(list, ",", &save); node != NULL; node = strtok_r(NULL, ",", &save)) {
+        char *colon = strrchr(node, ':');
+        if (cluster->num_nodes == CLUSTER_MAX_NODES || colon == NULL || atoi(colon + 1) <= 0) {
+            fprintf(stderr, "Cluster inválido: %s (use host:porta,... com até %d nós)\n", nodes,
+                    CLUSTER_MAX_NODES);
+            exit(1);
+        }
+        *colon = '\0';
+
+        PeerLink *link = &cluster->links[cluster->num_nodes];
+        link->addr.sin_family = AF_INET;
+        link->addr.sin_port = htons(atoi(colon + 1));
+        if (inet_pton(AF_INET, node, &link->addr.sin_addr) <= 0) {
+            if (strcmp(node, "localhost") != 0) {
+                fprintf(stderr, "Endereço inválido no cluster: %s\n", node);
+                exit(1);
+            }
+            link->addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        }
+        link->fd = -1;
+        link->reader_fd = -1;
+        pthread_mutex_init(&link->send_lock, NULL);
+        pthread_mutex_init(&link->lock, NULL);
+        cluster->num_nodes++;
+    }
+    free(list);
+
+    if (self < 0 || self >= cluster->num_nodes) {
+        fprintf(stderr, "Nó %d fora do cluster de %d nós\n", self, cluster->num_nodes);
+        exit(1);
+    }
+    cluster->peer_port = ntohs(cluster->links[self].addr.sin_port);
+    return cluster;
+}
+
+void cluster_start(Cluster *cluster) {
+    ElectionServer *server = cluster->server;
+    cluster->tallies = calloc(server->num_elections, sizeof(ClusterTally));
+    if (cluster->tallies == NULL) {
+        perror("Erro ao alocar cluster");
+        exit(1);
+    }
+    for (int i = 0; i < server->num_elections; i++) {
+        ClusterTally *tally = &cluster->tallies[i];
+        size_t k = server->elections[i]->num_options;
+        size_t max_len = server->elections[i]->responses.max_len;
+        pthread_mutex_init(&tally->lock, NULL);
+        pthread_cond_init(&tally->refreshed, NULL);
+        tally->counts = calloc(cluster->num_nodes * k, sizeof(uint64_t));
+        tally->voters = calloc(cluster->num_nodes, sizeof(uint64_t));
+        tally->totals = calloc(k, sizeof(uint64_t));
+        tally->replies = malloc(cluster->num_nodes * server->max_response);
+        tally->text = malloc(max_len);
+        tally->binary = malloc(max_len);
+        if (tally->counts == NULL || tally->voters == NULL || tally->totals == NULL ||
+            tally->replies == NULL || tally->text == NULL || tally->binary == NULL) {
+            perror("Erro ao alocar cluster");
+            exit(1);
+        }
+    }
+
+    cluster->listen_socket = create_listen_socket(cluster->peer_port, SOMAXCONN, false);
+    if (pthread_create(&cluster->listener, NULL, listener_thread, cluster) != 0) {
+        perror("Erro ao criar thread de peers");
+        exit(1);
+    }
+    pthread_detach(cluster->listener);
+    LOG_INFO(server, "Cluster: nó %d de %d, peers na porta %d", cluster->self, cluster->num_nodes,
+             cluster->peer_port);
+}
@@ -0,0 +1,147 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include "server.h"
+
+// Modo cluster: vários processos servidor repartem os votantes pelo hash
+// do VOTER_ID (o nó dono é hash % número de nós). Cada nó aceita clientes
+// normalmente; o VOTE de um votante de outro nó é encaminhado ao dono, e o
+// SCORE soma os totais de todos os nós. Os nós conversam numa porta
+// própria (a porta de peers, da lista --cluster), em texto, por uma conexão
+// persistente com cada vizinho usada em pipeline por todas as threads:
+//
+//   FVOTE <eleição> <VOTER_ID> <opção>  -> a mesma resposta do VOTE
+//   FTALLY <eleição>                    -> TALLY <final> <votantes> <hash> <k> <votos>...
+//   FCLOSE <eleição>                    -> OK ELECTION_CLOSED
+#define CLUSTER_MAX_NODES 16
+#define CMD_PEER_VOTE "FVOTE"
+#define CMD_PEER_TALLY "FTALLY"
+#define CMD_PEER_CLOSE "FCLOSE"
+#define RESP_TALLY "TALLY"
+
+// Prazos com um vizinho: conexão, resposta a um pedido (e envio) e espera
+// antes de tentar reconectar a um nó que recusou a conexão
+#define PEER_CONNECT_TIMEOUT_MS 500
+#define PEER_REQUEST_TIMEOUT_MS 1000
+#define PEER_RETRY_MS 1000
+
+// Rodadas de FCLOSE e FTALLY do ADMIN CLOSE antes de gravar o resultado
+// como parcial
+#define CLUSTER_CLOSE_ATTEMPTS 3
+
+// Pedido a um vizinho, esperando a resposta (na pilha de quem pediu)
+typedef struct PeerRequest {
+    char *response;             // linha da resposta, sem \n
+    size_t size;
+    bool done;
+    bool ok;                    // false: conexão perdida antes da resposta
+    pthread_cond_t cond;
+    struct PeerRequest *next;
+} PeerRequest;
+
+// Conexão com um vizinho. send_lock ordena os envios (a ordem da fila é a
+// ordem no socket); lock protege a fila, que a thread leitora esvazia
+// casando cada linha recebida com o pedido mais antigo. Um envio bloqueado
+// nunca impede a leitora de avançar. Um pedido sem resposta no prazo
+// derruba a conexão (as respostas seguintes não casariam mais com a fila).
+typedef struct {
+    struct sockaddr_in addr;
+    pthread_mutex_t send_lock;
+    int fd;                     // -1: desconectado (só com send_lock)
+    uint64_t retry_ns;          // conexão recusada: falha direto até lá (só com send_lock)
+    pthread_mutex_t lock;
+    PeerRequest *head;
+    PeerRequest *tail;
+    int reader_fd;              // conexão da leitora ativa (-1: nenhuma)
+    bool broken;                // a leitora viu a conexão cair
+} PeerLink;
+
+// Totais de uma eleição em todos os nós, relidos no máximo uma vez por TTL.
+// A releitura corre fora do lock, por uma thread de cada vez (refreshing):
+// enquanto isso as outras servem os totais anteriores.
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t refreshed;   // fim de uma releitura
+    bool refreshing;
+    uint64_t fetched_ns;        // 0: nunca lidos
+    bool final;
+    uint32_t missing;           // nós sem resposta na última releitura (bit por nó)
+    uint64_t *counts;           // num_nodes x num_options (só de quem relê)
+    uint64_t *voters;           // votantes cadastrados por nó (só de quem relê)
+    uint64_t *totals;           // soma dos nós
+    char *replies;              // respostas dos vizinhos, max_response cada
+    char *text;                 // placar serializado (SCORE ou CLOSED FINAL)
+    size_t text_len;
+    uint8_t *binary;
+    size_t binary_len;
+} ClusterTally;
+
+// Custo da agregação dos totais (uma rodada = todos os nós somados)
+typedef struct {
+    _Atomic uint64_t rounds;
+    _Atomic uint64_t total_ns;
+    _Atomic uint64_t max_ns;
+} AggregateStats;
+
+typedef struct Cluster {
+    ElectionServer *server;
+    int num_nodes;
+    int self;
+    int peer_port;
+    uint64_t ttl_ns;
+    PeerLink links[CLUSTER_MAX_NODES];  // links[self] não é usado
+    ClusterTally *tallies;              // por eleição
+    AggregateStats tcp_stats;           // rodadas de FTALLY
+    AggregateStats mpi_stats;           // rodadas de MPI_Iallreduce (server_mpi)
+    int listen_socket;
+    pthread_t listener;
+
+    // Totais publicados por fora com cluster_set_totals (server_mpi): o
+    // SCORE não pede FTALLY e o ADMIN CLOSE não envia FCLOSE
+    bool external_totals;
+} Cluster;
+
+// Lê a lista "host:porta,host:porta,..." de todos os nós (a mesma em todos,
+// na mesma ordem) e o índice deste nó. Erros encerram o processo.
+Cluster *cluster_create(ElectionServer *server, const char *nodes, int self, unsigned long ttl_ms);
+
+// Depois de abrir as eleições: aloca os totais e começa a ouvir os vizinhos
+void cluster_start(Cluster *cluster);
+
+static inline int cluster_owner(const Cluster *cluster, uint64_t voter_hash) {
+    return (int)(voter_hash % (unsigned)cluster->num_nodes);
+}
+
+static inline bool cluster_owns(const Cluster *cluster, uint64_t voter_hash) {
+    return cluster_owner(cluster, voter_hash) == cluster->self;
+}
+
+// Encaminha o voto ao nó dono e espera a resposta (já gravada no journal
+// do dono). VOTE_UNAVAILABLE se o dono não responder no prazo.
+VoteResult cluster_forward_vote(Cluster *cluster, Election *election, const char *voter_id, int option_index);
+
+// Placar somado de todos os nós (até TTL atrasado) no protocolo pedido
+size_t cluster_score(Cluster *cluster, Election *election, bool binary, void *out);
+
+// Totais somados para o WATCH; retorna a versão (total de votos)
+uint64_t cluster_watch_counts(void *election, uint64_t *counts);
+
+// ADMIN CLOSE: encerra a eleição em todos os nós e grava aqui o resultado
+// somado (cada vizinho grava só o da sua partição). Retorna false se algum
+// nó não respondeu: o resultado gravado é marcado como parcial.
+bool cluster_close(Cluster *cluster, Election *election);
+
+// Publica totais somados por fora (server_mpi)
+void cluster_set_totals(Cluster *cluster, Election *election, const uint64_t *totals, bool final);
+
+void aggregate_record(AggregateStats *stats, uint64_t elapsed_ns);
+
+// Comandos recebidos na porta de peers
+SessionAction cluster_peer_command(Cluster *cluster, Session *session, const char *command, char *response);
+
+#endif
@@ -0,0 +1,304 @@
+#include <stdlib.h>
+#include <string.h>
+#include "connection.h"
+#include "binary_protocol.h"
+#include "metrics.h"
+
+void connection_init(Connection *conn, int fd) {
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = fd;
+    conn->watch_fd = -1;
+    conn->opened_ns = monotonic_ns();
+    conn->active_ns = conn->opened_ns;
+    METRIC_ADD(connections_opened, 1);
+}
+
+void connection_free(Connection *conn) {
+    METRIC_ADD(connections_closed, 1);
+    free(conn->out);
+    conn->out = NULL;
+    conn->out_cap = 0;
+    free(conn->send_buf);
+    conn->send_buf = NULL;
+    conn->send_cap = 0;
+    free(conn->spill);
+    conn->spill = NULL;
+    conn->spill_cap = 0;
+}
+
+// Garante espaço para mais len bytes de resposta
+static bool reserve_output(Connection *conn, size_t len) {
+    if (conn->out_len + len <= conn->out_cap) {
+        return true;
+    }
+    size_t new_cap = conn->out_cap ? conn->out_cap : 2 * MAX_BUFFER;
+    while (new_cap < conn->out_len + len) {
+        new_cap *= 2;
+    }
+    char *new_out = realloc(conn->out, new_cap);
+    if (new_out == NULL) {
+        return false;
+    }
+    conn->out = new_out;
+    conn->out_cap = new_cap;
+    return true;
+}
+
+bool connection_append_output(Connection *conn, const void *data, size_t len) {
+    if (!reserve_output(conn, len)) {
+        return false;
+    }
+    memcpy(conn->out + conn->out_len, data, len);
+    conn->out_len += len;
+    return true;
+}
+
+bool connection_append_input(Connection *conn, const void *data, size_t len) {
+    if (conn->spill_len == 0) {
+        size_t n = len < connection_input_space(conn) ? len : connection_input_space(conn);
+        memcpy(conn->in + conn->in_len, data, n);
+        conn->in_len += n;
+        data = (const char *)data + n;
+        len -= n;
+    }
+    if (len == 0) {
+        return true;
+    }
+    if (conn->spill_len + len > conn->spill_cap) {
+        size_t new_cap = conn->spill_cap ? conn->spill_cap : MAX_BUFFER;
+        while (new_cap < conn->spill_len + len) {
+            new_cap *= 2;
+        }
+        char *new_spill = realloc(conn->spill, new_cap);
+        if (new_spill == NULL) {
+            return false;
+        }
+        conn->spill = new_spill;
+        conn->spill_cap = new_cap;
+    }
+    memcpy(conn->spill + conn->spill_len, data, len);
+    conn->spill_len += len;
+    return true;
+}
+
+void connection_compact_output(Connection *conn) {
+    if (conn->out_sent == conn->out_len) {
+        conn->out_len = 0;
+        conn->out_sent = 0;
+    }
+}
+
+// Contabiliza o comando respondido para os histogramas de latência
+static void account_command(Connection *conn, SessionAction action) {
+    CommandStat stat = conn->session.last_command;
+    if (stat != STAT_NONE) {
+        if (conn->pending_total == 0) {
+            conn->batch_start = conn->last_recv;
+        }
+        conn->pending_stats[stat]++;
+        conn->pending_total++;
+    }
+    if (action == SESSION_CLOSE) {
+        conn->closing = true;
+    }
+}
+
+// Quadros binários: [tipo][flags][tamanho u16][payload]
+static size_t process_frames(ElectionServer *server, Connection *conn) {
+    size_t start = 0;
+
+    while (!conn->closing && connection_pending_output(conn) < OUT_HIGH_WATER &&
+           !connection_misplaced(server, conn)) {
+        const uint8_t *frame = (const uint8_t *)conn->in + start;
+        size_t available = conn->in_len - start;
+        if (available < BIN_HEADER_SIZE) {
+            break;
+        }
+        size_t frame_len = BIN_HEADER_SIZE + bin_get_u16(frame + 2);
+
+        if (!reserve_output(conn, server->max_response)) {
+            conn->closing = true;
+            break;
+        }
+        uint8_t *response = (uint8_t *)conn->out + conn->out_len;
+
+        // Quadro que nunca caberia no buffer de entrada: responde e fecha
+        if (frame_len > MAX_BUFFER - 1) {
+            bin_put_header(response, BIN_ERROR, 0, 1);
+            response[BIN_HEADER_SIZE] = BIN_ERR_BAD_FRAME;
+            conn->out_len += BIN_HEADER_SIZE + 1;
+            conn->closing = true;
+            return conn->in_len;
+        }
+        if (available < frame_len) {
+            break;
+        }
+
+        size_t response_len = 0;
+        SessionAction action = process_binary_frame(server, &conn->session, frame, frame_len,
+                                                     response, &response_len);
+        conn->out_len += response_len;
+        start += frame_len;
+        account_command(conn, action);
+    }
+    return start;
+}
+
+// Comandos de texto terminados em \n
+static size_t process_lines(ElectionServer *server, Connection *conn) {
+    size_t start = 0;
+
+    while (!conn->closing && connection_pending_output(conn) < OUT_HIGH_WATER &&
+           !connection_misplaced(server, conn)) {
+        char *line = conn->in + start;
+        char *newline = memchr(line, '\n', conn->in_len - start);
+
+        if (newline == NULL) {
+            // Linha maior que o buffer: processa o que chegou como um
+            // comando único para não travar a conexão
+            if (start == 0 && conn->in_len == MAX_BUFFER - 1) {
+                conn->in[conn->in_len] = '\0';
+                start = conn->in_len;
+            } else {
+                break;
+            }
+        } else {
+            *newline = '\0';
+            start = (newline - conn->in) + 1;
+        }
+
+        // A resposta é escrita direto no fim da fila de saída
+        if (!reserve_output(conn, server->max_response)) {
+            conn->closing = true;
+            break;
+        }
+        SessionAction action = process_command(server, &conn->session, line, conn->out + conn->out_len);
+        conn->out_len += strlen(conn->out + conn->out_len);
+        account_command(conn, action);
+    }
+    return start;
+}
+
+static void process_buffer(ElectionServer *server, Connection *conn) {
+    if (conn->in_len == 0) {
+        return;
+    }
+    if (conn->mode == PROTOCOL_UNKNOWN) {
+        conn->mode = (uint8_t)conn->in[0] >= 0x80 ? PROTOCOL_BINARY : PROTOCOL_TEXT;
+    }
+
+    size_t start = conn->mode == PROTOCOL_BINARY ? process_frames(server, conn)
+                                                 : process_lines(server, conn);
+
+    if (start > 0) {
+        memmove(conn->in, conn->in + start, conn->in_len - start);
+        conn->in_len -= start;
+        conn->active_ns = conn->last_recv;
+    }
+}
+
+void connection_process_input(ElectionServer *server, Connection *conn) {
+    process_buffer(server, conn);
+
+    // O que ficou no spill entra conforme os comandos liberam espaço
+    while (conn->spill_len > 0 && connection_input_space(conn) > 0 && !conn->closing &&
+           connection_pending_output(conn) < OUT_HIGH_WATER && !connection_misplaced(server, conn)) {
+        size_t n = conn->spill_len < connection_input_space(conn) ? conn->spill_len
+                                                                 : connection_input_space(conn);
+        memcpy(conn->in + conn->in_len, conn->spill, n);
+        conn->in_len += n;
+        memmove(conn->spill, conn->spill + n, conn->spill_len - n);
+        conn->spill_len -= n;
+        process_buffer(server, conn);
+    }
+}
+
+// Fica com o prazo mais próximo
+static void earliest(uint64_t *deadline, TimeoutReason *reason, uint64_t candidate, TimeoutReason candidate_reason) {
+    if (candidate != 0 && (*deadline == 0 || candidate < *deadline)) {
+        *deadline = candidate;
+        *reason = candidate_reason;
+    }
+}
+
+bool connection_update_deadline(const ElectionServer *server, Connection *conn) {
+    uint64_t deadline = 0;
+    TimeoutReason reason = TIMEOUT_NONE;
+
+    // Conexões de outros nós do cluster não têm prazo
+    if (!conn->session.peer) {
+        if (server->handshake_timeout_ns > 0 && !conn->session.authenticated) {
+            earliest(&deadline, &reason, conn->opened_ns + server->handshake_timeout_ns, TIMEOUT_HANDSHAKE);
+        }
+        if (server->idle_timeout_ns > 0 && !conn->session.watching) {
+            earliest(&deadline, &reason, conn->active_ns + server->idle_timeout_ns, TIMEOUT_IDLE);
+        }
+        if (server->session_timeout_ns > 0) {
+            earliest(&deadline, &reason, conn->opened_ns + server->session_timeout_ns, TIMEOUT_SESSION);
+        }
+    }
+
+    // Prazo e motivo numa palavra só: quem recebe o timer nunca vê um
+    // sem o outro
+    atomic_store_explicit(&conn->deadline, deadline ? (deadline & ~3ULL) | reason : 0, memory_order_release);
+    uint64_t armed = atomic_load_explicit(&conn->armed_tick, memory_order_acquire);
+    return deadline != 0 && (armed == 0 || timer_tick(deadline) < armed);
+}
+
+void connection_arm_timer(TimerWheel *wheel, Connection *conn) {
+    uint64_t deadline = atomic_load_explicit(&conn->deadline, memory_order_acquire);
+    if (deadline == 0) {
+        timer_wheel_cancel(wheel, &conn->timer);
+        atomic_store_explicit(&conn->armed_tick, 0, memory_order_release);
+        return;
+    }
+    timer_wheel_schedule(wheel, &conn->timer, timer_tick(deadline));
+    atomic_store_explicit(&conn->armed_tick, conn->timer.expires, memory_order_release);
+}
+
+TimeoutReason connection_timer_expired(TimerWheel *wheel, Connection *conn, uint64_t now) {
+    uint64_t deadline = atomic_load_explicit(&conn->deadline, memory_order_acquire);
+    if (deadline != 0 && deadline <= now) {
+        atomic_store_explicit(&conn->armed_tick, 0, memory_order_release);
+        return (TimeoutReason)(deadline & 3);
+    }
+    connection_arm_timer(wheel, conn);
+    return TIMEOUT_NONE;
+}
+
+const char *timeout_reason_name(TimeoutReason reason) {
+    static const char *names[TIMEOUT_REASONS] = {"none", "handshake", "idle", "session"};
+    return reason >= 0 && reason < TIMEOUT_REASONS ? names[reason] : "?";
+}
+
+bool connection_append_timeout(Connection *conn) {
+    if (conn->mode == PROTOCOL_BINARY) {
+        uint8_t frame[BIN_HEADER_SIZE + 1];
+        bin_put_header(frame, BIN_ERROR, 0, 1);
+        frame[BIN_HEADER_SIZE] = BIN_ERR_TIMEOUT;
+        return connection_append_output(conn, frame, sizeof(frame));
+    }
+    return connection_append_output(conn, RESP_ERR_TIMEOUT "\n", strlen(RESP_ERR_TIMEOUT) + 1);
+}
+
+bool connection_has_command(const Connection *conn) {
+    if (conn->mode == PROTOCOL_BINARY) {
+        return conn->in_len >= BIN_HEADER_SIZE &&
+               conn->in_len >= BIN_HEADER_SIZE + (size_t)bin_get_u16((const uint8_t *)conn->in + 2);
+    }
+    return memchr(conn->in, '\n', conn->in_len) != NULL;
+}
+
+void connection_record_latencies(Connection *conn) {
+    if (conn->pending_total == 0) {
+        return;
+    }
+    uint64_t elapsed = monotonic_ns() - conn->batch_start;
+    for (int i = 0; i < STAT_COMMANDS; i++) {
+        for (uint32_t j = 0; j < conn->pending_stats[i]; j++) {
+            latency_record(i, elapsed);
+        }
+        conn->pending_stats[i] = 0;
+    }
+    conn->pending_total = 0;
+}
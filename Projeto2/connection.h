@@ -0,0 +1,170 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "server.h"
+#include "timer_wheel.h"
+
+// Acima deste volume de respostas pendentes a conexão para de processar
+// comandos até o cliente consumir o que já foi enviado
+#define OUT_HIGH_WATER (256 * 1024)
+
+// Resolução dos prazos das conexões (um tick da roda de timers)
+#define TIMER_TICK_NS (100 * 1000000ULL)
+
+// Protocolo da conexão, detectado pelo primeiro byte recebido
+typedef enum {
+    PROTOCOL_UNKNOWN,
+    PROTOCOL_TEXT,
+    PROTOCOL_BINARY     // primeiro byte >= 0x80 (tipo de quadro)
+} ProtocolMode;
+
+// Estado de uma conexão: buffer de entrada com enquadramento por linha
+// e fila de respostas enviada em lote. Usado pelos modos thread e event loop.
+typedef struct Connection {
+    int fd;
+    Session session;
+    ProtocolMode mode;
+
+    char in[MAX_BUFFER];
+    size_t in_len;
+
+    char *out;
+    size_t out_len;
+    size_t out_sent;
+    size_t out_cap;
+
+    // Comandos respondidos desde o último envio, para os histogramas de
+    // latência (medida do recv que os trouxe até o send das respostas)
+    uint32_t pending_stats[STAT_COMMANDS];
+    uint32_t pending_total;
+    uint64_t batch_start;
+    uint64_t last_recv;
+
+    uint32_t events;    // eventos registrados no epoll (só no modo event loop)
+    int shard;          // loop que atende a conexão (só no modo sharded)
+    bool closing;       // fecha depois de enviar as respostas pendentes (BYE)
+
+    // Modo io_uring: operações no kernel que ainda apontam para a conexão
+    // (ela só é liberada sem nenhuma), o recv multishot, o envio em
+    // andamento (send_buf é trocado com out a cada envio) e o que chegou
+    // sem espaço no buffer de entrada (spill, consumido antes de receber
+    // mais)
+    int inflight;
+    bool recv_armed;
+    bool recv_cancelling;
+    bool send_armed;
+    bool dead;          // fechada, esperando as operações pendentes
+    char *send_buf;
+    size_t send_len;
+    size_t send_sent;
+    size_t send_cap;
+    char *spill;
+    size_t spill_len;
+    size_t spill_cap;
+
+    // Lista do event loop de conexões com respostas retidas até o journal
+    // gravar os votos confirmados nelas
+    bool waiting_journal;
+    struct Connection *wait_prev;
+    struct Connection *wait_next;
+
+    // Assinatura do placar: eleição assinada (NULL se nenhuma) e última
+    // atualização recebida. O event loop guarda os assinantes numa lista;
+    // no modo thread cada assinante tem seu eventfd avisado pelo hub.
+    Election *watch_election;
+    uint64_t watch_seq;
+    int watch_fd;
+    struct Connection *watch_prev;
+    struct Connection *watch_next;
+
+    // Fila de conexões recebidas de outro loop (modo sharded)
+    struct Connection *handoff_next;
+
+    // Prazos. A roda de timers (do loop, ou a do modo thread) tem um timer
+    // por conexão, no menor prazo. Só a dona da conexão recalcula
+    // deadline; quem recebe o timer vencido confere o prazo atual e, se ele
+    // andou (a conexão teve atividade), só reagenda.
+    TimerEntry timer;
+    uint64_t opened_ns;
+    uint64_t active_ns;             // último comando processado
+    _Atomic uint64_t deadline;      // prazo em ns com o TimeoutReason nos 2 bits baixos (0: nenhum)
+    _Atomic uint64_t armed_tick;    // tick do timer agendado (0: nenhum)
+    _Atomic int timed_out;          // motivo do despejo (modo thread)
+} Connection;
+
+void connection_init(Connection *conn, int fd);
+void connection_free(Connection *conn);
+
+// Bytes de resposta ainda não enviados
+static inline size_t connection_pending_output(const Connection *conn) {
+    return conn->out_len - conn->out_sent + conn->send_len - conn->send_sent;
+}
+
+// Modo sharded: a sessão é de um votante de outro loop e a conexão precisa
+// ser transferida antes de processar mais comandos
+static inline bool connection_misplaced(const ElectionServer *server, const Connection *conn) {
+    return server->num_shards > 0 && conn->session.authenticated &&
+           voter_table_shard(conn->session.voter_hash, server->num_shards) != conn->shard;
+}
+
+// Espaço livre no buffer de entrada (sempre reserva um byte para o '\0')
+static inline size_t connection_input_space(const Connection *conn) {
+    return MAX_BUFFER - 1 - conn->in_len;
+}
+
+// Dados recebidos (modo io_uring): vão para o buffer de entrada e o que
+// não couber, para o spill. Retorna false sem memória.
+bool connection_append_input(Connection *conn, const void *data, size_t len);
+
+// Processa todos os comandos completos (linhas terminadas em \n ou quadros
+// binários) do buffer de entrada, e depois os do spill, enfileirando as
+// respostas. Um pedaço de comando fica no buffer até o próximo recv. Para em BYE, acima de
+// OUT_HIGH_WATER ou depois de um HELLO de votante de outro loop (modo
+// sharded).
+void connection_process_input(ElectionServer *server, Connection *conn);
+
+// Há pelo menos um comando completo no buffer de entrada
+bool connection_has_command(const Connection *conn);
+
+// Marca o envio das respostas acumuladas nos histogramas de latência
+void connection_record_latencies(Connection *conn);
+
+// Recalcula o menor prazo da conexão. Retorna true se ele vence antes do
+// timer agendado (ou se não há timer): quem chama precisa rearmá-lo.
+bool connection_update_deadline(const ElectionServer *server, Connection *conn);
+
+// Agenda o timer da conexão no prazo atual, ou o cancela se não houver
+// prazo (com a roda sob controle de quem chama)
+void connection_arm_timer(TimerWheel *wheel, Connection *conn);
+
+// Timer da conexão vencido em now (ns). Retorna o motivo se o prazo
+// venceu; senão rearma o timer e retorna TIMEOUT_NONE.
+TimeoutReason connection_timer_expired(TimerWheel *wheel, Connection *conn, uint64_t now);
+
+// Nome do prazo para logs e métricas
+const char *timeout_reason_name(TimeoutReason reason);
+
+// Acrescenta a resposta de prazo vencido (texto ou binário) à fila de saída
+bool connection_append_timeout(Connection *conn);
+
+// Tick da roda de timers que alcança o instante em ns
+static inline uint64_t timer_tick(uint64_t ns) {
+    return (ns + TIMER_TICK_NS - 1) / TIMER_TICK_NS;
+}
+
+// Conexão dona do timer
+static inline Connection *timer_connection(TimerEntry *entry) {
+    return (Connection *)((char *)entry - offsetof(Connection, timer));
+}
+
+// Acrescenta dados prontos (atualizações do WATCH) à fila de saída.
+// Retorna false sem memória.
+bool connection_append_output(Connection *conn, const void *data, size_t len);
+
+// Descarta as respostas já enviadas
+void connection_compact_output(Connection *conn);
+
+#endif
@@ -0,0 +1,356 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include "election.h"
+#include "checkpoint.h"
+#include "cluster.h"
+#include "export.h"
+
+#define DEFAULT_OPTIONS_CAPACITY 16
+
+// Aplica um registro do journal durante a recuperação
+static void replay_entry(void *ctx, const JournalEntry *entry) {
+    Election *election = (Election *)ctx;
+
+    if (entry->type == JOURNAL_CLOSE) {
+        atomic_store(&election->closing, true);
+        atomic_store(&election->closed, true);
+        return;
+    }
+    if (entry->type != JOURNAL_VOTE || entry->option_index < 0 || entry->option_index >= election->num_options) {
+        return;
+    }
+
+    uint64_t hash = voter_hash(entry->voter_id);
+    if (voter_table_mark_voted(&election->voters, entry->voter_id, hash, entry->option_index, NULL, NULL) ==
+        VOTER_MARKED) {
+        tally_add(&election->tally, entry->option_index, 1);
+    }
+}
+
+// Carrega opções de votação do arquivo, uma por linha (sem limite de
+// quantidade)
+static void load_options(Election *election, const char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Erro: não foi possível abrir %s\n", filename);
+        exit(1);
+    }
+
+    int capacity = 0;
+    char line[MAX_OPTION_NAME];
+    while (fgets(line, sizeof(line), file)) {
+        // Remove newline
+        line[strcspn(line, "\n")] = 0;
+        if (strlen(line) == 0) {
+            continue;
+        }
+
+        if (election->num_options == capacity) {
+            capacity = capacity ? capacity * 2 : DEFAULT_OPTIONS_CAPACITY;
+            VoteOption *options = realloc(election->options, capacity * sizeof(VoteOption));
+            if (options == NULL) {
+                perror("Erro ao alocar opções de votação");
+                exit(1);
+            }
+            election->options = options;
+        }
+        snprintf(election->options[election->num_options].name, MAX_OPTION_NAME, "%s", line);
+        election->num_options++;
+    }
+
+    fclose(file);
+    LOG_INFO(election, "Eleição %s: carregadas %d opções de votação de %s", election->name,
+             election->num_options, filename);
+
+    if (election->num_options < 3) {
+        fprintf(stderr, "Erro: é necessário ter pelo menos 3 opções de votação (%s)\n", filename);
+        exit(1);
+    }
+}
+
+// Reconstrói votos e estado da eleição: último checkpoint mais a cauda
+// do journal gravada depois dele
+static void recover(Election *election, const char *const *names) {
+    uint64_t start = monotonic_ns();
+    uint64_t checkpoint_lsn;
+    int loaded = checkpoint_load(election, election->checkpoint_path, &checkpoint_lsn);
+    if (loaded < 0) {
+        fprintf(stderr, "Erro: checkpoint inválido ou de outra eleição (%s)\n", election->checkpoint_path);
+        exit(1);
+    }
+    if (loaded > 0) {
+        LOG_INFO(election, "Checkpoint: %zu votantes carregados em %.1f ms (LSN %llu)",
+                 voter_table_count(&election->voters), (monotonic_ns() - start) / 1e6,
+                 (unsigned long long)checkpoint_lsn);
+    }
+
+    if (journal_open(&election->journal, election->journal_path, names, election->num_options,
+                     checkpoint_lsn, replay_entry, election) < 0) {
+        fprintf(stderr, "Erro ao abrir journal de votos (%s): %s\n", election->journal_path, strerror(errno));
+        exit(1);
+    }
+    LOG_INFO(election, "Journal: %zu votantes recuperados em %.1f ms%s", voter_table_count(&election->voters),
+             (monotonic_ns() - start) / 1e6, atomic_load(&election->closed) ? " (eleição encerrada)" : "");
+}
+
+Election *election_open(const ElectionSpec *spec, int index, const char *dir, Logger *log,
+                        const ServerConfig *config, struct Cluster *cluster) {
+    // Os stripes da tabela de votantes são alinhados em linhas de cache
+    Election *election = aligned_alloc(64, sizeof(Election));
+    if (election == NULL) {
+        perror("Erro ao alocar eleição");
+        exit(1);
+    }
+    memset(election, 0, sizeof(*election));
+    snprintf(election->name, sizeof(election->name), "%s", spec->name);
+    election->index = index;
+    election->cluster = cluster;
+    voter_table_init(&election->voters);
+    atomic_init(&election->closing, false);
+    atomic_init(&election->closed, false);
+    atomic_init(&election->votes_inflight, 0);
+
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        fprintf(stderr, "Erro ao criar diretório %s: %s\n", dir, strerror(errno));
+        exit(1);
+    }
+    snprintf(election->journal_path, sizeof(election->journal_path), "%s/votos.journal", dir);
+    snprintf(election->checkpoint_path, sizeof(election->checkpoint_path), "%s/checkpoint.dat", dir);
+    snprintf(election->results_base, sizeof(election->results_base), "%s/resultado_final", dir);
+    snprintf(election->export_base, sizeof(election->export_base), "%s/exportacao", dir);
+
+    if (log == NULL) {
+        char log_path[256];
+        snprintf(log_path, sizeof(log_path), "%s/eleicao.log", dir);
+        if (logger_init(&election->logger, log_path, config->log_capacity,
+                        config->log_policy, config->log_level) < 0) {
+            perror("Erro ao abrir arquivo de log");
+            exit(1);
+        }
+        log = &election->logger;
+    }
+    election->log = log;
+
+    load_options(election, spec->options_path);
+
+    const char **names = malloc(election->num_options * sizeof(char *));
+    if (names == NULL) {
+        perror("Erro ao alocar eleição");
+        exit(1);
+    }
+    for (int i = 0; i < election->num_options; i++) {
+        names[i] = election->options[i].name;
+    }
+    if (!response_cache_fits(names, election->num_options)) {
+        fprintf(stderr, "Erro: opções de %s não cabem num quadro do protocolo binário\n", spec->options_path);
+        exit(1);
+    }
+    election->options_hash = journal_options_hash(names, election->num_options);
+
+    // Opções não mudam mais: OPTIONS é serializado uma única vez
+    if (tally_init(&election->tally, election->num_options) < 0 ||
+        response_cache_init(&election->responses, names, election->num_options,
+                            config->score_interval_ms * 1000000ULL) < 0 ||
+        watch_init(&election->watch, &election->responses, &election->tally, &election->closed,
+                   config->watch_interval_ms * 1000000ULL) < 0) {
+        perror("Erro ao alocar contadores");
+        exit(1);
+    }
+
+    if (config->journal) {
+        recover(election, names);
+    } else {
+        journal_disable(&election->journal);
+    }
+    free(names);
+
+    if (journal_start(&election->journal, config->commit_window_us * 1000ULL) < 0) {
+        perror("Erro ao criar thread do journal");
+        exit(1);
+    }
+    checkpoint_start(election, election->checkpoint_path, config->checkpoint_interval_s);
+
+    if (cluster != NULL) {
+        watch_set_source(&election->watch, cluster_watch_counts, election);
+    }
+    if (watch_start(&election->watch) < 0) {
+        perror("Erro ao criar thread do WATCH");
+        exit(1);
+    }
+    return election;
+}
+
+void election_shutdown(Election *election) {
+    watch_shutdown(&election->watch);
+    journal_shutdown(&election->journal);
+    if (election->log == &election->logger) {
+        logger_stop(&election->logger);
+    }
+}
+
+void election_destroy(Election *election) {
+    if (election->log == &election->logger) {
+        free(election->logger.ring);
+    }
+    voter_table_destroy(&election->voters);
+    tally_destroy(&election->tally);
+    response_cache_destroy(&election->responses);
+    free(election->options);
+    free(election);
+}
+
+// Corpo de record_vote, dentro da barreira do encerramento
+typedef struct {
+    Election *election;
+    const char *voter_id;
+    int option_index;
+    uint64_t lsn;
+} PendingVote;
+
+// Grava o voto no journal sob o lock do stripe, junto com a marcação: o
+// checkpoint (que trava todos os stripes) vê o voto marcado só se ele já
+// estiver no journal. Sem registro o voto não pode ser confirmado e a
+// marcação é desfeita (o placar ainda não foi tocado).
+static bool journal_vote(void *ctx) {
+    PendingVote *pending = (PendingVote *)ctx;
+    Journal *journal = &pending->election->journal;
+    pending->lsn = journal_append(journal, JOURNAL_VOTE, pending->option_index, pending->voter_id);
+    return pending->lsn != 0 || !journal->enabled;
+}
+
+static VoteResult apply_vote(Election *election, const char *voter_id, uint64_t voter_hash,
+                             int option_index, uint64_t *lsn) {
+    // Depois do incremento de votes_inflight (ordem sequencial): ou o
+    // voto vê o closing, ou close_election vê o voto em andamento
+    if (atomic_load(&election->closing)) {
+        return VOTE_CLOSED;
+    }
+    if (option_index < 0 || option_index >= election->num_options) {
+        // Voto duplicado tem precedência sobre opção inválida
+        if (voter_table_has_voted(&election->voters, voter_id, voter_hash)) {
+            return VOTE_DUPLICATE;
+        }
+        return VOTE_INVALID_OPTION;
+    }
+
+    PendingVote pending = {election, voter_id, option_index, 0};
+    VoterMarkResult mark = voter_table_mark_voted(&election->voters, voter_id, voter_hash, option_index,
+                                                  journal_vote, &pending);
+    if (mark == VOTER_DUPLICATE) {
+        return VOTE_DUPLICATE;
+    }
+    if (mark == VOTER_UNCOMMITTED) {
+        LOG_ERROR(election, "Voto de %s recusado: sem memória para o journal", voter_id);
+        return VOTE_REJECTED;
+    }
+    if (mark == VOTER_NO_MEMORY) {
+        return VOTE_REJECTED;
+    }
+    *lsn = pending.lsn;
+    tally_add(&election->tally, option_index, 1);
+
+    LOG_INFO(election, "Voto registrado: %s -> %s", voter_id, election->options[option_index].name);
+    return VOTE_RECORDED;
+}
+
+// A verificação de duplicidade e a marcação do votante acontecem numa
+// única busca na tabela hash, sob o lock do stripe. O voto conta em
+// votes_inflight do início ao fim: close_election espera esses votos antes
+// do resultado final, e os que chegam depois do closing são recusados.
+VoteResult record_vote(Election *election, const char *voter_id, uint64_t voter_hash, int option_index,
+                       uint64_t *lsn) {
+    *lsn = 0;
+    atomic_fetch_add(&election->votes_inflight, 1);
+    VoteResult result = apply_vote(election, voter_id, voter_hash, option_index, lsn);
+    atomic_fetch_sub_explicit(&election->votes_inflight, 1, memory_order_release);
+    return result;
+}
+
+size_t get_score(Election *election, void *buffer, bool binary) {
+    if (election->cluster != NULL) {
+        return cluster_score(election->cluster, election, binary, buffer);
+    }
+    bool final = atomic_load(&election->closed);
+    return response_cache_score(&election->responses, &election->tally, final, binary, buffer);
+}
+
+// Encerra eleição
+void close_election(Election *election) {
+    // Recusa votos novos e espera os que já passaram pela verificação: o
+    // CLOSE do journal e o resultado final vêm depois de todos eles
+    atomic_store(&election->closing, true);
+    while (atomic_load(&election->votes_inflight) > 0) {
+        sched_yield();
+    }
+    atomic_store(&election->closed, true);
+    journal_wait(&election->journal, journal_append(&election->journal, JOURNAL_CLOSE, 0, NULL));
+
+    // Assinantes recebem o CLOSED FINAL sem esperar o intervalo
+    watch_kick(&election->watch);
+
+    LOG_INFO(election, "Eleição %s encerrada por comando administrativo", election->name);
+    save_final_results(election);
+    logger_flush(election->log);
+}
+
+// Nota do resultado de um nó do cluster (NULL fora do modo cluster)
+static const char *partition_note(Election *election, char *note, size_t size) {
+    if (election->cluster == NULL) {
+        return NULL;
+    }
+    snprintf(note, size, "Nó %d de %d: só os votantes desta partição",
+             election->cluster->self, election->cluster->num_nodes);
+    return note;
+}
+
+// Salva resultados finais deste nó
+void save_final_results(Election *election) {
+    uint64_t *counts = malloc(election->num_options * sizeof(uint64_t));
+    if (counts == NULL) {
+        LOG_ERROR(election, "Sem memória para salvar o resultado final");
+        return;
+    }
+    tally_snapshot(&election->tally, counts, NULL);
+
+    char note[64];
+    save_results(election, counts, voter_table_count(&election->voters),
+                 partition_note(election, note, sizeof(note)));
+    free(counts);
+}
+
+void save_results(Election *election, const uint64_t *counts, uint64_t voters, const char *note) {
+    ExportSnapshot snapshot;
+    if (export_snapshot(&snapshot, election, counts, voters, note) < 0) {
+        LOG_ERROR(election, "Sem memória para salvar o resultado final");
+        return;
+    }
+    export_write(&snapshot, election->results_base);
+    export_free(&snapshot);
+}
+
+int export_election(Election *election) {
+    uint64_t *counts = malloc(election->num_options * sizeof(uint64_t));
+    if (counts == NULL) {
+        return -1;
+    }
+    tally_snapshot(&election->tally, counts, NULL);
+
+    char note[64];
+    ExportSnapshot snapshot;
+    int result = export_snapshot(&snapshot, election, counts, voter_table_count(&election->voters),
+                                 partition_note(election, note, sizeof(note)));
+    free(counts);
+    if (result < 0) {
+        return -1;
+    }
+    if (export_write_async(&snapshot, election->export_base) < 0) {
+        export_free(&snapshot);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef ELECTION_H
+#define ELECTION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "server.h"
+
+// Abre uma eleição: carrega as opções de spec->options_path, recupera os
+// votos do checkpoint e do journal em dir e inicia as threads da eleição
+// (journal, checkpoint e WATCH). Com log NULL a eleição grava seu próprio
+// log em dir/eleicao.log. No modo cluster (cluster não NULL) SCORE e WATCH
+// somam os totais de todos os nós. Erros de inicialização encerram o
+// processo.
+Election *election_open(const ElectionSpec *spec, int index, const char *dir, Logger *log,
+                        const ServerConfig *config, struct Cluster *cluster);
+
+// Encerra as threads da eleição, gravando o que estiver pendente
+void election_shutdown(Election *election);
+
+// Libera a memória da eleição (depois de election_shutdown)
+void election_destroy(Election *election);
+
+// Registra um voto. *lsn recebe a posição do registro no journal, que
+// precisa estar em disco antes de confirmar o voto ao cliente.
+VoteResult record_vote(Election *election, const char *voter_id, uint64_t voter_hash, int option_index,
+                       uint64_t *lsn);
+
+// Copia o placar atual (SCORE ou CLOSED FINAL, texto com \n ou quadro
+// binário) para buffer (até responses.max_len bytes). Retorna o tamanho.
+size_t get_score(Election *election, void *buffer, bool binary);
+
+void close_election(Election *election);
+void save_final_results(Election *election);
+
+// Grava o resultado (relatório, CSV e JSON) com os totais dados; note
+// (pode ser NULL) entra no cabeçalho, como a origem dos totais no modo
+// cluster. Tira um retrato e grava sem segurar locks da eleição.
+void save_results(Election *election, const uint64_t *counts, uint64_t voters, const char *note);
+
+// ADMIN EXPORT: retrato do estado atual (só deste nó no modo cluster),
+// gravado em export_base numa thread própria. Retorna -1 sem memória.
+int export_election(Election *election);
+
+#endif
@@ -0,0 +1,1016 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "server.h"
+#include "event_loop.h"
+#include "connection.h"
+#include "metrics.h"
+#include "uring.h"
+
+#define MAX_EVENTS 256
+
+// Modo io_uring: posições de submissão por loop e buffers do recv multishot
+#define URING_ENTRIES 1024
+#define URING_BUFFERS 512
+
+// Um event loop por thread, cada um com seu próprio epoll (ou io_uring)
+typedef struct EventLoop {
+    int id;
+    int epoll_fd;
+    int listen_socket;
+    ElectionServer *server;
+    pthread_t thread;
+
+    int journal_fd;             // eventfd avisado a cada lote gravado no journal
+    Connection *waiting;        // conexões esperando o journal
+
+    int watch_fd;               // eventfd avisado a cada atualização do WATCH
+    Connection *watchers;       // conexões que assinaram o placar
+    WatchUpdate **updates;      // por eleição, durante handle_watch
+
+    // Modo sharded: conexões transferidas por outros loops, numa pilha sem
+    // lock (empilhadas com CAS; o dono retira a pilha inteira de uma vez,
+    // então não há ABA) e o eventfd que avisa o dono
+    _Atomic(Connection *) handoffs;
+    int handoff_fd;
+    struct EventLoop *peers;    // todos os loops, indexados pelo shard
+
+    // Prazos das conexões deste loop: timerfd com um tick da roda (-1 sem
+    // prazos configurados)
+    int timer_fd;
+    TimerWheel timers;
+    uint64_t timer_now;         // instante do tick em processamento
+
+    // Modo io_uring: anel do loop, criado na thread dele (NULL no epoll)
+    struct Uring *ring;
+} EventLoop;
+
+#ifdef WITH_IO_URING
+// Operação de cada conclusão do io_uring, nos 4 bits baixos do user_data;
+// o resto é o ponteiro (conexão, loop ou eventfd)
+typedef enum {
+    OP_ACCEPT,
+    OP_POLL,
+    OP_RECV,
+    OP_SEND,
+    OP_CANCEL
+} UringOp;
+
+static uint64_t op_data(void *ptr, UringOp op) {
+    return (uint64_t)(uintptr_t)ptr << 4 | op;
+}
+
+static void uring_close(EventLoop *loop, Connection *conn);
+static bool uring_flush(EventLoop *loop, Connection *conn);
+static void uring_rearm(EventLoop *loop, Connection *conn);
+#endif
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static void update_events(EventLoop *loop, Connection *conn, uint32_t events) {
+    if (conn->events == events) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = conn;
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+    METRIC_ADD(io_syscalls, 1);
+    conn->events = events;
+}
+
+static void stop_waiting(EventLoop *loop, Connection *conn) {
+    if (!conn->waiting_journal) {
+        return;
+    }
+    if (conn->wait_prev != NULL) {
+        conn->wait_prev->wait_next = conn->wait_next;
+    } else {
+        loop->waiting = conn->wait_next;
+    }
+    if (conn->wait_next != NULL) {
+        conn->wait_next->wait_prev = conn->wait_prev;
+    }
+    conn->waiting_journal = false;
+}
+
+// As respostas pendentes confirmam votos que ainda não estão em disco?
+static bool output_held(EventLoop *loop, Connection *conn) {
+    Election *election = conn->session.election;
+    if (election == NULL || conn->session.durable_lsn <= journal_durable(&election->journal)) {
+        return false;
+    }
+    if (!conn->waiting_journal) {
+        conn->wait_prev = NULL;
+        conn->wait_next = loop->waiting;
+        if (loop->waiting != NULL) {
+            loop->waiting->wait_prev = conn;
+        }
+        loop->waiting = conn;
+        conn->waiting_journal = true;
+    }
+    return true;
+}
+
+static void stop_watching(EventLoop *loop, Connection *conn) {
+    if (conn->watch_election == NULL) {
+        return;
+    }
+    if (conn->watch_prev != NULL) {
+        conn->watch_prev->watch_next = conn->watch_next;
+    } else {
+        loop->watchers = conn->watch_next;
+    }
+    if (conn->watch_next != NULL) {
+        conn->watch_next->watch_prev = conn->watch_prev;
+    }
+    watch_unsubscribe(&conn->watch_election->watch);
+    conn->watch_election = NULL;
+}
+
+// Entra, sai ou troca de eleição na lista de assinantes depois de
+// WATCH/UNWATCH/HELLO
+static void update_watch(EventLoop *loop, Connection *conn) {
+    Election *election = conn->session.watching ? conn->session.election : NULL;
+    if (election == conn->watch_election) {
+        return;
+    }
+    stop_watching(loop, conn);
+    if (election == NULL) {
+        return;
+    }
+    // A resposta do WATCH já trouxe o placar atual
+    conn->watch_seq = watch_seq(&election->watch);
+    conn->watch_prev = NULL;
+    conn->watch_next = loop->watchers;
+    if (loop->watchers != NULL) {
+        loop->watchers->watch_prev = conn;
+    }
+    loop->watchers = conn;
+    conn->watch_election = election;
+    watch_subscribe(&election->watch);
+}
+
+static void close_connection(EventLoop *loop, Connection *conn) {
+    timer_wheel_cancel(&loop->timers, &conn->timer);
+    stop_waiting(loop, conn);
+    stop_watching(loop, conn);
+#ifdef WITH_IO_URING
+    if (loop->ring != NULL) {
+        uring_close(loop, conn);
+        return;
+    }
+#endif
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    METRIC_ADD(io_syscalls, 1);
+    close(conn->fd);
+    connection_free(conn);
+    free(conn);
+}
+
+// Envia o máximo possível das respostas pendentes. Respostas de votos
+// ainda não gravados no journal ficam retidas até o aviso do journal.
+// Retorna false se a conexão foi fechada.
+static bool flush_output(EventLoop *loop, Connection *conn) {
+    if (output_held(loop, conn)) {
+        return true;
+    }
+#ifdef WITH_IO_URING
+    if (loop->ring != NULL) {
+        return uring_flush(loop, conn);
+    }
+#endif
+    while (conn->out_sent < conn->out_len) {
+        ssize_t sent = send(conn->fd, conn->out + conn->out_sent,
+                            conn->out_len - conn->out_sent, MSG_NOSIGNAL);
+        METRIC_ADD(io_syscalls, 1);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            LOG_INFO(loop->server, "Cliente %s desconectado (socket %d)",
+                     conn->session.authenticated ? conn->session.voter_id : "não autenticado", conn->fd);
+            close_connection(loop, conn);
+            return false;
+        }
+        conn->out_sent += sent;
+        METRIC_ADD(bytes_out, sent);
+    }
+    connection_record_latencies(conn);
+    connection_compact_output(conn);
+
+    if (conn->out_len == 0 && conn->closing) {
+        close_connection(loop, conn);
+        return false;
+    }
+    return true;
+}
+
+// Ajusta os eventos de interesse conforme o estado da conexão
+static void rearm(EventLoop *loop, Connection *conn) {
+#ifdef WITH_IO_URING
+    if (loop->ring != NULL) {
+        uring_rearm(loop, conn);
+        return;
+    }
+#endif
+    uint32_t events = 0;
+    bool backlogged = connection_pending_output(conn) >= OUT_HIGH_WATER;
+
+    if (!conn->closing && !backlogged) {
+        events |= EPOLLIN;
+    }
+    if (conn->out_sent < conn->out_len && !conn->waiting_journal) {
+        events |= EPOLLOUT;
+    }
+    update_events(loop, conn, events);
+}
+
+// Entrega a conexão ao loop dono do votante da sessão. Ela sai das listas
+// e do epoll deste loop antes de ser publicada, então nunca é tocada pelos
+// dois loops ao mesmo tempo.
+static void hand_off(EventLoop *loop, Connection *conn) {
+    EventLoop *owner = &loop->peers[voter_table_shard(conn->session.voter_hash, loop->server->num_shards)];
+    stop_waiting(loop, conn);
+    stop_watching(loop, conn);
+    timer_wheel_cancel(&loop->timers, &conn->timer);
+    atomic_store_explicit(&conn->armed_tick, 0, memory_order_relaxed);
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    conn->events = 0;
+
+    Connection *head = atomic_load_explicit(&owner->handoffs, memory_order_relaxed);
+    do {
+        conn->handoff_next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&owner->handoffs, &head, conn,
+                                                    memory_order_release, memory_order_relaxed));
+    uint64_t one = 1;
+    if (write(owner->handoff_fd, &one, sizeof(one)) < 0) {
+        // eventfd já sinalizado: o dono vai acordar de qualquer forma
+    }
+    atomic_fetch_add_explicit(&loop->server->handoffs, 1, memory_order_relaxed);
+    LOG_DEBUG(loop->server, "Cliente %s transferido do loop %d para o %d (socket %d)",
+              conn->session.voter_id, loop->id, owner->id, conn->fd);
+}
+
+// Processa os comandos recebidos. No modo sharded, um HELLO de votante de
+// outro loop interrompe o processamento e a conexão segue, com o resto da
+// entrada e as respostas pendentes, para o loop dono. Retorna false se a
+// conexão saiu deste loop.
+static bool process_input(EventLoop *loop, Connection *conn) {
+    connection_process_input(loop->server, conn);
+    if (connection_update_deadline(loop->server, conn)) {
+        connection_arm_timer(&loop->timers, conn);
+    }
+    if (connection_misplaced(loop->server, conn)) {
+        hand_off(loop, conn);
+        return false;
+    }
+    update_watch(loop, conn);
+    return true;
+}
+
+static void handle_readable(EventLoop *loop, Connection *conn) {
+    while (!conn->closing && connection_input_space(conn) > 0) {
+        size_t requested = connection_input_space(conn);
+        ssize_t bytes_read = recv(conn->fd, conn->in + conn->in_len, requested, 0);
+        METRIC_ADD(io_syscalls, 1);
+        if (bytes_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+        }
+        if (bytes_read <= 0) {
+            LOG_INFO(loop->server, "Cliente %s desconectado (socket %d)",
+                     conn->session.authenticated ? conn->session.voter_id : "não autenticado", conn->fd);
+            close_connection(loop, conn);
+            return;
+        }
+        conn->last_recv = monotonic_ns();
+        conn->in_len += bytes_read;
+        METRIC_ADD(bytes_in, bytes_read);
+        if (!process_input(loop, conn)) {
+            return;
+        }
+
+        // Leitura parcial: o socket foi esvaziado, não precisa de outro
+        // recv só para receber EAGAIN (o epoll é level-triggered)
+        if ((size_t)bytes_read < requested ||
+            connection_pending_output(conn) >= OUT_HIGH_WATER) {
+            break;
+        }
+    }
+
+    if (!flush_output(loop, conn)) {
+        return;
+    }
+    rearm(loop, conn);
+}
+
+static void handle_writable(EventLoop *loop, Connection *conn) {
+    if (!flush_output(loop, conn)) {
+        return;
+    }
+    // Libera comandos que ficaram retidos pelo limite de saída
+    if ((conn->in_len > 0 || conn->spill_len > 0) && conn->out_len == 0) {
+        if (!process_input(loop, conn) || !flush_output(loop, conn)) {
+            return;
+        }
+    }
+    rearm(loop, conn);
+}
+
+// O journal gravou um lote: libera as conexões cujos votos já estão em
+// disco. Pode fechar ou transferir conexões, então no modo epoll roda
+// depois do lote do epoll_wait, que pode trazer outros eventos delas.
+static void handle_journal(EventLoop *loop) {
+    uint64_t value;
+    METRIC_ADD(io_syscalls, 1);
+    if (read(loop->journal_fd, &value, sizeof(value)) < 0) {
+        return;
+    }
+
+    // O aviso pode ser do journal de qualquer eleição
+    Connection *conn = loop->waiting;
+    while (conn != NULL) {
+        Connection *next = conn->wait_next;
+        if (conn->session.election == NULL ||
+            conn->session.durable_lsn <= journal_durable(&conn->session.election->journal)) {
+            stop_waiting(loop, conn);
+            handle_writable(loop, conn);
+        }
+        conn = next;
+    }
+}
+
+// Envia a atualização direto do buffer compartilhado quando a conexão não
+// tem respostas na fila; senão, ou no que sobrar de um envio parcial,
+// copia para a fila. Um assinante que não consome (fila acima de
+// OUT_HIGH_WATER) perde esta atualização e recebe uma mais nova depois.
+static void push_update(EventLoop *loop, Connection *conn, const WatchUpdate *update) {
+    if (conn->closing || connection_pending_output(conn) >= OUT_HIGH_WATER) {
+        return;
+    }
+    size_t len;
+    const char *data = watch_update_data(update, conn->mode == PROTOCOL_BINARY, &len);
+    ssize_t sent = 0;
+    conn->watch_seq = update->seq;
+
+#ifdef WITH_IO_URING
+    // io_uring: a atualização vai pela fila, num send junto com as respostas
+    if (loop->ring != NULL) {
+        if (!connection_append_output(conn, data, len)) {
+            conn->closing = true;
+            conn->out_len = 0;
+        }
+        if (flush_output(loop, conn)) {
+            rearm(loop, conn);
+        }
+        return;
+    }
+#endif
+    if (connection_pending_output(conn) == 0) {
+        do {
+            sent = send(conn->fd, data, len, MSG_NOSIGNAL);
+            METRIC_ADD(io_syscalls, 1);
+        } while (sent < 0 && errno == EINTR);
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            sent = 0;
+        }
+        if (sent > 0) {
+            METRIC_ADD(bytes_out, sent);
+        }
+    }
+
+    // A conexão pode aparecer de novo neste lote do epoll_wait: em vez de
+    // fechar aqui, marca e deixa o EPOLLOUT fechar em flush_output
+    if (sent < 0 || ((size_t)sent < len && !connection_append_output(conn, data + sent, len - sent))) {
+        conn->closing = true;
+        conn->out_len = conn->out_sent = 0;
+        update_events(loop, conn, EPOLLOUT);
+        return;
+    }
+    rearm(loop, conn);
+}
+
+// Nova atualização do placar: entrega aos assinantes deste loop. Cada
+// eleição tem seu hub; a atualização de uma eleição é obtida no máximo uma
+// vez por aviso, e só se algum assinante ainda não a recebeu.
+static void handle_watch(EventLoop *loop) {
+    uint64_t value;
+    METRIC_ADD(io_syscalls, 1);
+    if (read(loop->watch_fd, &value, sizeof(value)) < 0) {
+        return;
+    }
+
+    Connection *conn = loop->watchers;
+    while (conn != NULL) {
+        Connection *next = conn->watch_next;
+        Election *election = conn->watch_election;
+        if (watch_seq(&election->watch) > conn->watch_seq) {
+            WatchUpdate **update = &loop->updates[election->index];
+            if (*update == NULL) {
+                *update = watch_acquire(&election->watch);
+            }
+            if (*update != NULL && conn->watch_seq < (*update)->seq) {
+                push_update(loop, conn, *update);
+            }
+        }
+        conn = next;
+    }
+
+    for (int i = 0; i < loop->server->num_elections; i++) {
+        watch_release(loop->updates[i]);
+        loop->updates[i] = NULL;
+    }
+}
+
+// Assume as conexões transferidas por outros loops: registra no epoll e
+// continua de onde o loop anterior parou
+static void handle_handoffs(EventLoop *loop) {
+    uint64_t value;
+    METRIC_ADD(io_syscalls, 1);
+    if (read(loop->handoff_fd, &value, sizeof(value)) < 0) {
+        return;
+    }
+
+    Connection *conn = atomic_exchange_explicit(&loop->handoffs, NULL, memory_order_acquire);
+    while (conn != NULL) {
+        Connection *next = conn->handoff_next;
+        conn->shard = loop->id;
+        conn->events = EPOLLIN;
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = conn;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev) < 0) {
+            perror("Erro no epoll_ctl");
+            close_connection(loop, conn);
+            conn = next;
+            continue;
+        }
+        connection_update_deadline(loop->server, conn);
+        connection_arm_timer(&loop->timers, conn);
+        if (process_input(loop, conn) && flush_output(loop, conn)) {
+            rearm(loop, conn);
+        }
+        conn = next;
+    }
+}
+
+// Timer de uma conexão vencido: se o prazo não andou, avisa o cliente e
+// fecha. Um cliente que não lê, ou sem memória para o aviso, fica sem ele
+// (o timer já venceu: a conexão não pode ficar aberta esperando).
+static void expire_connection(TimerEntry *entry, void *arg) {
+    EventLoop *loop = (EventLoop *)arg;
+    Connection *conn = timer_connection(entry);
+    TimeoutReason reason = connection_timer_expired(&loop->timers, conn, loop->timer_now);
+    if (reason == TIMEOUT_NONE) {
+        return;
+    }
+    LOG_INFO(loop->server, "Conexão de %s fechada por prazo vencido (%s, socket %d)",
+             conn->session.authenticated ? conn->session.voter_id : "não autenticado",
+             timeout_reason_name(reason), conn->fd);
+    METRIC_ADD(evictions[reason], 1);
+
+    conn->closing = true;
+    if (!connection_append_timeout(conn) || flush_output(loop, conn)) {
+        close_connection(loop, conn);
+    }
+}
+
+// Tick da roda de timers. Roda depois do lote do epoll_wait, que pode
+// trazer outros eventos das conexões fechadas aqui.
+static void handle_timers(EventLoop *loop) {
+    uint64_t value;
+    METRIC_ADD(io_syscalls, 1);
+    if (read(loop->timer_fd, &value, sizeof(value)) < 0) {
+        return;
+    }
+    loop->timer_now = monotonic_ns();
+    timer_wheel_advance(&loop->timers, loop->timer_now / TIMER_TICK_NS, expire_connection, loop);
+}
+
+static void accept_connections(EventLoop *loop) {
+    while (1) {
+        int client_socket = accept4(loop->listen_socket, NULL, NULL, SOCK_NONBLOCK);
+        METRIC_ADD(io_syscalls, 1);
+        if (client_socket < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("Erro no accept");
+            }
+            return;
+        }
+
+        Connection *conn = malloc(sizeof(Connection));
+        if (conn == NULL) {
+            close(client_socket);
+            continue;
+        }
+        connection_init(conn, client_socket);
+        conn->events = EPOLLIN;
+        conn->shard = loop->id;
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = conn;
+        METRIC_ADD(io_syscalls, 1);
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, client_socket, &ev) < 0) {
+            perror("Erro no epoll_ctl");
+            close(client_socket);
+            free(conn);
+            continue;
+        }
+        connection_update_deadline(loop->server, conn);
+        connection_arm_timer(&loop->timers, conn);
+
+        LOG_INFO(loop->server, "Nova conexão estabelecida (socket %d)", client_socket);
+    }
+}
+
+static void *event_loop_thread(void *arg) {
+    EventLoop *loop = (EventLoop *)arg;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (1) {
+        bool tick = false;
+        bool journal = false;
+        int n = epoll_wait(loop->epoll_fd, events, MAX_EVENTS, -1);
+        METRIC_ADD(io_syscalls, 1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Erro no epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            Connection *conn = events[i].data.ptr;
+
+            // data.ptr NULL identifica o socket de escuta, &journal_fd o
+            // aviso do journal, &watch_fd o do WATCH, &handoff_fd o de
+            // conexões transferidas e &timer_fd o tick dos prazos
+            if (conn == NULL) {
+                accept_connections(loop);
+                continue;
+            }
+            if ((void *)conn == &loop->journal_fd) {
+                journal = true;
+                continue;
+            }
+            if ((void *)conn == &loop->watch_fd) {
+                handle_watch(loop);
+                continue;
+            }
+            if ((void *)conn == &loop->handoff_fd) {
+                handle_handoffs(loop);
+                continue;
+            }
+            if ((void *)conn == &loop->timer_fd) {
+                tick = true;
+                continue;
+            }
+
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                handle_readable(loop, conn);
+            } else if (events[i].events & EPOLLOUT) {
+                handle_writable(loop, conn);
+            }
+        }
+        if (journal) {
+            handle_journal(loop);
+        }
+        if (tick) {
+            handle_timers(loop);
+        }
+    }
+
+    return NULL;
+}
+
+#ifdef WITH_IO_URING
+static void uring_arm_recv(EventLoop *loop, Connection *conn) {
+    uring_prep_recv_multishot(uring_get_sqe(loop->ring), conn->fd, op_data(conn, OP_RECV));
+    conn->recv_armed = true;
+    conn->inflight++;
+}
+
+static void uring_send(EventLoop *loop, Connection *conn) {
+    uring_prep_send(uring_get_sqe(loop->ring), conn->fd, conn->send_buf + conn->send_sent,
+                    conn->send_len - conn->send_sent, op_data(conn, OP_SEND));
+    conn->send_armed = true;
+    conn->inflight++;
+}
+
+static void uring_poll(EventLoop *loop, int *fd) {
+    uring_prep_poll_multishot(uring_get_sqe(loop->ring), *fd, op_data(fd, OP_POLL));
+}
+
+// Libera a conexão fechada quando o kernel não tem mais operações dela
+static void uring_release(Connection *conn) {
+    if (conn->inflight > 0) {
+        return;
+    }
+    close(conn->fd);
+    connection_free(conn);
+    free(conn);
+}
+
+// Cancela o que estiver armado no socket. O fd só é fechado (e a conexão
+// liberada) depois da última conclusão, para não ser reaproveitado por
+// outra conexão com operações antigas ainda no kernel.
+static void uring_close(EventLoop *loop, Connection *conn) {
+    conn->dead = true;
+    if (conn->recv_armed || conn->send_armed) {
+        uring_prep_cancel_fd(uring_get_sqe(loop->ring), conn->fd, op_data(conn, OP_CANCEL));
+        conn->inflight++;
+    }
+    uring_release(conn);
+}
+
+// Um send por vez: as respostas acumuladas em out passam a ser o buffer em
+// envio e o buffer anterior, já enviado, recebe as próximas
+static bool uring_flush(EventLoop *loop, Connection *conn) {
+    if (!conn->send_armed && conn->out_len > 0) {
+        char *buf = conn->send_buf;
+        size_t cap = conn->send_cap;
+        conn->send_buf = conn->out;
+        conn->send_cap = conn->out_cap;
+        conn->send_len = conn->out_len;
+        conn->send_sent = 0;
+        conn->out = buf;
+        conn->out_cap = cap;
+        conn->out_len = 0;
+        connection_record_latencies(conn);
+        uring_send(loop, conn);
+    }
+    if (!conn->send_armed && conn->closing) {
+        close_connection(loop, conn);
+        return false;
+    }
+    return true;
+}
+
+// O recv multishot fica armado enquanto a conexão aceita comandos; com
+// respostas acumuladas, BYE ou entrada esperando no spill ele é cancelado
+// e volta a ser armado quando terminar e a conexão puder ler de novo
+static void uring_rearm(EventLoop *loop, Connection *conn) {
+    bool reading = !conn->closing && connection_pending_output(conn) < OUT_HIGH_WATER &&
+                   conn->spill_len == 0;
+    if (reading && !conn->recv_armed) {
+        uring_arm_recv(loop, conn);
+    } else if (!reading && conn->recv_armed && !conn->recv_cancelling) {
+        uring_prep_cancel(uring_get_sqe(loop->ring), op_data(conn, OP_RECV), op_data(conn, OP_CANCEL));
+        conn->recv_cancelling = true;
+        conn->inflight++;
+    }
+}
+
+static void uring_disconnected(EventLoop *loop, Connection *conn) {
+    LOG_INFO(loop->server, "Cliente %s desconectado (socket %d)",
+             conn->session.authenticated ? conn->session.voter_id : "não autenticado", conn->fd);
+    close_connection(loop, conn);
+}
+
+// Conclusão do recv multishot: copia o buffer do anel para a entrada da
+// conexão e o devolve ao kernel na hora
+static void uring_received(EventLoop *loop, Connection *conn, const struct io_uring_cqe *cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        conn->recv_armed = false;
+        conn->recv_cancelling = false;
+        conn->inflight--;
+    }
+    bool stored = true;
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        if (!conn->dead && cqe->res > 0) {
+            stored = connection_append_input(conn, uring_buffer(loop->ring, bid), cqe->res);
+        }
+        uring_recycle(loop->ring, bid);
+    }
+    if (conn->dead) {
+        uring_release(conn);
+        return;
+    }
+
+    // Sem buffers livres ou recv cancelado: só volta a armar
+    if (cqe->res == -ENOBUFS || cqe->res == -ECANCELED) {
+        rearm(loop, conn);
+        return;
+    }
+    if (cqe->res <= 0 || !stored) {
+        uring_disconnected(loop, conn);
+        return;
+    }
+    conn->last_recv = monotonic_ns();
+    METRIC_ADD(bytes_in, cqe->res);
+    if (process_input(loop, conn) && flush_output(loop, conn)) {
+        rearm(loop, conn);
+    }
+}
+
+static void uring_sent(EventLoop *loop, Connection *conn, int res) {
+    conn->send_armed = false;
+    conn->inflight--;
+    if (conn->dead) {
+        uring_release(conn);
+        return;
+    }
+    if (res < 0) {
+        uring_disconnected(loop, conn);
+        return;
+    }
+    METRIC_ADD(bytes_out, res);
+    conn->send_sent += res;
+    if (conn->send_sent < conn->send_len) {
+        uring_send(loop, conn);
+        return;
+    }
+    conn->send_len = 0;
+    conn->send_sent = 0;
+    handle_writable(loop, conn);
+}
+
+static void uring_accept(EventLoop *loop, int client_socket) {
+    Connection *conn = malloc(sizeof(Connection));
+    if (conn == NULL) {
+        close(client_socket);
+        return;
+    }
+    connection_init(conn, client_socket);
+    conn->shard = loop->id;
+    connection_update_deadline(loop->server, conn);
+    connection_arm_timer(&loop->timers, conn);
+    uring_arm_recv(loop, conn);
+
+    LOG_INFO(loop->server, "Nova conexão estabelecida (socket %d)", client_socket);
+}
+
+// Trata uma conclusão. Retorna true no tick dos prazos, que roda depois do
+// lote.
+static bool uring_complete(EventLoop *loop, const struct io_uring_cqe *cqe) {
+    void *ptr = (void *)(uintptr_t)(cqe->user_data >> 4);
+    bool more = cqe->flags & IORING_CQE_F_MORE;
+    Connection *conn = ptr;
+
+    switch ((UringOp)(cqe->user_data & 15)) {
+    case OP_ACCEPT:
+        if (cqe->res >= 0) {
+            uring_accept(loop, cqe->res);
+        } else if (cqe->res != -ECANCELED) {
+            errno = -cqe->res;
+            perror("Erro no accept");
+        }
+        if (!more) {
+            uring_prep_accept_multishot(uring_get_sqe(loop->ring), loop->listen_socket,
+                                        op_data(loop, OP_ACCEPT));
+        }
+        return false;
+    case OP_POLL:
+        if (!more) {
+            uring_poll(loop, ptr);
+        }
+        if (ptr == &loop->journal_fd) {
+            handle_journal(loop);
+        } else if (ptr == &loop->watch_fd) {
+            handle_watch(loop);
+        } else {
+            return true;
+        }
+        return false;
+    case OP_RECV:
+        uring_received(loop, conn, cqe);
+        return false;
+    case OP_SEND:
+        uring_sent(loop, conn, cqe->res);
+        return false;
+    case OP_CANCEL:
+        conn->inflight--;
+        if (conn->dead) {
+            uring_release(conn);
+        }
+        return false;
+    }
+    return false;
+}
+
+// Loop do modo io_uring: accept e recv multishot, sends e os eventfds
+// (journal, WATCH, prazos) vigiados por poll multishot no mesmo anel. Cada
+// volta é uma única io_uring_enter, que submete todos os sends do lote
+// anterior e espera as próximas conclusões.
+static void *uring_loop_thread(void *arg) {
+    EventLoop *loop = (EventLoop *)arg;
+    Uring ring;
+    if (uring_init(&ring, URING_ENTRIES) < 0 || uring_setup_buffers(&ring, URING_BUFFERS, MAX_BUFFER) < 0) {
+        perror("Erro ao criar o io_uring");
+        exit(1);
+    }
+    loop->ring = &ring;
+
+    uring_prep_accept_multishot(uring_get_sqe(&ring), loop->listen_socket, op_data(loop, OP_ACCEPT));
+    uring_poll(loop, &loop->journal_fd);
+    uring_poll(loop, &loop->watch_fd);
+    if (loop->timer_fd >= 0) {
+        uring_poll(loop, &loop->timer_fd);
+    }
+
+    while (1) {
+        if (uring_submit_and_wait(&ring, 1) < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                continue;
+            }
+            perror("Erro no io_uring_enter");
+            break;
+        }
+
+        bool tick = false;
+        struct io_uring_cqe *cqe;
+        while ((cqe = uring_peek(&ring)) != NULL) {
+            struct io_uring_cqe done = *cqe;
+            uring_cqe_seen(&ring);
+            tick |= uring_complete(loop, &done);
+        }
+        if (tick) {
+            handle_timers(loop);
+        }
+    }
+
+    loop->ring = NULL;
+    uring_free(&ring);
+    return NULL;
+}
+#endif
+
+// Registra um fd do loop no epoll. No modo io_uring não faz nada: a
+// thread do loop vigia o fd pelo anel dela.
+static void add_source(EventLoop *loop, int fd, uint32_t events, void *ptr, const char *error) {
+    if (loop->epoll_fd < 0) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = ptr;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror(error);
+        exit(1);
+    }
+}
+
+void run_event_loops(ElectionServer *server, const int *listen_sockets, int num_loops) {
+    bool sharded = server->num_shards > 0;
+    for (int i = 0; i < (sharded ? num_loops : 1); i++) {
+        if (set_nonblocking(listen_sockets[i]) < 0) {
+            perror("Erro ao configurar socket não bloqueante");
+            exit(1);
+        }
+    }
+
+    EventLoop *loops = calloc(num_loops, sizeof(EventLoop));
+    if (loops == NULL) {
+        perror("Erro ao alocar event loops");
+        exit(1);
+    }
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    bool timeouts = server->handshake_timeout_ns > 0 || server->idle_timeout_ns > 0 ||
+                    server->session_timeout_ns > 0;
+
+    for (int i = 0; i < num_loops; i++) {
+        loops[i].id = i;
+        loops[i].server = server;
+        loops[i].peers = loops;
+        atomic_init(&loops[i].handoffs, NULL);
+        loops[i].listen_socket = listen_sockets[sharded ? i : 0];
+        loops[i].epoll_fd = -1;
+        if (!server->io_uring) {
+            loops[i].epoll_fd = epoll_create1(0);
+            if (loops[i].epoll_fd < 0) {
+                perror("Erro no epoll_create1");
+                exit(1);
+            }
+        }
+
+        // Socket compartilhado: EPOLLEXCLUSIVE evita acordar todos os loops
+        // a cada conexão nova. No modo sharded cada loop tem o seu.
+        add_source(&loops[i], loops[i].listen_socket, sharded ? EPOLLIN : EPOLLIN | EPOLLEXCLUSIVE, NULL,
+                   "Erro no epoll_ctl");
+
+        loops[i].journal_fd = eventfd(0, EFD_NONBLOCK);
+        if (loops[i].journal_fd < 0) {
+            perror("Erro no eventfd");
+            exit(1);
+        }
+        add_source(&loops[i], loops[i].journal_fd, EPOLLIN, &loops[i].journal_fd,
+                   "Erro ao registrar aviso do journal");
+
+        loops[i].watch_fd = eventfd(0, EFD_NONBLOCK);
+        if (loops[i].watch_fd < 0) {
+            perror("Erro no eventfd");
+            exit(1);
+        }
+        add_source(&loops[i], loops[i].watch_fd, EPOLLIN, &loops[i].watch_fd,
+                   "Erro ao registrar aviso do WATCH");
+
+        // Os mesmos eventfds recebem os avisos de todas as eleições
+        for (int e = 0; e < server->num_elections; e++) {
+            Election *election = server->elections[e];
+            if (journal_add_notify(&election->journal, loops[i].journal_fd) < 0 ||
+                watch_add_notify(&election->watch, loops[i].watch_fd) < 0) {
+                perror("Erro ao registrar avisos da eleição");
+                exit(1);
+            }
+        }
+        loops[i].updates = calloc(server->num_elections, sizeof(WatchUpdate *));
+        if (loops[i].updates == NULL) {
+            perror("Erro ao alocar event loops");
+            exit(1);
+        }
+
+        loops[i].handoff_fd = eventfd(0, EFD_NONBLOCK);
+        if (loops[i].handoff_fd < 0) {
+            perror("Erro no eventfd");
+            exit(1);
+        }
+        add_source(&loops[i], loops[i].handoff_fd, EPOLLIN, &loops[i].handoff_fd,
+                   "Erro ao registrar aviso de transferência");
+
+        timer_wheel_init(&loops[i].timers, monotonic_ns() / TIMER_TICK_NS);
+        loops[i].timer_fd = -1;
+        if (timeouts) {
+            struct itimerspec tick = {
+                .it_interval = {0, TIMER_TICK_NS},
+                .it_value = {0, TIMER_TICK_NS}
+            };
+            loops[i].timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+            if (loops[i].timer_fd < 0 || timerfd_settime(loops[i].timer_fd, 0, &tick, NULL) < 0) {
+                perror("Erro no timerfd");
+                exit(1);
+            }
+            add_source(&loops[i], loops[i].timer_fd, EPOLLIN, &loops[i].timer_fd,
+                       "Erro ao registrar timer dos prazos");
+        }
+    }
+
+    // Os loops só começam com todos criados: um HELLO no primeiro já pode
+    // transferir a conexão para qualquer outro
+    void *(*thread_main)(void *) = event_loop_thread;
+#ifdef WITH_IO_URING
+    if (server->io_uring) {
+        thread_main = uring_loop_thread;
+    }
+#endif
+    for (int i = 0; i < num_loops; i++) {
+        if (pthread_create(&loops[i].thread, NULL, thread_main, &loops[i]) != 0) {
+            perror("Erro ao criar thread do event loop");
+            exit(1);
+        }
+        // No modo sharded cada loop fica num núcleo, com seus stripes de
+        // votantes e seu shard de contadores no cache desse núcleo
+        if (sharded && num_cpus > 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % num_cpus, &cpus);
+            pthread_setaffinity_np(loops[i].thread, sizeof(cpus), &cpus);
+        }
+    }
+
+    for (int i = 0; i < num_loops; i++) {
+        pthread_join(loops[i].thread, NULL);
+        if (loops[i].epoll_fd >= 0) {
+            close(loops[i].epoll_fd);
+        }
+        close(loops[i].journal_fd);
+        close(loops[i].watch_fd);
+        close(loops[i].handoff_fd);
+        if (loops[i].timer_fd >= 0) {
+            close(loops[i].timer_fd);
+        }
+        free(loops[i].updates);
+    }
+    free(loops);
+}
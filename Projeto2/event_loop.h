@@ -0,0 +1,13 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "server.h"
+
+// Executa o modo event loop: num_loops threads, cada uma com seu próprio
+// epoll, compartilhando o socket de escuta listen_sockets[0]. No modo
+// sharded (server->num_shards == num_loops) o loop i escuta em
+// listen_sockets[i] e atende só os votantes do shard i. Não retorna
+// enquanto os loops estiverem ativos.
+void run_event_loops(ElectionServer *server, const int *listen_sockets, int num_loops);
+
+#endif
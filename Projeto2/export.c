@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "export.h"
+
+// Duas exportações seguidas gravariam os mesmos .tmp: uma grava por vez
+static pthread_mutex_t write_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+    ExportSnapshot snapshot;
+    char base[256];
+} ExportJob;
+
+int export_snapshot(ExportSnapshot *snapshot, Election *election, const uint64_t *counts,
+                    uint64_t voters, const char *note) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->election = election;
+    snapshot->taken = time(NULL);
+    snapshot->closed = atomic_load(&election->closed);
+    snapshot->voters = voters;
+    if (note != NULL) {
+        snprintf(snapshot->note, sizeof(snapshot->note), "%s", note);
+    }
+
+    snapshot->counts = malloc(election->num_options * sizeof(uint64_t));
+    if (snapshot->counts == NULL) {
+        return -1;
+    }
+    memcpy(snapshot->counts, counts, election->num_options * sizeof(uint64_t));
+
+    for (int i = 0; i < VOTER_TABLE_STRIPES; i++) {
+        if (voter_table_copy_stripe(&election->voters, i, &snapshot->records) < 0) {
+            export_free(snapshot);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void export_free(ExportSnapshot *snapshot) {
+    free(snapshot->counts);
+    snapshot->counts = NULL;
+    voter_list_free(&snapshot->records);
+}
+
+static uint64_t total_votes(const ExportSnapshot *snapshot) {
+    uint64_t total = 0;
+    for (int i = 0; i < snapshot->election->num_options; i++) {
+        total += snapshot->counts[i];
+    }
+    return total;
+}
+
+static bool record_voted(const VoterList *records, size_t i) {
+    return (records->voted[i / 64] >> (i % 64)) & 1;
+}
+
+static double percentage(uint64_t count, uint64_t total) {
+    return total > 0 ? count * 100.0 / total : 0.0;
+}
+
+// Relatório legível (o formato de sempre do resultado_final.txt)
+static void write_report(FILE *file, const ExportSnapshot *snapshot) {
+    const Election *election = snapshot->election;
+    fprintf(file, "===========================================\n");
+    fprintf(file, "    RESULTADO %s DA VOTAÇÃO\n", snapshot->closed ? "FINAL" : "PARCIAL");
+    fprintf(file, "===========================================\n\n");
+
+    char date[32];
+    fprintf(file, "Eleição: %s\n", election->name);
+    if (snapshot->note[0] != '\0') {
+        fprintf(file, "%s\n", snapshot->note);
+    }
+    fprintf(file, "Data: %s\n", ctime_r(&snapshot->taken, date));
+
+    uint64_t total = total_votes(snapshot);
+    fprintf(file, "Total de votos: %llu\n", (unsigned long long)total);
+    fprintf(file, "Total de votantes registrados: %llu\n\n", (unsigned long long)snapshot->voters);
+
+    fprintf(file, "-------------------------------------------\n");
+    fprintf(file, "Opção                              Votos  %%\n");
+    fprintf(file, "-------------------------------------------\n");
+
+    for (int i = 0; i < election->num_options; i++) {
+        fprintf(file, "%-35s %5llu %6.2f%%\n",
+                election->options[i].name,
+                (unsigned long long)snapshot->counts[i],
+                percentage(snapshot->counts[i], total));
+    }
+
+    fprintf(file, "-------------------------------------------\n");
+}
+
+// Campo CSV: entre aspas (com aspas dobradas) se tiver separador
+static void csv_field(FILE *file, const char *value) {
+    if (strpbrk(value, ",\"\r\n") == NULL) {
+        fputs(value, file);
+        return;
+    }
+    fputc('"', file);
+    for (const char *p = value; *p != '\0'; p++) {
+        if (*p == '"') {
+            fputc('"', file);
+        }
+        fputc(*p, file);
+    }
+    fputc('"', file);
+}
+
+static void write_csv(FILE *file, const ExportSnapshot *snapshot) {
+    const Election *election = snapshot->election;
+    uint64_t total = total_votes(snapshot);
+    fprintf(file, "opcao,votos,percentual\n");
+    for (int i = 0; i < election->num_options; i++) {
+        csv_field(file, election->options[i].name);
+        fprintf(file, ",%llu,%.2f\n", (unsigned long long)snapshot->counts[i],
+                percentage(snapshot->counts[i], total));
+    }
+}
+
+// Só quem votou, nunca em quem: o voto é secreto
+static void write_voters_csv(FILE *file, const ExportSnapshot *snapshot) {
+    const char *id = snapshot->records.ids;
+    fprintf(file, "voter_id,votou\n");
+    for (size_t i = 0; i < snapshot->records.count; i++) {
+        csv_field(file, id);
+        fprintf(file, ",%d\n", record_voted(&snapshot->records, i) ? 1 : 0);
+        id += strlen(id) + 1;
+    }
+}
+
+static void json_string(FILE *file, const char *value) {
+    fputc('"', file);
+    for (const unsigned char *p = (const unsigned char *)value; *p != '\0'; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(file, "\\%c", *p);
+        } else if (*p < 0x20) {
+            fprintf(file, "\\u%04x", *p);
+        } else {
+            fputc(*p, file);
+        }
+    }
+    fputc('"', file);
+}
+
+static void write_json(FILE *file, const ExportSnapshot *snapshot) {
+    const Election *election = snapshot->election;
+    uint64_t total = total_votes(snapshot);
+    struct tm tm;
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime_r(&snapshot->taken, &tm));
+
+    fprintf(file, "{\n  \"eleicao\": ");
+    json_string(file, election->name);
+    fprintf(file, ",\n  \"nota\": ");
+    if (snapshot->note[0] != '\0') {
+        json_string(file, snapshot->note);
+    } else {
+        fprintf(file, "null");
+    }
+    fprintf(file, ",\n  \"data\": \"%s\",\n  \"encerrada\": %s,\n", date,
+            snapshot->closed ? "true" : "false");
+    fprintf(file, "  \"total_votos\": %llu,\n  \"votantes_registrados\": %llu,\n",
+            (unsigned long long)total, (unsigned long long)snapshot->voters);
+
+    fprintf(file, "  \"opcoes\": [");
+    for (int i = 0; i < election->num_options; i++) {
+        fprintf(file, "%s\n    {\"nome\": ", i > 0 ? "," : "");
+        json_string(file, election->options[i].name);
+        fprintf(file, ", \"votos\": %llu, \"percentual\": %.2f}",
+                (unsigned long long)snapshot->counts[i], percentage(snapshot->counts[i], total));
+    }
+    fprintf(file, "\n  ],\n  \"votantes\": [");
+    const char *id = snapshot->records.ids;
+    for (size_t i = 0; i < snapshot->records.count; i++) {
+        fprintf(file, "%s\n    {\"id\": ", i > 0 ? "," : "");
+        json_string(file, id);
+        fprintf(file, ", \"votou\": %s}", record_voted(&snapshot->records, i) ? "true" : "false");
+        id += strlen(id) + 1;
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
+
+// Grava base<suffix> por um .tmp trocado com rename
+static int write_file(const ExportSnapshot *snapshot, const char *base, const char *suffix,
+                      void (*writer)(FILE *, const ExportSnapshot *)) {
+    char path[512];
+    char tmp_path[520];
+    snprintf(path, sizeof(path), "%s%s", base, suffix);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *file = fopen(tmp_path, "w");
+    if (file == NULL) {
+        return -1;
+    }
+    writer(file, snapshot);
+    if (ferror(file)) {
+        fclose(file);
+        remove(tmp_path);
+        return -1;
+    }
+    if (fclose(file) != 0 || rename(tmp_path, path) < 0) {
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+int export_write(const ExportSnapshot *snapshot, const char *base) {
+    pthread_mutex_lock(&write_lock);
+    int result = 0;
+    result |= write_file(snapshot, base, ".txt", write_report);
+    result |= write_file(snapshot, base, ".csv", write_csv);
+    result |= write_file(snapshot, base, "_votantes.csv", write_voters_csv);
+    result |= write_file(snapshot, base, ".json", write_json);
+    pthread_mutex_unlock(&write_lock);
+
+    const Election *election = snapshot->election;
+    if (result < 0) {
+        LOG_ERROR(election, "Falha ao exportar o resultado para %s.*", base);
+        return -1;
+    }
+    LOG_INFO(election, "Resultado %s salvo em %s.{txt,csv,json} (%zu votantes)",
+             snapshot->closed ? "final" : "parcial", base, snapshot->records.count);
+    return 0;
+}
+
+static void *export_thread(void *arg) {
+    ExportJob *job = (ExportJob *)arg;
+    export_write(&job->snapshot, job->base);
+    export_free(&job->snapshot);
+    free(job);
+    return NULL;
+}
+
+int export_write_async(ExportSnapshot *snapshot, const char *base) {
+    ExportJob *job = malloc(sizeof(ExportJob));
+    if (job == NULL) {
+        return -1;
+    }
+    job->snapshot = *snapshot;
+    snprintf(job->base, sizeof(job->base), "%s", base);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, export_thread, job) != 0) {
+        free(job);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
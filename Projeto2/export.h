@@ -0,0 +1,40 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <time.h>
+#include "server.h"
+
+// Retrato imutável de uma eleição para exportação: os totais e uma cópia
+// dos votantes, em O(opções + votantes) de memória. Tirado o retrato, a
+// gravação não segura nenhum lock da eleição.
+typedef struct {
+    const Election *election;   // nome e opções (imutáveis)
+    char note[96];              // origem dos totais (vazio: nenhuma)
+    time_t taken;
+    bool closed;
+    uint64_t *counts;           // votos por opção
+    uint64_t voters;            // votantes no relatório (no cluster, de todos os nós)
+    VoterList records;          // votantes deste nó, stripe por stripe
+} ExportSnapshot;
+
+// Copia os totais dados e os votantes da eleição. Cada stripe fica travado
+// só durante a sua cópia: a votação não para. Retorna -1 sem memória.
+int export_snapshot(ExportSnapshot *snapshot, Election *election, const uint64_t *counts,
+                    uint64_t voters, const char *note);
+
+void export_free(ExportSnapshot *snapshot);
+
+// Grava o retrato em base.txt (relatório), base.csv (placar),
+// base_votantes.csv e base.json. Cada arquivo é gravado num .tmp e trocado
+// por rename, então quem lê nunca vê um pela metade. Retorna -1 se algum
+// falhou.
+int export_write(const ExportSnapshot *snapshot, const char *base);
+
+// Grava o retrato numa thread própria, que o libera no fim. Retorna -1 se
+// a thread não pôde ser criada (o retrato continua com quem chamou).
+int export_write_async(ExportSnapshot *snapshot, const char *base);
+
+#endif
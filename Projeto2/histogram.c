@@ -0,0 +1,88 @@
+#include "histogram.h"
+
+static inline int bucket_index(uint64_t value) {
+    if (value < HIST_SUB_COUNT) {
+        return (int)value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    if (msb > HIST_MAX_MSB) {
+        return HIST_BUCKETS - 1;
+    }
+    int shift = msb - HIST_SUB_BITS;
+    int sub = (int)((value >> shift) & (HIST_SUB_COUNT - 1));
+    return (shift + 1) * HIST_SUB_COUNT + sub;
+}
+
+static inline uint64_t bucket_upper_bound(int index) {
+    if (index < HIST_SUB_COUNT) {
+        return (uint64_t)index;
+    }
+    int shift = index / HIST_SUB_COUNT - 1;
+    uint64_t sub = index % HIST_SUB_COUNT;
+    return ((HIST_SUB_COUNT + sub + 1) << shift) - 1;
+}
+
+// Incremento de escritor único: load + store, sem instrução com lock
+static inline void bump(_Atomic uint64_t *counter, uint64_t n) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+void histogram_reset(Histogram *hist) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        atomic_store_explicit(&hist->counts[i], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&hist->total, 0, memory_order_relaxed);
+    atomic_store_explicit(&hist->sum, 0, memory_order_relaxed);
+    atomic_store_explicit(&hist->max, 0, memory_order_relaxed);
+}
+
+void histogram_record(Histogram *hist, uint64_t value) {
+    bump(&hist->counts[bucket_index(value)], 1);
+    bump(&hist->total, 1);
+    bump(&hist->sum, value);
+    if (value > atomic_load_explicit(&hist->max, memory_order_relaxed)) {
+        atomic_store_explicit(&hist->max, value, memory_order_relaxed);
+    }
+}
+
+void histogram_merge(Histogram *dst, const Histogram *src) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        bump(&dst->counts[i], atomic_load_explicit(&src->counts[i], memory_order_relaxed));
+    }
+    bump(&dst->total, atomic_load_explicit(&src->total, memory_order_relaxed));
+    bump(&dst->sum, atomic_load_explicit(&src->sum, memory_order_relaxed));
+    uint64_t max = atomic_load_explicit(&src->max, memory_order_relaxed);
+    if (max > atomic_load_explicit(&dst->max, memory_order_relaxed)) {
+        atomic_store_explicit(&dst->max, max, memory_order_relaxed);
+    }
+}
+
+uint64_t histogram_percentile(const Histogram *hist, double p) {
+    uint64_t total = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        total += atomic_load_explicit(&hist->counts[i], memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(p / 100.0 * total + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > total) {
+        rank = total;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&hist->counts[i], memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t bound = bucket_upper_bound(i);
+            uint64_t max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+            return bound < max ? bound : max;
+        }
+    }
+    return atomic_load_explicit(&hist->max, memory_order_relaxed);
+}
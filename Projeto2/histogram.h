@@ -0,0 +1,35 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Histograma com buckets logarítmicos no estilo HDR: cada potência de 2
+// é dividida em 2^HIST_SUB_BITS sub-buckets lineares, o que dá erro
+// relativo de no máximo ~6% em qualquer escala.
+#define HIST_SUB_BITS 4
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_MAX_MSB 43     // valores acima de ~2^44 ns (~4,9 h) ficam no último bucket
+#define HIST_BUCKETS ((HIST_MAX_MSB - HIST_SUB_BITS + 2) * HIST_SUB_COUNT)
+
+// Cada histograma tem um único escritor; os contadores são atômicos
+// apenas para que leitores em outras threads não vejam valores rasgados.
+typedef struct {
+    _Atomic uint64_t counts[HIST_BUCKETS];
+    _Atomic uint64_t total;
+    _Atomic uint64_t sum;
+    _Atomic uint64_t max;
+} Histogram;
+
+void histogram_reset(Histogram *hist);
+
+// Registra um valor (somente a thread dona do histograma)
+void histogram_record(Histogram *hist, uint64_t value);
+
+// Soma src em dst (dst não pode estar sendo escrito por outra thread)
+void histogram_merge(Histogram *dst, const Histogram *src);
+
+// Valor do percentil p (0-100), estimado pelo limite superior do bucket
+uint64_t histogram_percentile(const Histogram *hist, double p);
+
+#endif
@@ -0,0 +1,381 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "journal.h"
+#include "binary_protocol.h"
+
+static uint32_t crc_table[256];
+
+static void crc32_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+        }
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32(const uint8_t *data, size_t len) {
+    uint32_t c = 0xFFFFFFFFU;
+    for (size_t i = 0; i < len; i++) {
+        c = crc_table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFU;
+}
+
+// Identifica a lista de opções: os registros guardam só o índice
+uint64_t journal_options_hash(const char *const *names, int num_options) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < num_options; i++) {
+        for (const char *p = names[i]; ; p++) {
+            hash = (hash ^ (uint8_t)*p) * 0x100000001b3ULL;
+            if (*p == '\0') {
+                break;
+            }
+        }
+    }
+    return hash;
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *data, size_t len) {
+    char *p = data;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Reaplica os registros de data[0..len) e retorna o tamanho da parte válida
+static size_t replay_records(const uint8_t *data, size_t len, JournalReplayFn replay, void *ctx) {
+    size_t pos = 0;
+    while (pos + JOURNAL_RECORD_HEADER <= len) {
+        const uint8_t *record = data + pos;
+        size_t id_len = record[9];
+        size_t record_len = JOURNAL_RECORD_HEADER + id_len;
+        if (id_len >= MAX_VOTER_ID || pos + record_len > len ||
+            crc32(record + 4, record_len - 4) != bin_get_u32(record)) {
+            break;
+        }
+
+        JournalEntry entry;
+        entry.type = record[4];
+        entry.option_index = (int)bin_get_u32(record + 5);
+        memcpy(entry.voter_id, record + JOURNAL_RECORD_HEADER, id_len);
+        entry.voter_id[id_len] = '\0';
+        replay(ctx, &entry);
+
+        pos += record_len;
+    }
+    return pos;
+}
+
+int journal_open(Journal *journal, const char *path, const char *const *names, int num_options,
+                 uint64_t replay_from, JournalReplayFn replay, void *ctx) {
+    memset(journal, 0, sizeof(*journal));
+    crc32_init();
+
+    journal->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (journal->fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(journal->fd, &st) < 0) {
+        close(journal->fd);
+        return -1;
+    }
+
+    uint8_t header[JOURNAL_HEADER_SIZE];
+    uint64_t hash = journal_options_hash(names, num_options);
+    size_t valid = JOURNAL_HEADER_SIZE;
+
+    if ((size_t)st.st_size < JOURNAL_HEADER_SIZE) {
+        // Arquivo novo (ou sem cabeçalho completo): recomeça do zero
+        bin_put_u32(header, JOURNAL_MAGIC);
+        bin_put_u16(header + 4, JOURNAL_VERSION);
+        bin_put_u16(header + 6, (uint16_t)num_options);
+        bin_put_u64(header + 8, hash);
+        if (ftruncate(journal->fd, 0) < 0 || write_all(journal->fd, header, sizeof(header)) < 0 ||
+            fdatasync(journal->fd) < 0) {
+            close(journal->fd);
+            return -1;
+        }
+    } else {
+        size_t size = st.st_size;
+        if (read_all(journal->fd, header, sizeof(header)) < 0 ||
+            bin_get_u32(header) != JOURNAL_MAGIC || bin_get_u16(header + 4) != JOURNAL_VERSION ||
+            bin_get_u16(header + 6) != num_options || bin_get_u64(header + 8) != hash) {
+            close(journal->fd);
+            errno = EINVAL;
+            return -1;
+        }
+
+        // Só a cauda depois do checkpoint precisa ser lida. Um checkpoint
+        // além do fim do arquivo (journal recriado) faz reaplicar tudo; a
+        // reaplicação é idempotente (votos repetidos são ignorados).
+        size_t start = JOURNAL_HEADER_SIZE;
+        if (replay_from > start && replay_from <= size) {
+            start = replay_from;
+        }
+        uint8_t *data = malloc(size - start + 1);
+        if (data == NULL || lseek(journal->fd, start, SEEK_SET) < 0 ||
+            read_all(journal->fd, data, size - start) < 0) {
+            free(data);
+            close(journal->fd);
+            return -1;
+        }
+        valid = start + replay_records(data, size - start, replay, ctx);
+        free(data);
+
+        // Cauda inválida depois de um checkpoint: antes de cortar, confere
+        // lendo desde o início se o LSN do checkpoint cai mesmo no limite de
+        // um registro (reaplicar o que o checkpoint já tem é inofensivo)
+        if (valid < size && start > JOURNAL_HEADER_SIZE) {
+            start = JOURNAL_HEADER_SIZE;
+            data = malloc(size - start + 1);
+            if (data == NULL || lseek(journal->fd, start, SEEK_SET) < 0 ||
+                read_all(journal->fd, data, size - start) < 0) {
+                free(data);
+                close(journal->fd);
+                return -1;
+            }
+            valid = start + replay_records(data, size - start, replay, ctx);
+            free(data);
+        }
+
+        // Descarta o fim rasgado por uma queda no meio de uma escrita
+        if (valid < size && (ftruncate(journal->fd, valid) < 0 || fdatasync(journal->fd) < 0)) {
+            close(journal->fd);
+            return -1;
+        }
+    }
+
+    if (lseek(journal->fd, valid, SEEK_SET) < 0) {
+        close(journal->fd);
+        return -1;
+    }
+
+    journal->enabled = true;
+    journal->appended_lsn = valid;
+    atomic_init(&journal->durable_lsn, valid);
+    atomic_init(&journal->records, 0);
+    atomic_init(&journal->syncs, 0);
+    pthread_mutex_init(&journal->lock, NULL);
+    pthread_cond_init(&journal->has_data, NULL);
+    pthread_cond_init(&journal->durable_cond, NULL);
+    return 0;
+}
+
+void journal_disable(Journal *journal) {
+    memset(journal, 0, sizeof(*journal));
+    journal->fd = -1;
+}
+
+int journal_add_notify(Journal *journal, int fd) {
+    if (!journal->enabled) {
+        return 0;
+    }
+    pthread_mutex_lock(&journal->lock);
+    int result = -1;
+    if (journal->num_notify < JOURNAL_MAX_NOTIFY) {
+        journal->notify_fds[journal->num_notify++] = fd;
+        result = 0;
+    }
+    pthread_mutex_unlock(&journal->lock);
+    return result;
+}
+
+static void sleep_ns(uint64_t ns) {
+    struct timespec ts = {(time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL)};
+    nanosleep(&ts, NULL);
+}
+
+static void *writer_thread(void *arg) {
+    Journal *journal = (Journal *)arg;
+    char *batch = NULL;
+    size_t batch_cap = 0;
+
+    pthread_mutex_lock(&journal->lock);
+    while (1) {
+        while (journal->running && journal->pending_len == 0) {
+            pthread_cond_wait(&journal->has_data, &journal->lock);
+        }
+        if (journal->pending_len == 0) {
+            break;
+        }
+
+        // Janela de group commit: deixa outros votos chegarem ao lote
+        if (journal->window_ns > 0 && journal->running) {
+            pthread_mutex_unlock(&journal->lock);
+            sleep_ns(journal->window_ns);
+            pthread_mutex_lock(&journal->lock);
+        }
+
+        // Troca de buffer: os votos seguintes vão para o outro enquanto
+        // este é gravado
+        char *full = journal->pending;
+        size_t full_cap = journal->pending_cap;
+        size_t len = journal->pending_len;
+        journal->pending = batch;
+        journal->pending_cap = batch_cap;
+        journal->pending_len = 0;
+        batch = full;
+        batch_cap = full_cap;
+        uint64_t lsn = journal->appended_lsn;
+        int num_notify = journal->num_notify;
+        pthread_mutex_unlock(&journal->lock);
+
+        if (write_all(journal->fd, batch, len) < 0 || fdatasync(journal->fd) < 0) {
+            // Sem garantia de durabilidade não dá para confirmar votos
+            perror("Erro ao gravar journal de votos");
+            exit(1);
+        }
+        atomic_store_explicit(&journal->durable_lsn, lsn, memory_order_release);
+        atomic_fetch_add_explicit(&journal->syncs, 1, memory_order_relaxed);
+
+        uint64_t one = 1;
+        for (int i = 0; i < num_notify; i++) {
+            if (write(journal->notify_fds[i], &one, sizeof(one)) < 0) {
+                // eventfd já sinalizado: o loop vai acordar de qualquer forma
+            }
+        }
+
+        pthread_mutex_lock(&journal->lock);
+        pthread_cond_broadcast(&journal->durable_cond);
+    }
+    pthread_mutex_unlock(&journal->lock);
+
+    free(batch);
+    return NULL;
+}
+
+int journal_start(Journal *journal, uint64_t window_ns) {
+    if (!journal->enabled) {
+        return 0;
+    }
+    journal->window_ns = window_ns;
+    journal->running = true;
+    if (pthread_create(&journal->writer, NULL, writer_thread, journal) != 0) {
+        journal->running = false;
+        return -1;
+    }
+    return 0;
+}
+
+uint64_t journal_append(Journal *journal, JournalRecordType type, int option_index, const char *voter_id) {
+    if (!journal->enabled) {
+        return 0;
+    }
+
+    uint8_t record[JOURNAL_RECORD_HEADER + MAX_VOTER_ID];
+    size_t id_len = voter_id ? strnlen(voter_id, MAX_VOTER_ID - 1) : 0;
+    size_t record_len = JOURNAL_RECORD_HEADER + id_len;
+    record[4] = (uint8_t)type;
+    bin_put_u32(record + 5, (uint32_t)option_index);
+    record[9] = (uint8_t)id_len;
+    memcpy(record + JOURNAL_RECORD_HEADER, voter_id, id_len);
+    bin_put_u32(record, crc32(record + 4, record_len - 4));
+
+    pthread_mutex_lock(&journal->lock);
+    if (journal->pending_len + record_len > journal->pending_cap) {
+        size_t new_cap = journal->pending_cap ? journal->pending_cap * 2 : 64 * 1024;
+        char *new_pending = realloc(journal->pending, new_cap);
+        if (new_pending == NULL) {
+            pthread_mutex_unlock(&journal->lock);
+            return 0;
+        }
+        journal->pending = new_pending;
+        journal->pending_cap = new_cap;
+    }
+    memcpy(journal->pending + journal->pending_len, record, record_len);
+    journal->pending_len += record_len;
+    journal->appended_lsn += record_len;
+    uint64_t lsn = journal->appended_lsn;
+    pthread_cond_signal(&journal->has_data);
+    pthread_mutex_unlock(&journal->lock);
+
+    atomic_fetch_add_explicit(&journal->records, 1, memory_order_relaxed);
+    return lsn;
+}
+
+void journal_wait(Journal *journal, uint64_t lsn) {
+    if (journal_durable(journal) >= lsn) {
+        return;
+    }
+    pthread_mutex_lock(&journal->lock);
+    while (journal_durable(journal) < lsn) {
+        pthread_cond_wait(&journal->durable_cond, &journal->lock);
+    }
+    pthread_mutex_unlock(&journal->lock);
+}
+
+uint64_t journal_pause(Journal *journal) {
+    if (!journal->enabled) {
+        return 0;
+    }
+    pthread_mutex_lock(&journal->lock);
+    return journal->appended_lsn;
+}
+
+void journal_resume(Journal *journal) {
+    if (journal->enabled) {
+        pthread_mutex_unlock(&journal->lock);
+    }
+}
+
+void journal_shutdown(Journal *journal) {
+    if (!journal->enabled) {
+        return;
+    }
+    pthread_mutex_lock(&journal->lock);
+    bool was_running = journal->running;
+    journal->running = false;
+    pthread_cond_signal(&journal->has_data);
+    pthread_mutex_unlock(&journal->lock);
+
+    if (was_running) {
+        pthread_join(journal->writer, NULL);
+    }
+    if (journal->fd >= 0) {
+        close(journal->fd);
+        journal->fd = -1;
+    }
+
+    // Outras threads podem acrescentar registros até o processo sair: eles
+    // ficam na memória e os votos nunca são confirmados
+    pthread_mutex_lock(&journal->lock);
+    free(journal->pending);
+    journal->pending = NULL;
+    journal->pending_cap = journal->pending_len = 0;
+    pthread_mutex_unlock(&journal->lock);
+}
@@ -0,0 +1,108 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "protocol.h"
+
+// Journal de votos: arquivo binário só de acréscimo. Cada voto aceito vira
+// um registro com CRC; uma thread grava os registros em lote e faz um
+// único fdatasync para todos (group commit). O LSN de um registro é a
+// posição do seu fim no arquivo: ele está em disco quando
+// journal_durable() >= LSN.
+//
+// Arquivo: cabeçalho [magic u32][versão u16][opções u16][hash das opções u64]
+// seguido de registros [crc32 u32][tipo u8][opção u32][tamanho u8][VOTER_ID]
+// (inteiros big-endian; o CRC cobre tudo depois dele).
+#define JOURNAL_MAGIC 0x564F544AU       // "VOTJ"
+#define JOURNAL_VERSION 2
+#define JOURNAL_HEADER_SIZE 16
+#define JOURNAL_RECORD_HEADER 10
+
+// Máximo de event loops avisados a cada fsync
+#define JOURNAL_MAX_NOTIFY 64
+
+typedef enum {
+    JOURNAL_VOTE = 1,
+    JOURNAL_CLOSE = 2       // eleição encerrada (sem VOTER_ID)
+} JournalRecordType;
+
+typedef struct {
+    JournalRecordType type;
+    int option_index;
+    char voter_id[MAX_VOTER_ID];
+} JournalEntry;
+
+// Chamada para cada registro válido durante a recuperação
+typedef void (*JournalReplayFn)(void *ctx, const JournalEntry *entry);
+
+typedef struct {
+    bool enabled;
+    int fd;
+
+    pthread_mutex_t lock;
+    pthread_cond_t has_data;    // acorda a thread de escrita
+    pthread_cond_t durable_cond;    // acorda quem espera em journal_wait
+    char *pending;              // registros ainda não gravados
+    size_t pending_len;
+    size_t pending_cap;
+    uint64_t appended_lsn;      // fim do último registro acrescentado
+    bool running;
+
+    _Atomic uint64_t durable_lsn;
+    uint64_t window_ns;         // espera antes de gravar para juntar mais votos
+
+    int notify_fds[JOURNAL_MAX_NOTIFY];     // eventfds dos event loops
+    int num_notify;
+
+    _Atomic uint64_t records;
+    _Atomic uint64_t syncs;
+
+    pthread_t writer;
+} Journal;
+
+// Abre (ou cria) o journal e reaplica via replay os registros a partir do
+// LSN replay_from (fim do último checkpoint; 0 = desde o início). Um
+// registro final incompleto ou com CRC inválido (queda durante a escrita)
+// é descartado; se a leitura a partir de replay_from não chega ao fim, o
+// arquivo é relido desde o início antes de cortar algo. Retorna -1 em erro de E/S ou se o journal foi criado com
+// outra lista de opções.
+int journal_open(Journal *journal, const char *path, const char *const *names, int num_options,
+                 uint64_t replay_from, JournalReplayFn replay, void *ctx);
+
+// Hash que identifica a lista de opções (gravado no cabeçalho)
+uint64_t journal_options_hash(const char *const *names, int num_options);
+
+// Journal desligado: acréscimos retornam LSN 0 e nada é esperado
+void journal_disable(Journal *journal);
+
+// Inicia a thread de group commit com janela de window_ns
+int journal_start(Journal *journal, uint64_t window_ns);
+
+// Registra um eventfd avisado a cada lote gravado
+int journal_add_notify(Journal *journal, int fd);
+
+// Acrescenta um registro e retorna seu LSN (0 com o journal desligado ou
+// sem memória para o registro)
+uint64_t journal_append(Journal *journal, JournalRecordType type, int option_index, const char *voter_id);
+
+// Bloqueia até o LSN estar em disco
+void journal_wait(Journal *journal, uint64_t lsn);
+
+static inline uint64_t journal_durable(Journal *journal) {
+    return atomic_load_explicit(&journal->durable_lsn, memory_order_acquire);
+}
+
+// Impede novos acréscimos até journal_resume e retorna o LSN do último
+// registro acrescentado (usado pelo checkpoint)
+uint64_t journal_pause(Journal *journal);
+void journal_resume(Journal *journal);
+
+// Grava o que estiver pendente e encerra a thread de escrita. Registros
+// acrescentados depois não vão mais para o disco (nem ficam duráveis).
+void journal_shutdown(Journal *journal);
+
+#endif
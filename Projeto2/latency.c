@@ -0,0 +1,92 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "latency.h"
+
+// Bloco de histogramas de uma thread. Blocos nunca são liberados: quando
+// a thread termina o bloco volta para a lista livre e é reaproveitado
+// (com as contagens acumuladas) pela próxima thread.
+typedef struct LatencyBlock {
+    Histogram hist[STAT_COMMANDS];
+    struct LatencyBlock *next;          // lista de todos os blocos
+    struct LatencyBlock *next_free;
+} LatencyBlock;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static LatencyBlock *_Atomic all_blocks;
+static LatencyBlock *free_blocks;
+static pthread_key_t block_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static __thread LatencyBlock *thread_block;
+
+static const char *command_names[STAT_COMMANDS] = {"HELLO", "LIST", "VOTE", "SCORE"};
+
+const char *latency_command_name(CommandStat cmd) {
+    if (cmd < 0 || cmd >= STAT_COMMANDS) {
+        return "?";
+    }
+    return command_names[cmd];
+}
+
+static void release_block(void *arg) {
+    LatencyBlock *block = arg;
+    pthread_mutex_lock(&registry_lock);
+    block->next_free = free_blocks;
+    free_blocks = block;
+    pthread_mutex_unlock(&registry_lock);
+}
+
+static void create_key(void) {
+    pthread_key_create(&block_key, release_block);
+}
+
+// Obtém o bloco da thread; só entra no lock na primeira chamada da thread
+static LatencyBlock *acquire_block(void) {
+    pthread_once(&key_once, create_key);
+
+    pthread_mutex_lock(&registry_lock);
+    LatencyBlock *block = free_blocks;
+    if (block != NULL) {
+        free_blocks = block->next_free;
+    } else {
+        block = aligned_alloc(64, (sizeof(LatencyBlock) + 63) / 64 * 64);
+        if (block != NULL) {
+            for (int i = 0; i < STAT_COMMANDS; i++) {
+                histogram_reset(&block->hist[i]);
+            }
+            block->next = atomic_load_explicit(&all_blocks, memory_order_relaxed);
+            atomic_store_explicit(&all_blocks, block, memory_order_release);
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    if (block != NULL) {
+        pthread_setspecific(block_key, block);
+    }
+    return block;
+}
+
+void latency_record(CommandStat cmd, uint64_t ns) {
+    if (cmd < 0 || cmd >= STAT_COMMANDS) {
+        return;
+    }
+    if (thread_block == NULL) {
+        thread_block = acquire_block();
+        if (thread_block == NULL) {
+            return;
+        }
+    }
+    histogram_record(&thread_block->hist[cmd], ns);
+}
+
+void latency_collect(Histogram *merged) {
+    for (int i = 0; i < STAT_COMMANDS; i++) {
+        histogram_reset(&merged[i]);
+    }
+    for (LatencyBlock *block = atomic_load_explicit(&all_blocks, memory_order_acquire);
+         block != NULL; block = block->next) {
+        for (int i = 0; i < STAT_COMMANDS; i++) {
+            histogram_merge(&merged[i], &block->hist[i]);
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <time.h>
+#include "histogram.h"
+
+// Comandos com histograma de latência (do recv ao send)
+typedef enum {
+    STAT_HELLO,
+    STAT_LIST,
+    STAT_VOTE,
+    STAT_SCORE,
+    STAT_COMMANDS,
+    STAT_NONE = -1      // comando sem histograma (BYE, ADMIN, desconhecido)
+} CommandStat;
+
+// Nome do comando para relatórios
+const char *latency_command_name(CommandStat cmd);
+
+// Registra a latência em nanossegundos no histograma da thread atual.
+// Não usa locks nem escreve em linhas de cache de outras threads.
+void latency_record(CommandStat cmd, uint64_t ns);
+
+// Soma os histogramas de todas as threads em merged[STAT_COMMANDS]
+void latency_collect(Histogram *merged);
+
+static inline uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#endif
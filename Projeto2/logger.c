@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#include "logger.h"
+
+// Tamanho do lote que o writer acumula antes de cada write()
+#define LOG_BATCH_BYTES (256 * 1024)
+// Espera do writer quando a fila está vazia
+#define LOG_IDLE_SLEEP_NS 1000000L
+
+static void sleep_ns(long ns) {
+    struct timespec ts = {0, ns};
+    nanosleep(&ts, NULL);
+}
+
+static void write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+// Reserva um slot na fila. Retorna NULL se a fila estiver cheia.
+static LogRecord *reserve(Logger *logger, uint64_t *pos_out) {
+    uint64_t pos = atomic_load_explicit(&logger->head, memory_order_relaxed);
+
+    while (1) {
+        LogRecord *record = &logger->ring[pos & logger->mask];
+        uint64_t seq = atomic_load_explicit(&record->seq, memory_order_acquire);
+        int64_t diff = (int64_t)(seq - pos);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&logger->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *pos_out = pos;
+                return record;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&logger->head, memory_order_relaxed);
+        }
+    }
+}
+
+void logger_vlog(Logger *logger, const char *format, va_list args) {
+    uint64_t pos;
+    LogRecord *record;
+
+    // Sem a thread de escrita a fila cheia nunca esvazia: até o modo
+    // block descarta
+    while ((record = reserve(logger, &pos)) == NULL) {
+        if (logger->policy != LOG_FULL_BLOCK ||
+            !atomic_load_explicit(&logger->writer_alive, memory_order_acquire)) {
+            atomic_fetch_add_explicit(&logger->dropped, 1, memory_order_relaxed);
+            return;
+        }
+        sched_yield();
+    }
+
+    // time() é resolvido pelo vDSO, sem syscall
+    record->timestamp = time(NULL);
+    int len = vsnprintf(record->text, LOG_MSG_MAX, format, args);
+    if (len < 0) {
+        len = 0;
+    } else if (len >= LOG_MSG_MAX) {
+        len = LOG_MSG_MAX - 1;
+    }
+    record->len = (uint32_t)len;
+
+    atomic_store_explicit(&record->seq, pos + 1, memory_order_release);
+}
+
+void logger_log(Logger *logger, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    logger_vlog(logger, format, args);
+    va_end(args);
+}
+
+// Anexa uma linha "[timestamp] texto\n" ao lote. O timestamp formatado é
+// reaproveitado enquanto o segundo não muda.
+static size_t append_line(char *batch, size_t used, time_t timestamp, const char *text, size_t len,
+                          time_t *cached_second, char *cached_stamp, size_t *stamp_len) {
+    if (timestamp != *cached_second) {
+        struct tm tm_now;
+        localtime_r(&timestamp, &tm_now);
+        *stamp_len = strftime(cached_stamp, 32, "[%Y-%m-%d %H:%M:%S] ", &tm_now);
+        *cached_second = timestamp;
+    }
+    memcpy(batch + used, cached_stamp, *stamp_len);
+    used += *stamp_len;
+    memcpy(batch + used, text, len);
+    used += len;
+    batch[used++] = '\n';
+    return used;
+}
+
+static void *writer_thread(void *arg) {
+    Logger *logger = (Logger *)arg;
+    char *batch = malloc(LOG_BATCH_BYTES);
+    time_t cached_second = (time_t)-1;
+    char cached_stamp[32];
+    size_t stamp_len = 0;
+
+    if (batch == NULL) {
+        perror("Erro ao alocar buffer do log");
+        atomic_store_explicit(&logger->writer_alive, false, memory_order_release);
+        return NULL;
+    }
+
+    while (1) {
+        size_t used = 0;
+        uint64_t count = 0;
+
+        // Junta no lote tudo o que estiver pronto, até encher o buffer
+        while (used + LOG_MSG_MAX + 64 <= LOG_BATCH_BYTES) {
+            LogRecord *record = &logger->ring[logger->tail & logger->mask];
+            uint64_t seq = atomic_load_explicit(&record->seq, memory_order_acquire);
+            if (seq != logger->tail + 1) {
+                break;
+            }
+            used = append_line(batch, used, record->timestamp, record->text, record->len,
+                               &cached_second, cached_stamp, &stamp_len);
+            atomic_store_explicit(&record->seq, logger->tail + logger->mask + 1, memory_order_release);
+            logger->tail++;
+            count++;
+        }
+
+        uint64_t dropped = atomic_load_explicit(&logger->dropped, memory_order_relaxed);
+        if (logger->policy == LOG_FULL_COUNT && dropped != logger->dropped_reported &&
+            used + 128 <= LOG_BATCH_BYTES) {
+            char note[96];
+            int len = snprintf(note, sizeof(note), "%llu mensagens de log descartadas (buffer cheio)",
+                               (unsigned long long)(dropped - logger->dropped_reported));
+            used = append_line(batch, used, time(NULL), note, len,
+                               &cached_second, cached_stamp, &stamp_len);
+            logger->dropped_reported = dropped;
+        }
+
+        if (used > 0) {
+            write_all(logger->fd, batch, used);
+            atomic_fetch_add_explicit(&logger->written, count, memory_order_release);
+            continue;
+        }
+
+        if (!atomic_load_explicit(&logger->running, memory_order_acquire) &&
+            logger->tail == atomic_load_explicit(&logger->head, memory_order_acquire)) {
+            break;
+        }
+        sleep_ns(LOG_IDLE_SLEEP_NS);
+    }
+
+    atomic_store_explicit(&logger->writer_alive, false, memory_order_release);
+    free(batch);
+    return NULL;
+}
+
+int logger_init(Logger *logger, const char *path, size_t capacity, LogFullPolicy policy, int level) {
+    size_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    logger->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (logger->fd < 0) {
+        return -1;
+    }
+
+    logger->ring = aligned_alloc(64, size * sizeof(LogRecord));
+    if (logger->ring == NULL) {
+        close(logger->fd);
+        return -1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&logger->ring[i].seq, i);
+    }
+
+    logger->mask = size - 1;
+    logger->policy = policy;
+    logger->level = level;
+    logger->tail = 0;
+    logger->dropped_reported = 0;
+    atomic_init(&logger->head, 0);
+    atomic_init(&logger->written, 0);
+    atomic_init(&logger->dropped, 0);
+    atomic_init(&logger->running, true);
+    atomic_init(&logger->writer_alive, true);
+
+    if (pthread_create(&logger->writer, NULL, writer_thread, logger) != 0) {
+        free(logger->ring);
+        close(logger->fd);
+        return -1;
+    }
+    return 0;
+}
+
+void logger_flush(Logger *logger) {
+    uint64_t target = atomic_load_explicit(&logger->head, memory_order_acquire);
+    while (atomic_load_explicit(&logger->written, memory_order_acquire) < target) {
+        if (!atomic_load_explicit(&logger->running, memory_order_acquire) ||
+            !atomic_load_explicit(&logger->writer_alive, memory_order_acquire)) {
+            return;
+        }
+        sleep_ns(LOG_IDLE_SLEEP_NS);
+    }
+}
+
+void logger_stop(Logger *logger) {
+    atomic_store_explicit(&logger->running, false, memory_order_release);
+    pthread_join(logger->writer, NULL);
+    close(logger->fd);
+}
+
+void logger_shutdown(Logger *logger) {
+    logger_stop(logger);
+    free(logger->ring);
+    logger->ring = NULL;
+}
+
+int logger_parse_policy(const char *name, LogFullPolicy *policy) {
+    if (strcmp(name, "drop") == 0) {
+        *policy = LOG_FULL_DROP;
+    } else if (strcmp(name, "block") == 0) {
+        *policy = LOG_FULL_BLOCK;
+    } else if (strcmp(name, "count") == 0) {
+        *policy = LOG_FULL_COUNT;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int logger_parse_level(const char *name, int *level) {
+    static const char *names[] = {"error", "info", "debug", "trace"};
+    for (int i = 0; i <= LOG_LEVEL_TRACE; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *level = i;
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,94 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+// Tamanho máximo de uma mensagem (texto maior é truncado); com os
+// demais campos cada registro ocupa 512 bytes
+#define LOG_MSG_MAX 492
+#define LOG_DEFAULT_CAPACITY 16384
+
+// Níveis de log. Mensagens acima de LOG_COMPILE_LEVEL nem são compiladas;
+// as demais são filtradas em tempo de execução pelo nível do logger.
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_DEBUG 2
+#define LOG_LEVEL_TRACE 3
+
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_TRACE
+#endif
+
+// O que fazer quando o ring buffer está cheio
+typedef enum {
+    LOG_FULL_DROP,      // descarta a mensagem silenciosamente
+    LOG_FULL_BLOCK,     // espera o writer liberar espaço
+    LOG_FULL_COUNT      // descarta e registra no log quantas foram perdidas
+} LogFullPolicy;
+
+// Registro no ring buffer. seq segue o esquema de Vyukov: indica se o
+// slot está livre para o produtor da posição pos (seq == pos) ou pronto
+// para o consumidor (seq == pos + 1).
+typedef struct {
+    _Atomic uint64_t seq;
+    time_t timestamp;
+    uint32_t len;
+    char text[LOG_MSG_MAX];
+} LogRecord;
+
+// Logger assíncrono: fila MPSC sem lock onde as threads de trabalho
+// depositam mensagens (sem syscalls) e uma thread dedicada que formata
+// e grava em lotes.
+typedef struct {
+    LogRecord *ring;
+    size_t mask;
+    LogFullPolicy policy;
+    int level;                  // nível máximo registrado em tempo de execução
+
+    _Atomic uint64_t head __attribute__((aligned(64)));    // próxima posição a reservar
+    _Atomic uint64_t written __attribute__((aligned(64))); // registros já gravados
+    _Atomic uint64_t dropped;
+    _Atomic bool running;
+    _Atomic bool writer_alive;  // a thread de escrita ainda consome a fila
+
+    uint64_t tail __attribute__((aligned(64)));            // só o writer acessa
+    uint64_t dropped_reported;
+    int fd;
+    pthread_t writer;
+} Logger;
+
+// Abre o arquivo em modo append e inicia a thread de escrita.
+// capacity é arredondada para potência de 2.
+int logger_init(Logger *logger, const char *path, size_t capacity, LogFullPolicy policy, int level);
+
+// Enfileira uma mensagem formatada
+void logger_vlog(Logger *logger, const char *format, va_list args);
+void logger_log(Logger *logger, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Espera até que tudo o que foi enfileirado antes da chamada esteja no
+// arquivo. Retorna sem esperar se o logger está parando ou a thread de
+// escrita já saiu (ninguém mais grava).
+void logger_flush(Logger *logger);
+
+// Esvazia a fila, encerra a thread de escrita e fecha o arquivo. A fila
+// continua valendo: outras threads ainda podem registrar mensagens (que
+// não são mais gravadas), então serve para encerrar o processo com elas
+// rodando.
+void logger_stop(Logger *logger);
+
+// logger_stop e libera a fila (nenhuma outra thread pode mais registrar)
+void logger_shutdown(Logger *logger);
+
+// Converte "drop", "block" ou "count"; retorna -1 se inválido
+int logger_parse_policy(const char *name, LogFullPolicy *policy);
+
+// Converte "error", "info", "debug" ou "trace"; retorna -1 se inválido
+int logger_parse_level(const char *name, int *level);
+
+#endif
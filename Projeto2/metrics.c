@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "metrics.h"
+#include "connection.h"
+
+#define METRICS_BODY_SIZE 8192
+
+// Bloco de contadores de uma thread, numa linha de cache própria. Como os
+// de latência, blocos nunca são liberados: voltam para a lista livre quando
+// a thread termina e são reaproveitados com os valores acumulados.
+typedef struct MetricsBlock {
+    Metrics metrics;
+    struct MetricsBlock *next;          // lista de todos os blocos
+    struct MetricsBlock *next_free;
+} MetricsBlock;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static MetricsBlock *_Atomic all_blocks;
+static MetricsBlock *free_blocks;
+static pthread_key_t block_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static __thread MetricsBlock *thread_block;
+
+static const char *command_names[METRIC_COMMANDS] = {
+    "HELLO", "LIST", "VOTE", "SCORE", "WATCH", "BYE", "ADMIN", "PEER", "UNKNOWN"
+};
+
+// Rótulos dos resultados de VOTE, na ordem de VoteResult
+static const char *vote_names[METRIC_VOTE_RESULTS] = {
+    "accepted", "duplicate", "invalid", "closed", "no_memory", "unavailable"
+};
+
+// Rótulos das recusas do cadastro, na ordem de RollLookup
+static const char *roll_names[ROLL_RESULTS] = {
+    "eligible", "bloom", "index"
+};
+
+static void release_block(void *arg) {
+    MetricsBlock *block = arg;
+    pthread_mutex_lock(&registry_lock);
+    block->next_free = free_blocks;
+    free_blocks = block;
+    pthread_mutex_unlock(&registry_lock);
+}
+
+static void create_key(void) {
+    pthread_key_create(&block_key, release_block);
+}
+
+static MetricsBlock *acquire_block(void) {
+    pthread_once(&key_once, create_key);
+
+    pthread_mutex_lock(&registry_lock);
+    MetricsBlock *block = free_blocks;
+    if (block != NULL) {
+        free_blocks = block->next_free;
+    } else {
+        block = aligned_alloc(64, (sizeof(MetricsBlock) + 63) / 64 * 64);
+        if (block != NULL) {
+            memset(block, 0, sizeof(*block));
+            block->next = atomic_load_explicit(&all_blocks, memory_order_relaxed);
+            atomic_store_explicit(&all_blocks, block, memory_order_release);
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    if (block != NULL) {
+        pthread_setspecific(block_key, block);
+    }
+    return block;
+}
+
+Metrics *metrics_thread(void) {
+    if (thread_block == NULL) {
+        thread_block = acquire_block();
+        if (thread_block == NULL) {
+            return NULL;
+        }
+    }
+    return &thread_block->metrics;
+}
+
+static uint64_t load(_Atomic uint64_t *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+void metrics_collect(MetricsSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    for (MetricsBlock *block = atomic_load_explicit(&all_blocks, memory_order_acquire);
+         block != NULL; block = block->next) {
+        Metrics *m = &block->metrics;
+        snapshot->connections_opened += load(&m->connections_opened);
+        snapshot->connections_closed += load(&m->connections_closed);
+        snapshot->connections_busy += load(&m->connections_busy);
+        for (int i = 0; i < TIMEOUT_REASONS; i++) {
+            snapshot->evictions[i] += load(&m->evictions[i]);
+        }
+        for (int i = 0; i < METRIC_COMMANDS; i++) {
+            snapshot->commands[i] += load(&m->commands[i]);
+        }
+        for (int i = 0; i < METRIC_VOTE_RESULTS; i++) {
+            snapshot->votes[i] += load(&m->votes[i]);
+        }
+        for (int i = 0; i < ROLL_RESULTS; i++) {
+            snapshot->roll_rejects[i] += load(&m->roll_rejects[i]);
+        }
+        snapshot->bytes_in += load(&m->bytes_in);
+        snapshot->bytes_out += load(&m->bytes_out);
+        snapshot->io_syscalls += load(&m->io_syscalls);
+        snapshot->lock_waits += load(&m->lock_waits);
+        snapshot->lock_wait_ns += load(&m->lock_wait_ns);
+    }
+}
+
+// Abertas menos fechadas; as duas somas não são lidas no mesmo instante
+static uint64_t active_connections(const MetricsSnapshot *s) {
+    return s->connections_opened > s->connections_closed ? s->connections_opened - s->connections_closed : 0;
+}
+
+// snprintf acumulando em out; para de escrever quando não cabe mais
+#define APPEND(out, size, len, ...) \
+    do { \
+        if ((len) < (size)) { \
+            (len) += snprintf((out) + (len), (size) - (len), __VA_ARGS__); \
+        } \
+    } while (0)
+
+size_t metrics_format_line(char *out, size_t size) {
+    MetricsSnapshot s;
+    metrics_collect(&s);
+    size_t len = 0;
+
+    APPEND(out, size, len, "STATS connections_active=%llu connections_opened=%llu connections_closed=%llu "
+           "connections_busy=%llu", (unsigned long long)active_connections(&s),
+           (unsigned long long)s.connections_opened, (unsigned long long)s.connections_closed,
+           (unsigned long long)s.connections_busy);
+    for (int i = TIMEOUT_NONE + 1; i < TIMEOUT_REASONS; i++) {
+        APPEND(out, size, len, " evicted_%s=%llu", timeout_reason_name(i), (unsigned long long)s.evictions[i]);
+    }
+    for (int i = 0; i < METRIC_COMMANDS; i++) {
+        APPEND(out, size, len, " cmd_%s=%llu", command_names[i], (unsigned long long)s.commands[i]);
+    }
+    for (int i = 0; i < METRIC_VOTE_RESULTS; i++) {
+        APPEND(out, size, len, " votes_%s=%llu", vote_names[i], (unsigned long long)s.votes[i]);
+    }
+    for (int i = ROLL_ELIGIBLE + 1; i < ROLL_RESULTS; i++) {
+        APPEND(out, size, len, " hello_not_eligible_%s=%llu", roll_names[i],
+               (unsigned long long)s.roll_rejects[i]);
+    }
+    APPEND(out, size, len, " bytes_in=%llu bytes_out=%llu io_syscalls=%llu lock_waits=%llu lock_wait_us=%llu\n",
+           (unsigned long long)s.bytes_in, (unsigned long long)s.bytes_out, (unsigned long long)s.io_syscalls,
+           (unsigned long long)s.lock_waits, (unsigned long long)(s.lock_wait_ns / 1000));
+    if (len >= size) {
+        len = size - 1;
+    }
+    return len;
+}
+
+// Formato de exposição em texto do Prometheus (versão 0.0.4)
+static size_t format_prometheus(char *out, size_t size) {
+    MetricsSnapshot s;
+    metrics_collect(&s);
+    size_t len = 0;
+
+    APPEND(out, size, len, "# HELP votacao_connections_active Conexões abertas\n"
+           "# TYPE votacao_connections_active gauge\n"
+           "votacao_connections_active %llu\n", (unsigned long long)active_connections(&s));
+    APPEND(out, size, len, "# HELP votacao_connections_opened_total Conexões aceitas e atendidas\n"
+           "# TYPE votacao_connections_opened_total counter\n"
+           "votacao_connections_opened_total %llu\n", (unsigned long long)s.connections_opened);
+    APPEND(out, size, len, "# HELP votacao_connections_closed_total Conexões encerradas\n"
+           "# TYPE votacao_connections_closed_total counter\n"
+           "votacao_connections_closed_total %llu\n", (unsigned long long)s.connections_closed);
+    APPEND(out, size, len, "# HELP votacao_connections_busy_total Conexões recusadas com ERR BUSY\n"
+           "# TYPE votacao_connections_busy_total counter\n"
+           "votacao_connections_busy_total %llu\n", (unsigned long long)s.connections_busy);
+    APPEND(out, size, len, "# HELP votacao_connections_evicted_total Conexões fechadas por prazo vencido\n"
+           "# TYPE votacao_connections_evicted_total counter\n");
+    for (int i = TIMEOUT_NONE + 1; i < TIMEOUT_REASONS; i++) {
+        APPEND(out, size, len, "votacao_connections_evicted_total{reason=\"%s\"} %llu\n", timeout_reason_name(i),
+               (unsigned long long)s.evictions[i]);
+    }
+
+    APPEND(out, size, len, "# HELP votacao_commands_total Comandos processados por tipo\n"
+           "# TYPE votacao_commands_total counter\n");
+    for (int i = 0; i < METRIC_COMMANDS; i++) {
+        APPEND(out, size, len, "votacao_commands_total{command=\"%s\"} %llu\n", command_names[i],
+               (unsigned long long)s.commands[i]);
+    }
+
+    APPEND(out, size, len, "# HELP votacao_votes_accepted_total Votos aceitos\n"
+           "# TYPE votacao_votes_accepted_total counter\n"
+           "votacao_votes_accepted_total %llu\n", (unsigned long long)s.votes[VOTE_RECORDED]);
+    APPEND(out, size, len, "# HELP votacao_votes_rejected_total Votos recusados por motivo\n"
+           "# TYPE votacao_votes_rejected_total counter\n");
+    for (int i = VOTE_RECORDED + 1; i < METRIC_VOTE_RESULTS; i++) {
+        APPEND(out, size, len, "votacao_votes_rejected_total{reason=\"%s\"} %llu\n", vote_names[i],
+               (unsigned long long)s.votes[i]);
+    }
+
+    APPEND(out, size, len, "# HELP votacao_hello_not_eligible_total HELLO recusados fora do cadastro de "
+           "eleitores, por onde foram recusados\n"
+           "# TYPE votacao_hello_not_eligible_total counter\n");
+    for (int i = ROLL_ELIGIBLE + 1; i < ROLL_RESULTS; i++) {
+        APPEND(out, size, len, "votacao_hello_not_eligible_total{stage=\"%s\"} %llu\n", roll_names[i],
+               (unsigned long long)s.roll_rejects[i]);
+    }
+
+    APPEND(out, size, len, "# HELP votacao_bytes_received_total Bytes recebidos dos clientes\n"
+           "# TYPE votacao_bytes_received_total counter\n"
+           "votacao_bytes_received_total %llu\n", (unsigned long long)s.bytes_in);
+    APPEND(out, size, len, "# HELP votacao_bytes_sent_total Bytes enviados aos clientes\n"
+           "# TYPE votacao_bytes_sent_total counter\n"
+           "votacao_bytes_sent_total %llu\n", (unsigned long long)s.bytes_out);
+    APPEND(out, size, len, "# HELP votacao_io_syscalls_total Syscalls de E/S com os clientes\n"
+           "# TYPE votacao_io_syscalls_total counter\n"
+           "votacao_io_syscalls_total %llu\n", (unsigned long long)s.io_syscalls);
+    APPEND(out, size, len, "# HELP votacao_lock_waits_total Locks do cadastro de votantes encontrados ocupados\n"
+           "# TYPE votacao_lock_waits_total counter\n"
+           "votacao_lock_waits_total %llu\n", (unsigned long long)s.lock_waits);
+    APPEND(out, size, len, "# HELP votacao_lock_wait_seconds_total Tempo esperando esses locks\n"
+           "# TYPE votacao_lock_wait_seconds_total counter\n"
+           "votacao_lock_wait_seconds_total %.9f\n", s.lock_wait_ns / 1e9);
+    if (len >= size) {
+        len = size - 1;
+    }
+    return len;
+}
+
+// Uma resposta por conexão (HTTP/1.0): o pedido é lido e ignorado
+static void *http_thread(void *arg) {
+    int listen_socket = (int)(intptr_t)arg;
+    char *body = malloc(METRICS_BODY_SIZE);
+    char request[1024];
+    char header[160];
+
+    while (body != NULL) {
+        int fd = accept(listen_socket, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+        struct timeval timeout = {1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        recv(fd, request, sizeof(request), 0);
+
+        size_t body_len = format_prometheus(body, METRICS_BODY_SIZE);
+        int header_len = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\n"
+                                  "Content-Type: text/plain; version=0.0.4\r\n"
+                                  "Content-Length: %zu\r\n\r\n", body_len);
+        send(fd, header, header_len, MSG_NOSIGNAL);
+        send(fd, body, body_len, MSG_NOSIGNAL);
+        close(fd);
+    }
+    free(body);
+    return NULL;
+}
+
+void metrics_start_http(ElectionServer *server, int port) {
+    int listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_socket < 0) {
+        perror("Erro ao criar socket de métricas");
+        exit(1);
+    }
+    int opt = 1;
+    setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    // Só local: as métricas não passam pela autenticação do ADMIN
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(listen_socket, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_socket, 16) < 0) {
+        perror("Erro na porta de métricas");
+        exit(1);
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, http_thread, (void *)(intptr_t)listen_socket) != 0) {
+        perror("Erro ao criar thread de métricas");
+        exit(1);
+    }
+    pthread_detach(thread);
+    LOG_INFO(server, "Métricas (Prometheus) em http://127.0.0.1:%d/metrics", port);
+}
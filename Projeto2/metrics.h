@@ -0,0 +1,88 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "server.h"
+#include "roll.h"
+
+// Comandos contados nas métricas (texto e binário)
+typedef enum {
+    METRIC_HELLO,
+    METRIC_LIST,
+    METRIC_VOTE,
+    METRIC_SCORE,
+    METRIC_WATCH,       // WATCH e UNWATCH
+    METRIC_BYE,
+    METRIC_ADMIN,
+    METRIC_PEER,        // comandos entre nós do cluster
+    METRIC_UNKNOWN,
+    METRIC_COMMANDS
+} MetricCommand;
+
+// Resultados de VOTE, indexados por VoteResult
+#define METRIC_VOTE_RESULTS (VOTE_UNAVAILABLE + 1)
+
+// Contadores de uma thread. Só a dona escreve (load + store relaxados, sem
+// instrução atômica de leitura-modificação-escrita); quem lê soma os blocos
+// de todas as threads, como nos histogramas de latência.
+typedef struct {
+    _Atomic uint64_t connections_opened;
+    _Atomic uint64_t connections_closed;
+    _Atomic uint64_t connections_busy;      // recusadas com ERR BUSY
+    _Atomic uint64_t evictions[TIMEOUT_REASONS];    // fechadas por prazo vencido
+    _Atomic uint64_t commands[METRIC_COMMANDS];
+    _Atomic uint64_t votes[METRIC_VOTE_RESULTS];
+    _Atomic uint64_t roll_rejects[ROLL_RESULTS];    // HELLO fora do cadastro, por onde foi recusado
+    _Atomic uint64_t bytes_in;
+    _Atomic uint64_t bytes_out;
+    _Atomic uint64_t io_syscalls;           // syscalls de E/S dos clientes (recv, send, epoll, io_uring...)
+    _Atomic uint64_t lock_waits;            // locks dos votantes já ocupados
+    _Atomic uint64_t lock_wait_ns;          // tempo esperando esses locks
+} Metrics;
+
+// Soma dos blocos (cópia sem atômicos, para relatórios)
+typedef struct {
+    uint64_t connections_opened;
+    uint64_t connections_closed;
+    uint64_t connections_busy;
+    uint64_t evictions[TIMEOUT_REASONS];
+    uint64_t commands[METRIC_COMMANDS];
+    uint64_t votes[METRIC_VOTE_RESULTS];
+    uint64_t roll_rejects[ROLL_RESULTS];
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t io_syscalls;
+    uint64_t lock_waits;
+    uint64_t lock_wait_ns;
+} MetricsSnapshot;
+
+// Bloco da thread atual (criado na primeira chamada da thread). NULL só
+// sem memória; os contadores são então descartados.
+Metrics *metrics_thread(void);
+
+static inline void metric_add(_Atomic uint64_t *counter, uint64_t value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value,
+                          memory_order_relaxed);
+}
+
+#define METRIC_ADD(field, value) \
+    do { \
+        Metrics *metrics_ = metrics_thread(); \
+        if (metrics_ != NULL) { \
+            metric_add(&metrics_->field, (value)); \
+        } \
+    } while (0)
+
+void metrics_collect(MetricsSnapshot *snapshot);
+
+// Uma linha "STATS chave=valor ..." terminada em \n (resposta do ADMIN
+// STATS). Retorna o tamanho.
+size_t metrics_format_line(char *out, size_t size);
+
+// Serve as métricas em texto do Prometheus em 127.0.0.1:port, numa thread
+// própria. Erros encerram o processo.
+void metrics_start_http(ElectionServer *server, int port);
+
+#endif
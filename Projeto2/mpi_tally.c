@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
+#include <mpi.h>
+#include "mpi_tally.h"
+#include "election.h"
+#include "cluster.h"
+
+#define MPI_NODE_LEN 64
+
+// Intervalo entre testes de uma redução em andamento
+#define MPI_POLL_US 50
+
+// Estado da thread de redução (um por processo)
+typedef struct {
+    ElectionServer *server;
+    int rank;
+    int size;
+    uint64_t interval_ns;
+    pthread_t thread;
+    bool started;
+    atomic_bool stop_requested;     // este rank quer encerrar
+
+    // Buffer da redução: por eleição, os votos de cada opção, os votantes
+    // e 1 se encerrada; no fim, 1 se este rank quer encerrar
+    size_t len;
+    uint64_t *local;
+    uint64_t *global;
+    size_t *offsets;                // início de cada eleição no buffer
+    int *closed_rounds;             // rank 0: reduções seguidas com todos encerrados
+} MpiTally;
+
+static MpiTally mpi;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void mpi_init(int *argc, char ***argv) {
+    int provided;
+    MPI_Init_thread(argc, argv, MPI_THREAD_SERIALIZED, &provided);
+    if (provided < MPI_THREAD_SERIALIZED) {
+        fprintf(stderr, "A biblioteca MPI não oferece MPI_THREAD_SERIALIZED\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Comm_rank(MPI_COMM_WORLD, &mpi.rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &mpi.size);
+}
+
+// Endereço IPv4 pelo qual os outros ranks alcançam este (o do hostname;
+// 127.0.0.1 se ele não resolver)
+static void local_address(char *out, size_t size) {
+    char host[256];
+    struct addrinfo hints = {0}, *result = NULL;
+    hints.ai_family = AF_INET;
+    snprintf(out, size, "127.0.0.1");
+    if (gethostname(host, sizeof(host)) == 0 && getaddrinfo(host, NULL, &hints, &result) == 0) {
+        struct sockaddr_in *addr = (struct sockaddr_in *)result->ai_addr;
+        inet_ntop(AF_INET, &addr->sin_addr, out, size);
+        freeaddrinfo(result);
+    }
+}
+
+void mpi_configure(ServerConfig *config) {
+    if (config->cluster_nodes != NULL) {
+        fprintf(stderr, "server_mpi monta o cluster pelos ranks: não use --cluster\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (config->event_loop) {
+        fprintf(stderr, "server_mpi usa o modo thread: não combina com --event-loop, --shards ou --io-uring\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (mpi.size > CLUSTER_MAX_NODES) {
+        fprintf(stderr, "server_mpi aceita até %d ranks\n", CLUSTER_MAX_NODES);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    int base_port = config->port;
+    config->port = base_port + mpi.rank;
+    config->node_id = mpi.rank;
+    if (config->metrics_port > 0) {
+        config->metrics_port += mpi.rank;
+    }
+
+    // Cada rank anuncia a sua porta de peers; todos montam a mesma lista
+    char self[MPI_NODE_LEN];
+    char address[INET_ADDRSTRLEN];
+    local_address(address, sizeof(address));
+    snprintf(self, sizeof(self), "%s:%d", address, base_port + mpi.size + mpi.rank);
+
+    char *all = malloc((size_t)mpi.size * MPI_NODE_LEN);
+    char *nodes = malloc((size_t)mpi.size * MPI_NODE_LEN);
+    char *log_dir = malloc(32);
+    if (all == NULL || nodes == NULL || log_dir == NULL) {
+        perror("Erro ao alocar configuração MPI");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Allgather(self, MPI_NODE_LEN, MPI_CHAR, all, MPI_NODE_LEN, MPI_CHAR, MPI_COMM_WORLD);
+    nodes[0] = '\0';
+    for (int i = 0; i < mpi.size; i++) {
+        if (i > 0) {
+            strcat(nodes, ",");
+        }
+        strcat(nodes, all + i * MPI_NODE_LEN);
+    }
+    free(all);
+    config->cluster_nodes = nodes;
+
+    snprintf(log_dir, 32, "logs/rank%d", mpi.rank);
+    config->log_dir = log_dir;
+}
+
+// Copia os totais locais para o buffer da redução
+static void pack_local(void) {
+    ElectionServer *server = mpi.server;
+    for (int i = 0; i < server->num_elections; i++) {
+        Election *election = server->elections[i];
+        uint64_t *slot = mpi.local + mpi.offsets[i];
+        int k = election->num_options;
+        // closed antes dos votos: só é marcado depois do último voto
+        // (close_election), então a partição não muda mais
+        slot[k + 1] = atomic_load(&election->closed) ? 1 : 0;
+        tally_snapshot(&election->tally, slot, NULL);
+        slot[k] = voter_table_count(&election->voters);
+    }
+    mpi.local[mpi.len - 1] = atomic_load(&mpi.stop_requested) ? 1 : 0;
+}
+
+// Publica os totais somados. Uma eleição encerrada em algum rank é
+// encerrada aqui; o rank 0 grava o resultado somado quando todos a
+// encerraram, com os totais da redução seguinte (já sem votos em trânsito).
+static void apply_global(void) {
+    ElectionServer *server = mpi.server;
+    for (int i = 0; i < server->num_elections; i++) {
+        Election *election = server->elections[i];
+        const uint64_t *slot = mpi.global + mpi.offsets[i];
+        int k = election->num_options;
+        uint64_t closed = slot[k + 1];
+
+        if (closed > 0 && !atomic_load(&election->closed)) {
+            LOG_INFO(election, "Eleição %s encerrada em outro rank", election->name);
+            close_election(election);
+        }
+        cluster_set_totals(server->cluster, election, slot, closed > 0);
+
+        if (mpi.rank != 0 || mpi.closed_rounds[i] == 2) {
+            continue;
+        }
+        mpi.closed_rounds[i] = closed == (uint64_t)mpi.size ? mpi.closed_rounds[i] + 1 : 0;
+        if (mpi.closed_rounds[i] == 2) {
+            char note[64];
+            snprintf(note, sizeof(note), "Soma dos %d ranks MPI", mpi.size);
+            save_results(election, slot, slot[k], note);
+            LOG_INFO(election, "Resultado somado dos %d ranks gravado", mpi.size);
+        }
+    }
+}
+
+static void *reduce_thread(void *arg) {
+    (void)arg;
+    Cluster *cluster = mpi.server->cluster;
+    struct timespec interval = {
+        .tv_sec = mpi.interval_ns / 1000000000ULL,
+        .tv_nsec = mpi.interval_ns % 1000000000ULL
+    };
+    struct timespec poll = {0, MPI_POLL_US * 1000};
+
+    while (1) {
+        nanosleep(&interval, NULL);
+        pack_local();
+
+        // Não bloqueante: a thread só testa a redução, sem prender nenhum
+        // lock enquanto os outros ranks chegam
+        uint64_t start = now_ns();
+        MPI_Request request;
+        MPI_Iallreduce(mpi.local, mpi.global, (int)mpi.len, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD,
+                       &request);
+        int done = 0;
+        MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+        while (!done) {
+            nanosleep(&poll, NULL);
+            MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+        }
+        aggregate_record(&cluster->mpi_stats, now_ns() - start);
+
+        apply_global();
+
+        // Algum rank está encerrando: todos param na mesma redução
+        if (mpi.global[mpi.len - 1] > 0) {
+            break;
+        }
+    }
+
+    if (!atomic_load(&mpi.stop_requested)) {
+        LOG_INFO(mpi.server, "Outro rank está encerrando, encerrando este também");
+        kill(getpid(), SIGTERM);
+    }
+    return NULL;
+}
+
+// Aborta todos os ranks se algum dos valores não for igual em todos eles
+// (mínimo e máximo da redução diferentes)
+static void require_same(const uint64_t *values, int count, const char *error) {
+    uint64_t *min = malloc(2 * count * sizeof(uint64_t));
+    if (min == NULL) {
+        perror("Erro ao alocar redução MPI");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    uint64_t *max = min + count;
+    MPI_Allreduce(values, min, count, MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
+    MPI_Allreduce(values, max, count, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+    for (int i = 0; i < count; i++) {
+        if (min[i] != max[i]) {
+            fprintf(stderr, "%s\n", error);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    free(min);
+}
+
+void mpi_tally_start(ElectionServer *server, unsigned long interval_ms) {
+    mpi.server = server;
+    mpi.interval_ns = interval_ms * 1000000ULL;
+    atomic_init(&mpi.stop_requested, false);
+
+    mpi.offsets = calloc(server->num_elections, sizeof(size_t));
+    mpi.closed_rounds = calloc(server->num_elections, sizeof(int));
+    if (mpi.offsets == NULL || mpi.closed_rounds == NULL) {
+        perror("Erro ao alocar redução MPI");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int i = 0; i < server->num_elections; i++) {
+        mpi.offsets[i] = mpi.len;
+        mpi.len += server->elections[i]->num_options + 2;
+    }
+    mpi.len++;
+
+    // Todos os ranks precisam das mesmas eleições, na mesma ordem e com as
+    // mesmas opções: primeiro o formato do buffer (a redução dos hashes
+    // precisa do mesmo número de eleições), depois o hash das opções de
+    // cada uma, que separa listas diferentes de mesmo tamanho
+    const char *mismatch = "Ranks com eleições diferentes (use as mesmas opções em todos)";
+    uint64_t shape[2] = {(uint64_t)server->num_elections, mpi.len};
+    require_same(shape, 2, mismatch);
+    uint64_t *hashes = malloc(server->num_elections * sizeof(uint64_t));
+    if (hashes == NULL) {
+        perror("Erro ao alocar redução MPI");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int i = 0; i < server->num_elections; i++) {
+        hashes[i] = server->elections[i]->options_hash;
+    }
+    require_same(hashes, server->num_elections, mismatch);
+    free(hashes);
+
+    mpi.local = calloc(mpi.len, sizeof(uint64_t));
+    mpi.global = calloc(mpi.len, sizeof(uint64_t));
+    if (mpi.local == NULL || mpi.global == NULL) {
+        perror("Erro ao alocar redução MPI");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    server->cluster->external_totals = true;
+    if (pthread_create(&mpi.thread, NULL, reduce_thread, NULL) != 0) {
+        perror("Erro ao criar thread de redução MPI");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    mpi.started = true;
+    LOG_INFO(server, "Rank MPI %d de %d: redução dos totais a cada %lu ms", mpi.rank, mpi.size,
+             interval_ms);
+}
+
+void mpi_tally_shutdown(void) {
+    if (!mpi.started) {
+        return;
+    }
+    atomic_store(&mpi.stop_requested, true);
+    pthread_join(mpi.thread, NULL);
+    mpi.started = false;
+    MPI_Finalize();
+}
@@ -0,0 +1,30 @@
+#ifndef MPI_TALLY_H
+#define MPI_TALLY_H
+
+#include "server.h"
+
+// server_mpi: um servidor por rank, lançados com mpirun. Cada rank é um nó
+// do cluster (porta de clientes base + rank, porta de peers base + ranks +
+// rank, logs em logs/rank<N>/) e os votos de outra partição continuam
+// encaminhados por TCP. Os totais, em vez de pedidos com FTALLY a cada
+// SCORE, são somados entre todos os ranks por um MPI_Iallreduce periódico
+// (--mpi-interval); o encerramento de uma eleição viaja na mesma redução e o
+// rank 0 grava o resultado somado.
+#define DEFAULT_MPI_INTERVAL_MS 100
+
+// Antes de ler as opções: MPI_Init_thread (as chamadas MPI são feitas por
+// uma thread por vez)
+void mpi_init(int *argc, char ***argv);
+
+// Depois de ler as opções: deriva porta, diretório de logs e lista do
+// cluster do rank. Erros encerram o processo.
+void mpi_configure(ServerConfig *config);
+
+// Depois de init_server: inicia a thread de redução
+void mpi_tally_start(ElectionServer *server, unsigned long interval_ms);
+
+// No encerramento (SIGINT/SIGTERM): pede o fim das reduções a todos os
+// ranks, espera a thread e chama MPI_Finalize
+void mpi_tally_shutdown(void);
+
+#endif
@@ -4,8 +4,9 @@
 #define MAX_BUFFER 4096
 #define MAX_VOTER_ID 64
 #define MAX_OPTION_NAME 128
+#define MAX_ELECTION_NAME 32
+// Opções guardadas pelos clientes (o servidor não tem limite)
 #define MAX_OPTIONS 10
-#define MAX_CLIENTS 100
 
 // Protocolo de mensagens
 #define CMD_HELLO "HELLO"
@@ -14,6 +15,10 @@
 #define CMD_SCORE "SCORE"
 #define CMD_BYE "BYE"
 #define CMD_ADMIN_CLOSE "ADMIN CLOSE"
+#define CMD_ADMIN_STATS "ADMIN STATS"
+#define CMD_ADMIN_EXPORT "ADMIN EXPORT"
+#define CMD_WATCH "WATCH"
+#define CMD_UNWATCH "UNWATCH"
 
 #define RESP_WELCOME "WELCOME"
 #define RESP_OPTIONS "OPTIONS"
@@ -24,5 +29,54 @@
 #define RESP_CLOSED "CLOSED FINAL"
 #define RESP_ERR_CLOSED "ERR CLOSED"
 #define RESP_BYE "BYE"
+#define RESP_WATCHING "OK WATCHING"
+#define RESP_UNWATCHED "OK UNWATCHED"
+#define RESP_ERR_UNKNOWN_ELECTION "ERR UNKNOWN_ELECTION"
+#define RESP_ERR_BUSY "ERR BUSY"
+#define RESP_ERR_UNAVAILABLE "ERR UNAVAILABLE"
+#define RESP_STATS "STATS"
+#define RESP_OK_EXPORTING "OK EXPORTING"
+#define RESP_ERR_TIMEOUT "ERR TIMEOUT"
+#define RESP_ERR_NOT_ELIGIBLE "ERR NOT_ELIGIBLE"
+
+// Protocolo binário (opcional). A conexão é binária quando o primeiro byte
+// recebido é >= 0x80 (normalmente BIN_HELLO): os tipos de quadro nunca
+// colidem com os comandos de texto ASCII na mesma porta.
+// Quadro: [tipo u8][flags u8][tamanho do payload u16 big-endian][payload]
+#define BIN_VERSION 1
+#define BIN_HEADER_SIZE 4
+
+// Cliente -> servidor
+#define BIN_HELLO 0x80          // versão u8, VOTER_ID numérico u64, [nome da eleição]
+#define BIN_LIST 0x81
+#define BIN_VOTE 0x82           // índice da opção (varint, base 0)
+#define BIN_SCORE 0x83
+#define BIN_BYE 0x84
+#define BIN_WATCH 0x85          // u8: 1 assina o placar, 0 cancela
+
+// Servidor -> cliente
+#define BIN_WELCOME 0x90        // VOTER_ID u64
+#define BIN_OPTIONS 0x91        // k (varint), k x [tamanho (varint), nome]
+#define BIN_VOTED 0x92          // índice da opção (varint)
+#define BIN_SCORE_RESP 0x93     // k (varint), k x votos u32; flag BIN_FLAG_FINAL
+#define BIN_BYE_RESP 0x94
+#define BIN_WATCH_RESP 0x95     // u8: estado da assinatura
+#define BIN_ERROR 0x9F          // código u8
+
+#define BIN_FLAG_FINAL 0x01
+#define BIN_FLAG_PUSH 0x02      // SCORE_RESP enviado pela assinatura, sem pedido
+
+// Códigos de BIN_ERROR
+#define BIN_ERR_DUPLICATE 1
+#define BIN_ERR_INVALID_OPTION 2
+#define BIN_ERR_CLOSED 3
+#define BIN_ERR_NOT_AUTHENTICATED 4
+#define BIN_ERR_UNKNOWN_COMMAND 5
+#define BIN_ERR_BAD_FRAME 6
+#define BIN_ERR_UNKNOWN_ELECTION 7
+#define BIN_ERR_BUSY 8          // servidor sobrecarregado; a conexão é fechada
+#define BIN_ERR_UNAVAILABLE 9   // nó dono do votante fora do ar (modo cluster)
+#define BIN_ERR_TIMEOUT 10      // prazo da conexão vencido; a conexão é fechada
+#define BIN_ERR_NOT_ELIGIBLE 11 // VOTER_ID fora do cadastro de eleitores
 
 #endif
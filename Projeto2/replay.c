@@ -0,0 +1,1050 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "protocol.h"
+#include "histogram.h"
+
+// Replay do tráfego gravado no log do servidor: reconstrói as sessões dos
+// votantes a partir das linhas "Recebido de <votante>: <comando>" e as
+// reproduz contra um servidor, no ritmo original (ou N vezes mais rápido,
+// ou o mais rápido possível), medindo a latência de cada comando. As
+// respostas podem ser gravadas e comparadas com as de outro replay.
+
+#define IN_BUFFER (16 * 1024)
+#define DRAIN_TIMEOUT_NS (5 * 1000000000ULL)
+#define MAX_DIFFERENCES_SHOWN 10
+
+typedef enum {
+    REPLAY_HELLO,
+    REPLAY_LIST,
+    REPLAY_VOTE,
+    REPLAY_SCORE,
+    REPLAY_WATCH,       // WATCH e UNWATCH
+    REPLAY_BYE,
+    REPLAY_ADMIN,
+    REPLAY_OTHER,
+    REPLAY_COMMANDS
+} ReplayCommand;
+
+static const char *command_names[REPLAY_COMMANDS] = {
+    "HELLO", "LIST", "VOTE", "SCORE", "WATCH", "BYE", "ADMIN", "OUTRO"
+};
+
+typedef struct {
+    char *text;             // comando como está no log, sem \n
+    uint64_t at_ns;         // instante no log, desde o primeiro comando
+    uint64_t sent_ns;
+    uint8_t kind;
+    char *response;         // classe da resposta (com --save/--compare; NULL: sem resposta)
+} ReplayCmd;
+
+// Uma conexão do log: do HELLO de um cliente não autenticado até o BYE ou o
+// último comando (os HELLO seguintes na mesma conexão continuam a sessão)
+typedef struct {
+    int id;
+    char voter_id[MAX_VOTER_ID];    // votante do primeiro HELLO
+    ReplayCmd *cmds;
+    int count;
+    int cap;
+
+    int fd;
+    bool open;
+    bool done;
+    bool watching;          // placares sem pedido podem chegar
+    bool snapshot;          // o placar que segue o OK WATCHING ainda vem
+    bool want_write;
+    int sent;
+    int answered;
+    char *in;
+    size_t in_len;
+    char *out;
+    size_t out_len;
+    size_t out_sent;
+    size_t out_cap;
+} ReplaySession;
+
+typedef struct {
+    const char *log_path;
+    const char *host;
+    int port;
+    double speed;           // 0: o mais rápido possível
+    int connections;        // sessões simultâneas no modo máximo
+    int threads;
+    bool admin;
+    const char *save_path;
+    const char *compare_path;
+
+    ReplaySession *sessions;
+    int num_sessions;
+    uint64_t num_commands;
+    uint64_t ignored;       // comandos sem sessão (antes do HELLO)
+    uint64_t skipped_admin;
+    uint64_t log_span_ns;
+} ReplayConfig;
+
+typedef struct {
+    int id;
+    int epoll_fd;
+    ReplayConfig *config;
+    ReplaySession **sessions;   // desta thread, na ordem do log
+    int num_sessions;
+    int next_start;             // modo máximo: próxima sessão a abrir
+    int active;
+    int finished;
+
+    // Modo cronometrado: sessões pelo instante do próximo comando
+    ReplaySession **heap;
+    int heap_len;
+
+    Histogram hist[REPLAY_COMMANDS];
+    uint64_t errors[REPLAY_COMMANDS];   // respostas ERR
+    Histogram lag;                      // atraso dos envios em relação ao horário
+    uint64_t lost;                      // comandos sem resposta
+    uint64_t failed_sessions;
+
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint64_t last_progress;
+    pthread_t thread;
+} ReplayThread;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static bool starts_with(const char *text, const char *prefix) {
+    return strncmp(text, prefix, strlen(prefix)) == 0;
+}
+
+static ReplayCommand classify_command(const char *command) {
+    if (starts_with(command, CMD_HELLO " ")) {
+        return REPLAY_HELLO;
+    }
+    if (starts_with(command, "ADMIN")) {
+        return REPLAY_ADMIN;
+    }
+    if (strcmp(command, CMD_WATCH) == 0 || strcmp(command, CMD_UNWATCH) == 0) {
+        return REPLAY_WATCH;
+    }
+    static const char *words[] = {CMD_LIST, CMD_VOTE, CMD_SCORE, CMD_BYE};
+    static const ReplayCommand kinds[] = {REPLAY_LIST, REPLAY_VOTE, REPLAY_SCORE, REPLAY_BYE};
+    for (int i = 0; i < 4; i++) {
+        size_t len = strlen(words[i]);
+        if (strncmp(command, words[i], len) == 0 && (command[len] == '\0' || command[len] == ' ')) {
+            return kinds[i];
+        }
+    }
+    return REPLAY_OTHER;
+}
+
+// Classe comparável de uma resposta: placares, opções e estatísticas mudam
+// com o momento, então só o tipo conta; o resto é a linha inteira
+static void response_class(const char *line, char *out, size_t size) {
+    static const char *summarized[] = {RESP_SCORE " ", RESP_OPTIONS " ", RESP_CLOSED " ", RESP_STATS " "};
+    for (size_t i = 0; i < sizeof(summarized) / sizeof(summarized[0]); i++) {
+        if (starts_with(line, summarized[i])) {
+            snprintf(out, size, "%.*s", (int)strlen(summarized[i]) - 1, summarized[i]);
+            return;
+        }
+    }
+    snprintf(out, size, "%s", line);
+}
+
+// ---- Leitura do log ----
+
+// Votantes com sessão aberta no log -> índice da sessão (-1: nenhuma). As
+// chaves ficam na tabela depois de liberadas, para o votante voltar.
+typedef struct {
+    char **keys;
+    int *values;
+    size_t cap;
+    size_t used;
+} OpenTable;
+
+static uint64_t hash_id(const char *id) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (; *id != '\0'; id++) {
+        hash = (hash ^ (uint8_t)*id) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static size_t table_slot(const OpenTable *table, const char *key) {
+    size_t i = hash_id(key) & (table->cap - 1);
+    while (table->keys[i] != NULL && strcmp(table->keys[i], key) != 0) {
+        i = (i + 1) & (table->cap - 1);
+    }
+    return i;
+}
+
+static void table_grow(OpenTable *table) {
+    OpenTable bigger = {NULL, NULL, table->cap ? table->cap * 2 : 1024, table->used};
+    bigger.keys = calloc(bigger.cap, sizeof(char *));
+    bigger.values = malloc(bigger.cap * sizeof(int));
+    if (bigger.keys == NULL || bigger.values == NULL) {
+        perror("Erro ao alocar sessões");
+        exit(1);
+    }
+    for (size_t i = 0; i < table->cap; i++) {
+        if (table->keys[i] != NULL) {
+            size_t slot = table_slot(&bigger, table->keys[i]);
+            bigger.keys[slot] = table->keys[i];
+            bigger.values[slot] = table->values[i];
+        }
+    }
+    free(table->keys);
+    free(table->values);
+    *table = bigger;
+}
+
+static int table_get(const OpenTable *table, const char *key) {
+    if (table->cap == 0) {
+        return -1;
+    }
+    size_t slot = table_slot(table, key);
+    return table->keys[slot] != NULL ? table->values[slot] : -1;
+}
+
+static void table_set(OpenTable *table, const char *key, int value) {
+    if ((table->used + 1) * 2 > table->cap) {
+        table_grow(table);
+    }
+    size_t slot = table_slot(table, key);
+    if (table->keys[slot] == NULL) {
+        if ((table->keys[slot] = strdup(key)) == NULL) {
+            perror("Erro ao alocar sessões");
+            exit(1);
+        }
+        table->used++;
+    }
+    table->values[slot] = value;
+}
+
+static void table_free(OpenTable *table) {
+    for (size_t i = 0; i < table->cap; i++) {
+        free(table->keys[i]);
+    }
+    free(table->keys);
+    free(table->values);
+}
+
+// Comando do log na ordem global: o instante dele é ajustado depois
+typedef struct {
+    int session;
+    int cmd;
+    time_t second;
+} LogEvent;
+
+static int new_session(ReplayConfig *config, const char *voter_id) {
+    static int capacity = 0;
+    if (config->num_sessions == capacity) {
+        capacity = capacity ? capacity * 2 : 1024;
+        config->sessions = realloc(config->sessions, capacity * sizeof(ReplaySession));
+        if (config->sessions == NULL) {
+            perror("Erro ao alocar sessões");
+            exit(1);
+        }
+    }
+    ReplaySession *session = &config->sessions[config->num_sessions];
+    memset(session, 0, sizeof(*session));
+    session->id = config->num_sessions;
+    session->fd = -1;
+    snprintf(session->voter_id, sizeof(session->voter_id), "%s", voter_id);
+    return config->num_sessions++;
+}
+
+static int add_command(ReplaySession *session, const char *text) {
+    if (session->count == session->cap) {
+        session->cap = session->cap ? session->cap * 2 : 8;
+        session->cmds = realloc(session->cmds, session->cap * sizeof(ReplayCmd));
+        if (session->cmds == NULL) {
+            perror("Erro ao alocar comandos");
+            exit(1);
+        }
+    }
+    ReplayCmd *cmd = &session->cmds[session->count];
+    memset(cmd, 0, sizeof(*cmd));
+    cmd->kind = classify_command(text);
+    if ((cmd->text = strdup(text)) == NULL) {
+        perror("Erro ao alocar comandos");
+        exit(1);
+    }
+    return session->count++;
+}
+
+// "[AAAA-MM-DD hh:mm:ss] " do logger. Retorna o texto depois dele ou NULL.
+static char *parse_timestamp(char *line, time_t *second) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    int consumed = 0;
+    if (sscanf(line, "[%d-%d-%d %d:%d:%d] %n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &consumed) != 6 || consumed == 0) {
+        return NULL;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    *second = mktime(&tm);
+    return line + consumed;
+}
+
+// O log tem resolução de segundos: os comandos de um mesmo segundo são
+// espalhados igualmente por ele, na ordem do log
+static void spread_timestamps(ReplayConfig *config, LogEvent *events, size_t num_events) {
+    if (num_events == 0) {
+        return;
+    }
+    time_t base = events[0].second;
+    size_t i = 0;
+    while (i < num_events) {
+        size_t j = i;
+        while (j < num_events && events[j].second == events[i].second) {
+            j++;
+        }
+        uint64_t second_ns = events[i].second > base ? (uint64_t)(events[i].second - base) * 1000000000ULL : 0;
+        for (size_t k = i; k < j; k++) {
+            ReplayCmd *cmd = &config->sessions[events[k].session].cmds[events[k].cmd];
+            cmd->at_ns = second_ns + (2 * (k - i) + 1) * 1000000000ULL / (2 * (j - i));
+            if (cmd->at_ns > config->log_span_ns) {
+                config->log_span_ns = cmd->at_ns;
+            }
+        }
+        i = j;
+    }
+}
+
+static void parse_log(ReplayConfig *config) {
+    FILE *file = fopen(config->log_path, "r");
+    if (file == NULL) {
+        perror("Erro ao abrir o log");
+        exit(1);
+    }
+    OpenTable open = {NULL, NULL, 0, 0};
+    LogEvent *events = NULL;
+    size_t num_events = 0;
+    size_t events_cap = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t len;
+
+    while ((len = getline(&line, &line_cap, file)) > 0) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        time_t second;
+        char *text = parse_timestamp(line, &second);
+        if (text == NULL) {
+            continue;
+        }
+        // Servidor reiniciado: as conexões anteriores caíram
+        if (strcmp(text, "=== Servidor iniciado ===") == 0) {
+            for (size_t i = 0; i < open.cap; i++) {
+                open.values[i] = -1;
+            }
+            continue;
+        }
+        if (!starts_with(text, "Recebido de ")) {
+            continue;
+        }
+        char *who = text + strlen("Recebido de ");
+        char *command = strstr(who, ": ");
+        if (command == NULL) {
+            continue;
+        }
+        *command = '\0';
+        command += 2;
+        // HELLO binário sem eleição termina em espaço
+        size_t command_len = strlen(command);
+        while (command_len > 0 && command[command_len - 1] == ' ') {
+            command[--command_len] = '\0';
+        }
+
+        bool anonymous = strcmp(who, "não autenticado") == 0;
+        int session = anonymous ? -1 : table_get(&open, who);
+        ReplayCommand kind = classify_command(command);
+        if (kind == REPLAY_HELLO) {
+            char voter_id[MAX_VOTER_ID];
+            if (sscanf(command + strlen(CMD_HELLO " "), "%63s", voter_id) != 1) {
+                continue;
+            }
+            if (session < 0) {
+                session = new_session(config, voter_id);
+            } else {
+                table_set(&open, who, -1);
+            }
+            table_set(&open, voter_id, session);
+        } else if (session < 0) {
+            config->ignored++;
+            continue;
+        }
+        if (kind == REPLAY_ADMIN && !config->admin) {
+            config->skipped_admin++;
+            continue;
+        }
+
+        if (num_events == events_cap) {
+            events_cap = events_cap ? events_cap * 2 : 4096;
+            events = realloc(events, events_cap * sizeof(LogEvent));
+            if (events == NULL) {
+                perror("Erro ao alocar comandos");
+                exit(1);
+            }
+        }
+        events[num_events].session = session;
+        events[num_events].cmd = add_command(&config->sessions[session], command);
+        events[num_events].second = second;
+        num_events++;
+        config->num_commands++;
+
+        if (kind == REPLAY_BYE) {
+            table_set(&open, who, -1);
+        }
+    }
+    free(line);
+    fclose(file);
+    table_free(&open);
+
+    spread_timestamps(config, events, num_events);
+    free(events);
+    if (config->num_sessions == 0) {
+        fprintf(stderr, "Nenhuma sessão no log %s (precisa do nível de log info)\n", config->log_path);
+        exit(1);
+    }
+}
+
+// ---- Conexões ----
+
+static int connect_server(const ReplayConfig *config) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config->port);
+    if (inet_pton(AF_INET, config->host, &addr.sin_addr) <= 0) {
+        if (strcmp(config->host, "localhost") != 0) {
+            fprintf(stderr, "Endereço inválido: %s\n", config->host);
+            exit(1);
+        }
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+// Encerra a sessão; os comandos ainda sem resposta ficam como perdidos
+static void finish_session(ReplayThread *thread, ReplaySession *session) {
+    thread->lost += session->count - session->answered;
+    if (session->open) {
+        epoll_ctl(thread->epoll_fd, EPOLL_CTL_DEL, session->fd, NULL);
+        close(session->fd);
+        thread->active--;
+    }
+    free(session->in);
+    free(session->out);
+    session->in = session->out = NULL;
+    session->open = false;
+    session->done = true;
+    thread->finished++;
+}
+
+static bool open_session(ReplayThread *thread, ReplaySession *session) {
+    session->fd = connect_server(thread->config);
+    session->in = malloc(IN_BUFFER);
+    if (session->fd < 0 || session->in == NULL) {
+        if (session->fd >= 0) {
+            close(session->fd);
+        }
+        thread->failed_sessions++;
+        finish_session(thread, session);
+        return false;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = session;
+    epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, session->fd, &ev);
+    session->open = true;
+    thread->active++;
+    return true;
+}
+
+static void flush(ReplayThread *thread, ReplaySession *session) {
+    while (session->out_sent < session->out_len) {
+        ssize_t n = send(session->fd, session->out + session->out_sent,
+                         session->out_len - session->out_sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n <= 0) {
+            finish_session(thread, session);
+            return;
+        }
+        session->out_sent += n;
+    }
+    if (session->out_sent == session->out_len) {
+        session->out_len = session->out_sent = 0;
+    }
+
+    bool want_write = session->out_len > 0;
+    if (want_write != session->want_write) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | (want_write ? EPOLLOUT : 0);
+        ev.data.ptr = session;
+        epoll_ctl(thread->epoll_fd, EPOLL_CTL_MOD, session->fd, &ev);
+        session->want_write = want_write;
+    }
+}
+
+static uint64_t due_ns(const ReplayThread *thread, const ReplaySession *session) {
+    return thread->start_ns + (uint64_t)(session->cmds[session->sent].at_ns / thread->config->speed);
+}
+
+// Envia os comandos da sessão que já estão no horário. No modo máximo cada
+// sessão manda o próximo comando assim que recebe a resposta do anterior.
+static void pump(ReplayThread *thread, ReplaySession *session, uint64_t now) {
+    bool max_speed = thread->config->speed == 0;
+    while (session->sent < session->count) {
+        if (max_speed ? session->answered < session->sent : due_ns(thread, session) > now) {
+            break;
+        }
+        if (!max_speed) {
+            histogram_record(&thread->lag, now - due_ns(thread, session));
+        }
+        ReplayCmd *cmd = &session->cmds[session->sent];
+        size_t len = strlen(cmd->text);
+        if (session->out_len + len + 1 > session->out_cap) {
+            size_t cap = session->out_cap ? session->out_cap : 1024;
+            while (cap < session->out_len + len + 1) {
+                cap *= 2;
+            }
+            char *out = realloc(session->out, cap);
+            if (out == NULL) {
+                finish_session(thread, session);
+                return;
+            }
+            session->out = out;
+            session->out_cap = cap;
+        }
+        memcpy(session->out + session->out_len, cmd->text, len);
+        session->out[session->out_len + len] = '\n';
+        session->out_len += len + 1;
+        cmd->sent_ns = now;
+        session->sent++;
+    }
+    thread->last_progress = now;
+    flush(thread, session);
+}
+
+// ---- Respostas ----
+
+static void handle_line(ReplayThread *thread, ReplaySession *session, const char *line, uint64_t now) {
+    bool scoreboard = starts_with(line, RESP_SCORE " ") || starts_with(line, RESP_CLOSED " ");
+    if (session->snapshot && scoreboard) {
+        session->snapshot = false;
+        return;     // placar inicial da assinatura
+    }
+    if (session->answered == session->sent) {
+        return;     // placar enviado pela assinatura, sem pedido
+    }
+    ReplayCmd *cmd = &session->cmds[session->answered];
+    // Com WATCH ativo, um placar só é resposta se há um SCORE pendente
+    if (session->watching && scoreboard && cmd->kind != REPLAY_SCORE) {
+        return;
+    }
+
+    if (starts_with(line, RESP_WATCHING)) {
+        session->watching = true;
+        session->snapshot = true;
+    } else if (starts_with(line, RESP_UNWATCHED)) {
+        session->watching = false;
+    }
+    histogram_record(&thread->hist[cmd->kind], now - cmd->sent_ns);
+    if (starts_with(line, "ERR")) {
+        thread->errors[cmd->kind]++;
+    }
+    if (thread->config->save_path != NULL || thread->config->compare_path != NULL) {
+        char class[MAX_BUFFER];
+        response_class(line, class, sizeof(class));
+        cmd->response = strdup(class);
+    }
+    session->answered++;
+    thread->last_progress = now;
+}
+
+static void handle_input(ReplayThread *thread, ReplaySession *session) {
+    while (1) {
+        ssize_t n = recv(session->fd, session->in + session->in_len, IN_BUFFER - session->in_len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n <= 0) {
+            finish_session(thread, session);
+            return;
+        }
+        session->in_len += n;
+
+        uint64_t now = now_ns();
+        size_t start = 0;
+        char *newline;
+        while ((newline = memchr(session->in + start, '\n', session->in_len - start)) != NULL) {
+            *newline = '\0';
+            handle_line(thread, session, session->in + start, now);
+            start = newline - session->in + 1;
+        }
+        if (start == 0 && session->in_len == IN_BUFFER) {
+            fprintf(stderr, "Resposta maior que %d bytes na sessão %d\n", IN_BUFFER, session->id);
+            finish_session(thread, session);
+            return;
+        }
+        memmove(session->in, session->in + start, session->in_len - start);
+        session->in_len -= start;
+    }
+
+    // Sessão completa: fecha (depois do BYE o servidor fecharia)
+    if (session->answered == session->count) {
+        finish_session(thread, session);
+    }
+}
+
+// ---- Agenda (modo cronometrado) ----
+
+static bool heap_before(const ReplaySession *a, const ReplaySession *b) {
+    return a->cmds[a->sent].at_ns < b->cmds[b->sent].at_ns;
+}
+
+static void heap_push(ReplayThread *thread, ReplaySession *session) {
+    int i = thread->heap_len++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!heap_before(session, thread->heap[parent])) {
+            break;
+        }
+        thread->heap[i] = thread->heap[parent];
+        i = parent;
+    }
+    thread->heap[i] = session;
+}
+
+static ReplaySession *heap_pop(ReplayThread *thread) {
+    ReplaySession *top = thread->heap[0];
+    ReplaySession *last = thread->heap[--thread->heap_len];
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= thread->heap_len) {
+            break;
+        }
+        if (child + 1 < thread->heap_len && heap_before(thread->heap[child + 1], thread->heap[child])) {
+            child++;
+        }
+        if (!heap_before(thread->heap[child], last)) {
+            break;
+        }
+        thread->heap[i] = thread->heap[child];
+        i = child;
+    }
+    if (thread->heap_len > 0) {
+        thread->heap[i] = last;
+    }
+    return top;
+}
+
+// Abre e alimenta as sessões: no horário do log ou, no modo máximo, até
+// --connections sessões ao mesmo tempo. Retorna o tempo de espera do
+// epoll_wait em ms.
+static int schedule(ReplayThread *thread, uint64_t now) {
+    const ReplayConfig *config = thread->config;
+    if (config->speed == 0) {
+        int limit = (config->connections + config->threads - 1) / config->threads;
+        while (thread->active < limit && thread->next_start < thread->num_sessions) {
+            ReplaySession *session = thread->sessions[thread->next_start++];
+            if (open_session(thread, session)) {
+                pump(thread, session, now);
+            }
+        }
+        return 100;
+    }
+
+    while (thread->heap_len > 0 && due_ns(thread, thread->heap[0]) <= now) {
+        ReplaySession *session = heap_pop(thread);
+        if (session->done || (!session->open && !open_session(thread, session))) {
+            continue;
+        }
+        pump(thread, session, now);
+        if (!session->done && session->sent < session->count) {
+            heap_push(thread, session);
+        }
+    }
+    if (thread->heap_len == 0) {
+        return 100;
+    }
+    uint64_t wait = due_ns(thread, thread->heap[0]) - now;
+    return wait > 100000000ULL ? 100 : (int)((wait + 999999) / 1000000);
+}
+
+static void *replay_thread(void *arg) {
+    ReplayThread *thread = (ReplayThread *)arg;
+    struct epoll_event events[256];
+    thread->last_progress = now_ns();
+    if (thread->config->speed > 0) {
+        for (int i = 0; i < thread->num_sessions; i++) {
+            heap_push(thread, thread->sessions[i]);
+        }
+    }
+
+    while (thread->finished < thread->num_sessions) {
+        uint64_t now = now_ns();
+        int timeout = schedule(thread, now);
+
+        // Respostas que não chegam: desiste das sessões abertas
+        bool waiting_only = thread->config->speed == 0 ? thread->next_start == thread->num_sessions
+                                                       : thread->heap_len == 0;
+        if (waiting_only && now - thread->last_progress > DRAIN_TIMEOUT_NS) {
+            for (int i = 0; i < thread->num_sessions; i++) {
+                if (!thread->sessions[i]->done) {
+                    finish_session(thread, thread->sessions[i]);
+                }
+            }
+            break;
+        }
+
+        int n = epoll_wait(thread->epoll_fd, events, 256, timeout);
+        for (int i = 0; i < n; i++) {
+            ReplaySession *session = events[i].data.ptr;
+            if (session->done) {
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                handle_input(thread, session);
+            }
+            if (session->done) {
+                continue;
+            }
+            if (thread->config->speed == 0) {
+                pump(thread, session, now_ns());
+            } else if (events[i].events & EPOLLOUT) {
+                flush(thread, session);
+            }
+        }
+    }
+
+    thread->end_ns = now_ns();
+    return NULL;
+}
+
+// ---- Relatório ----
+
+static void print_report(ReplayConfig *config, ReplayThread *threads, double elapsed) {
+    Histogram merged;
+    uint64_t total = 0;
+    uint64_t lost = 0;
+    uint64_t failed = 0;
+
+    printf("\n%-6s %10s %10s %10s %10s %10s %10s %8s\n",
+           "Cmd", "n", "req/s", "p50(us)", "p99(us)", "p99.9(us)", "máx(us)", "ERR");
+    for (int c = 0; c < REPLAY_COMMANDS; c++) {
+        uint64_t errors = 0;
+        histogram_reset(&merged);
+        for (int t = 0; t < config->threads; t++) {
+            histogram_merge(&merged, &threads[t].hist[c]);
+            errors += threads[t].errors[c];
+        }
+        uint64_t n = atomic_load(&merged.total);
+        if (n == 0) {
+            continue;
+        }
+        printf("%-6s %10llu %10.0f %10.1f %10.1f %10.1f %10.1f %8llu\n",
+               command_names[c], (unsigned long long)n, n / elapsed,
+               histogram_percentile(&merged, 50) / 1000.0,
+               histogram_percentile(&merged, 99) / 1000.0,
+               histogram_percentile(&merged, 99.9) / 1000.0,
+               atomic_load(&merged.max) / 1000.0,
+               (unsigned long long)errors);
+        total += n;
+    }
+    for (int t = 0; t < config->threads; t++) {
+        lost += threads[t].lost;
+        failed += threads[t].failed_sessions;
+    }
+    printf("\nTotal: %llu respostas em %.2f s (%.0f req/s)", (unsigned long long)total, elapsed,
+           total / elapsed);
+    if (config->speed > 0) {
+        printf(", %.1f s no log a %gx", config->log_span_ns / 1e9, config->speed);
+    }
+    printf("\n");
+
+    // Atraso dos envios: se cresce, o replay (ou o servidor) não acompanhou
+    // o ritmo pedido
+    if (config->speed > 0) {
+        histogram_reset(&merged);
+        for (int t = 0; t < config->threads; t++) {
+            histogram_merge(&merged, &threads[t].lag);
+        }
+        printf("Atraso dos envios: p50 %.1f us, p99 %.1f us, máx %.1f us\n",
+               histogram_percentile(&merged, 50) / 1000.0, histogram_percentile(&merged, 99) / 1000.0,
+               atomic_load(&merged.max) / 1000.0);
+    }
+    if (lost > 0 || failed > 0) {
+        printf("Comandos sem resposta: %llu; sessões sem conexão: %llu\n", (unsigned long long)lost,
+               (unsigned long long)failed);
+    }
+}
+
+// ---- Respostas gravadas ----
+
+static void save_responses(const ReplayConfig *config) {
+    FILE *file = fopen(config->save_path, "w");
+    if (file == NULL) {
+        perror("Erro ao gravar as respostas");
+        exit(1);
+    }
+    for (int s = 0; s < config->num_sessions; s++) {
+        const ReplaySession *session = &config->sessions[s];
+        for (int i = 0; i < session->count; i++) {
+            const char *response = session->cmds[i].response;
+            fprintf(file, "%d %d %s\n", s, i, response != NULL ? response : "-");
+        }
+    }
+    if (fclose(file) != 0) {
+        perror("Erro ao gravar as respostas");
+        exit(1);
+    }
+    printf("Respostas gravadas em %s\n", config->save_path);
+}
+
+// Compara com as respostas gravadas por --save (mesmo log e opções).
+// Retorna o número de diferenças.
+static uint64_t compare_responses(const ReplayConfig *config) {
+    FILE *file = fopen(config->compare_path, "r");
+    if (file == NULL) {
+        perror("Erro ao abrir as respostas de referência");
+        exit(1);
+    }
+    uint64_t compared = 0;
+    uint64_t differences = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t len;
+    while ((len = getline(&line, &line_cap, file)) > 0) {
+        if (line[len - 1] == '\n') {
+            line[--len] = '\0';
+        }
+        int s;
+        int i;
+        int consumed = 0;
+        if (sscanf(line, "%d %d %n", &s, &i, &consumed) != 2 || consumed == 0 ||
+            s < 0 || s >= config->num_sessions || i < 0 || i >= config->sessions[s].count) {
+            fprintf(stderr, "Respostas de referência de outro log ou com outras opções: %s\n", line);
+            exit(1);
+        }
+        const ReplaySession *session = &config->sessions[s];
+        const char *expected = line + consumed;
+        const char *got = session->cmds[i].response != NULL ? session->cmds[i].response : "-";
+        compared++;
+        if (strcmp(expected, got) == 0) {
+            continue;
+        }
+        if (differences++ < MAX_DIFFERENCES_SHOWN) {
+            printf("  sessão %d (%s), comando %d \"%s\": esperado \"%s\", recebido \"%s\"\n", s,
+                   session->voter_id, i + 1, session->cmds[i].text, expected, got);
+        }
+    }
+    free(line);
+    fclose(file);
+    if (compared != config->num_commands) {
+        fprintf(stderr, "Respostas de referência de outro log ou com outras opções (%llu de %llu comandos)\n",
+                (unsigned long long)compared, (unsigned long long)config->num_commands);
+        exit(1);
+    }
+    printf("Respostas comparadas com %s: %llu diferentes de %llu (\"-\": sem resposta)\n",
+           config->compare_path, (unsigned long long)differences, (unsigned long long)compared);
+    return differences;
+}
+
+// ---- Configuração ----
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Uso: %s [opções] <log> <servidor> <porta>\n", prog);
+    fprintf(stderr, "  --speed <x>        Velocidade em relação ao log, ou max (padrão: 1)\n");
+    fprintf(stderr, "  --connections <n>  Sessões simultâneas com --speed max (padrão: 100)\n");
+    fprintf(stderr, "  --threads <n>      Threads com epoll próprio (padrão: um por núcleo)\n");
+    fprintf(stderr, "  --admin            Reproduz também os comandos ADMIN (ADMIN CLOSE encerra a votação)\n");
+    fprintf(stderr, "  --save <arquivo>   Grava a classe da resposta de cada comando\n");
+    fprintf(stderr, "  --compare <arquivo> Compara as respostas com as gravadas por --save\n");
+}
+
+static void parse_args(int argc, char *argv[], ReplayConfig *config) {
+    static struct option long_options[] = {
+        {"speed", required_argument, NULL, 's'},
+        {"connections", required_argument, NULL, 'c'},
+        {"threads", required_argument, NULL, 't'},
+        {"admin", no_argument, NULL, 'a'},
+        {"save", required_argument, NULL, 'w'},
+        {"compare", required_argument, NULL, 'r'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    memset(config, 0, sizeof(*config));
+    config->speed = 1;
+    config->connections = 100;
+    config->threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    int c;
+    while ((c = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (c) {
+            case 's':
+                config->speed = strcmp(optarg, "max") == 0 ? 0 : atof(optarg);
+                if (config->speed <= 0 && strcmp(optarg, "max") != 0) {
+                    fprintf(stderr, "Velocidade inválida: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'c':
+                config->connections = atoi(optarg);
+                break;
+            case 't':
+                config->threads = atoi(optarg);
+                break;
+            case 'a':
+                config->admin = true;
+                break;
+            case 'w':
+                config->save_path = optarg;
+                break;
+            case 'r':
+                config->compare_path = optarg;
+                break;
+            default:
+                print_usage(argv[0]);
+                exit(1);
+        }
+    }
+
+    if (optind != argc - 3 || config->connections < 1) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+    config->log_path = argv[optind];
+    config->host = argv[optind + 1];
+    config->port = atoi(argv[optind + 2]);
+    if (config->threads < 1) {
+        config->threads = 1;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    ReplayConfig config;
+    parse_args(argc, argv, &config);
+
+    parse_log(&config);
+    if (config.threads > config.num_sessions) {
+        config.threads = config.num_sessions;
+    }
+    printf("Log %s: %llu comandos em %d sessões, %.1f s de tráfego\n", config.log_path,
+           (unsigned long long)config.num_commands, config.num_sessions, config.log_span_ns / 1e9);
+    if (config.ignored > 0 || config.skipped_admin > 0) {
+        printf("Fora do replay: %llu comandos sem sessão (antes do HELLO), %llu ADMIN\n",
+               (unsigned long long)config.ignored, (unsigned long long)config.skipped_admin);
+    }
+    if (config.speed > 0) {
+        printf("Replay a %gx (%.1f s)\n", config.speed, config.log_span_ns / 1e9 / config.speed);
+    } else {
+        printf("Replay na velocidade máxima, %d sessões simultâneas\n", config.connections);
+    }
+
+    // As sessões são repartidas entre as threads na ordem do log
+    ReplayThread *threads = calloc(config.threads, sizeof(ReplayThread));
+    if (threads == NULL) {
+        perror("Erro ao alocar threads");
+        exit(1);
+    }
+    for (int t = 0; t < config.threads; t++) {
+        ReplayThread *thread = &threads[t];
+        thread->id = t;
+        thread->config = &config;
+        int count = config.num_sessions / config.threads + (t < config.num_sessions % config.threads);
+        thread->sessions = malloc(count * sizeof(ReplaySession *));
+        thread->heap = malloc(count * sizeof(ReplaySession *));
+        if (thread->sessions == NULL || thread->heap == NULL) {
+            perror("Erro ao alocar threads");
+            exit(1);
+        }
+        for (int s = t; s < config.num_sessions; s += config.threads) {
+            thread->sessions[thread->num_sessions++] = &config.sessions[s];
+        }
+        for (int c = 0; c < REPLAY_COMMANDS; c++) {
+            histogram_reset(&thread->hist[c]);
+        }
+        histogram_reset(&thread->lag);
+        thread->epoll_fd = epoll_create1(0);
+        if (thread->epoll_fd < 0) {
+            perror("Erro no epoll_create1");
+            exit(1);
+        }
+    }
+
+    uint64_t start = now_ns();
+    for (int t = 0; t < config.threads; t++) {
+        threads[t].start_ns = start;
+        if (pthread_create(&threads[t].thread, NULL, replay_thread, &threads[t]) != 0) {
+            perror("Erro ao criar thread");
+            exit(1);
+        }
+    }
+    uint64_t end = start;
+    for (int t = 0; t < config.threads; t++) {
+        pthread_join(threads[t].thread, NULL);
+        close(threads[t].epoll_fd);
+        if (threads[t].end_ns > end) {
+            end = threads[t].end_ns;
+        }
+    }
+
+    print_report(&config, threads, (end - start) / 1e9);
+    int status = 0;
+    if (config.save_path != NULL) {
+        save_responses(&config);
+    }
+    if (config.compare_path != NULL && compare_responses(&config) > 0) {
+        status = 1;
+    }
+
+    for (int t = 0; t < config.threads; t++) {
+        free(threads[t].sessions);
+        free(threads[t].heap);
+    }
+    free(threads);
+    return status;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "response_cache.h"
+#include "binary_protocol.h"
+#include "latency.h"
+
+static void build_options(ResponseCache *cache) {
+    size_t len = sprintf(cache->options_text, "%s %d", RESP_OPTIONS, cache->num_options);
+    uint8_t *out = cache->options_binary + BIN_HEADER_SIZE;
+    size_t binary_len = bin_put_varint(out, cache->num_options);
+
+    for (int i = 0; i < cache->num_options; i++) {
+        size_t name_len = strlen(cache->names[i]);
+        cache->options_text[len++] = '|';
+        memcpy(cache->options_text + len, cache->names[i], name_len);
+        len += name_len;
+
+        binary_len += bin_put_varint(out + binary_len, name_len);
+        memcpy(out + binary_len, cache->names[i], name_len);
+        binary_len += name_len;
+    }
+    cache->options_text[len++] = '\n';
+    cache->options_text_len = len;
+
+    bin_put_header(cache->options_binary, BIN_OPTIONS, 0, (uint16_t)binary_len);
+    cache->options_binary_len = BIN_HEADER_SIZE + binary_len;
+}
+
+void response_cache_format_score(const ResponseCache *cache, const uint64_t *counts, bool final, uint8_t flags,
+                                 char *text, size_t *text_len, uint8_t *binary, size_t *binary_len) {
+    size_t len = sprintf(text, "%s %d", final ? RESP_CLOSED : RESP_SCORE, cache->num_options);
+    uint8_t *out = binary + BIN_HEADER_SIZE;
+    size_t payload_len = bin_put_varint(out, cache->num_options);
+    for (int i = 0; i < cache->num_options; i++) {
+        len += sprintf(text + len, "|%s:%llu", cache->names[i], (unsigned long long)counts[i]);
+        bin_put_u32(out + payload_len, counts[i] > UINT32_MAX ? UINT32_MAX : (uint32_t)counts[i]);
+        payload_len += 4;
+    }
+    text[len++] = '\n';
+    *text_len = len;
+    bin_put_header(binary, BIN_SCORE_RESP, flags | (final ? BIN_FLAG_FINAL : 0), (uint16_t)payload_len);
+    *binary_len = BIN_HEADER_SIZE + payload_len;
+}
+
+// Serializa os contadores no buffer que os leitores não estão usando
+// (chamado com build_lock)
+static void build_score(ResponseCache *cache, Tally *tally, bool final) {
+    unsigned next = atomic_load_explicit(&cache->current, memory_order_relaxed) ^ 1;
+    ScoreBuffer *buffer = &cache->score[next];
+    uint64_t version;
+    tally_snapshot(tally, cache->counts, &version);
+
+    uint64_t seq = atomic_load_explicit(&buffer->seq, memory_order_relaxed);
+    atomic_store_explicit(&buffer->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    response_cache_format_score(cache, cache->counts, final, 0, buffer->text, &buffer->text_len,
+                                buffer->binary, &buffer->binary_len);
+    buffer->version = version;
+    buffer->final = final;
+
+    atomic_store_explicit(&buffer->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&cache->current, next, memory_order_release);
+}
+
+// Tamanhos máximos das respostas de texto e do payload binário
+static void response_sizes(const char *const *names, int num_options, size_t *text, size_t *payload) {
+    size_t names_len = 0;
+    for (int i = 0; i < num_options; i++) {
+        names_len += strlen(names[i]);
+    }
+    // "CLOSED FINAL <k>" e, por opção, "|nome:<contador>" (até 20 dígitos)
+    size_t score_text = strlen(RESP_CLOSED) + 12 + names_len + (size_t)num_options * 22 + 1;
+    size_t options_text = strlen(RESP_OPTIONS) + 12 + names_len + (size_t)num_options + 1;
+    // k em varint e, por opção, o nome com tamanho em varint ou o contador u32
+    size_t score_payload = 10 + (size_t)num_options * 4;
+    size_t options_payload = 10 + names_len + (size_t)num_options * 2;
+
+    *text = score_text > options_text ? score_text : options_text;
+    *payload = score_payload > options_payload ? score_payload : options_payload;
+}
+
+bool response_cache_fits(const char *const *names, int num_options) {
+    size_t text, payload;
+    response_sizes(names, num_options, &text, &payload);
+    return payload <= UINT16_MAX;
+}
+
+int response_cache_init(ResponseCache *cache, const char *const *names, int num_options,
+                        uint64_t interval_ns) {
+    memset(cache, 0, sizeof(*cache));
+    pthread_mutex_init(&cache->build_lock, NULL);
+    size_t text, payload;
+    response_sizes(names, num_options, &text, &payload);
+    cache->max_len = text > BIN_HEADER_SIZE + payload ? text : BIN_HEADER_SIZE + payload;
+
+    cache->names = malloc(num_options * sizeof(char *));
+    cache->counts = malloc(num_options * sizeof(uint64_t));
+    cache->options_text = malloc(cache->max_len);
+    cache->options_binary = malloc(cache->max_len);
+    bool ok = cache->names && cache->counts && cache->options_text && cache->options_binary;
+    for (int i = 0; i < 2; i++) {
+        cache->score[i].text = malloc(cache->max_len);
+        cache->score[i].binary = malloc(cache->max_len);
+        ok = ok && cache->score[i].text && cache->score[i].binary;
+    }
+    if (!ok) {
+        response_cache_destroy(cache);
+        return -1;
+    }
+
+    for (int i = 0; i < num_options; i++) {
+        cache->names[i] = names[i];
+    }
+    cache->num_options = num_options;
+    cache->interval_ns = interval_ns;
+    build_options(cache);
+    return 0;
+}
+
+void response_cache_destroy(ResponseCache *cache) {
+    pthread_mutex_destroy(&cache->build_lock);
+    for (int i = 0; i < 2; i++) {
+        free(cache->score[i].text);
+        free(cache->score[i].binary);
+    }
+    free(cache->names);
+    free(cache->counts);
+    free(cache->options_text);
+    free(cache->options_binary);
+    memset(cache, 0, sizeof(*cache));
+}
+
+size_t response_cache_options(const ResponseCache *cache, bool binary, void *out) {
+    if (binary) {
+        memcpy(out, cache->options_binary, cache->options_binary_len);
+        return cache->options_binary_len;
+    }
+    memcpy(out, cache->options_text, cache->options_text_len);
+    return cache->options_text_len;
+}
+
+// O buffer atual precisa ser refeito?
+static bool score_stale(ResponseCache *cache, Tally *tally, bool final) {
+    const ScoreBuffer *buffer = &cache->score[atomic_load_explicit(&cache->current, memory_order_acquire)];
+    if (buffer->text_len == 0 || buffer->final != final) {
+        return true;
+    }
+    if (monotonic_ns() < atomic_load_explicit(&cache->next_build_ns, memory_order_relaxed)) {
+        return false;
+    }
+    return tally_version(tally) != buffer->version;
+}
+
+size_t response_cache_score(ResponseCache *cache, Tally *tally, bool final, bool binary, void *out) {
+    if (score_stale(cache, tally, final)) {
+        pthread_mutex_lock(&cache->build_lock);
+        // Outra thread pode ter reconstruído enquanto esperávamos o lock
+        if (score_stale(cache, tally, final)) {
+            build_score(cache, tally, final);
+            atomic_store_explicit(&cache->next_build_ns, monotonic_ns() + cache->interval_ns,
+                                  memory_order_relaxed);
+        }
+        pthread_mutex_unlock(&cache->build_lock);
+    }
+
+    while (1) {
+        const ScoreBuffer *buffer = &cache->score[atomic_load_explicit(&cache->current, memory_order_acquire)];
+        uint64_t seq = atomic_load_explicit(&buffer->seq, memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+        size_t len = binary ? buffer->binary_len : buffer->text_len;
+        if (len > cache->max_len) {
+            continue;
+        }
+        memcpy(out, binary ? (const void *)buffer->binary : (const void *)buffer->text, len);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&buffer->seq, memory_order_relaxed) == seq) {
+            return len;
+        }
+    }
+}
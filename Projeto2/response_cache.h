@@ -0,0 +1,71 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "protocol.h"
+#include "tally.h"
+
+// Resposta de SCORE já serializada nos dois protocolos. seq funciona como
+// seqlock: é ímpar enquanto o buffer está sendo reescrito.
+typedef struct {
+    _Atomic uint64_t seq;
+    uint64_t version;           // versão do Tally refletida
+    bool final;
+    size_t text_len;
+    size_t binary_len;
+    char *text;                 // "SCORE ...\n" ou "CLOSED FINAL ...\n"
+    uint8_t *binary;
+} ScoreBuffer;
+
+// Respostas pré-serializadas de LIST e SCORE. OPTIONS é montado uma vez
+// em response_cache_set_options; SCORE é reconstruído sob demanda, só
+// quando os votos mudaram e no máximo uma vez por intervalo. Leitores só
+// copiam o buffer atual, sem lock.
+typedef struct {
+    const char **names;
+    int num_options;
+    size_t max_len;             // maior resposta possível, em qualquer protocolo
+
+    char *options_text;
+    size_t options_text_len;
+    uint8_t *options_binary;
+    size_t options_binary_len;
+
+    // Dois buffers: leitores copiam o atual enquanto o outro é reescrito
+    ScoreBuffer score[2];
+    _Atomic unsigned current;
+    _Atomic uint64_t next_build_ns;     // antes disso não reconstrói
+    uint64_t interval_ns;
+    pthread_mutex_t build_lock;         // um único reconstrutor por vez
+    uint64_t *counts;                   // placar lido pelo reconstrutor
+} ResponseCache;
+
+// As respostas de LIST e SCORE cabem no payload de um quadro binário
+// (tamanho u16)?
+bool response_cache_fits(const char *const *names, int num_options);
+
+// Os nomes devem continuar válidos (e imutáveis) enquanto o cache existir.
+// Retorna -1 sem memória.
+int response_cache_init(ResponseCache *cache, const char *const *names, int num_options,
+                        uint64_t interval_ns);
+void response_cache_destroy(ResponseCache *cache);
+
+// Copia a resposta de LIST para out e retorna o tamanho
+size_t response_cache_options(const ResponseCache *cache, bool binary, void *out);
+
+// Serializa um placar nos dois protocolos: "SCORE ...\n" (ou "CLOSED
+// FINAL ...\n") em text e o quadro BIN_SCORE_RESP, com flags além de
+// BIN_FLAG_FINAL, em binary. Os dois buffers precisam de max_len bytes.
+void response_cache_format_score(const ResponseCache *cache, const uint64_t *counts, bool final, uint8_t flags,
+                                 char *text, size_t *text_len, uint8_t *binary, size_t *binary_len);
+
+// Copia a resposta de SCORE para out (até max_len bytes) e retorna o
+// tamanho. Reconstrói antes se a versão do Tally ou o estado final mudou
+// e o intervalo já passou; a mudança para final ignora o intervalo.
+size_t response_cache_score(ResponseCache *cache, Tally *tally, bool final, bool binary, void *out);
+
+#endif
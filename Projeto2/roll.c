@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "roll.h"
+#include "protocol.h"
+#include "voter_table.h"
+#include "latency.h"
+
+#define ROLL_MAX_THREADS 16
+#define ROLL_INITIAL_ENTRIES 1024
+
+// Filtro em blocos de uma linha de cache: os ROLL_BLOOM_HASHES bits de um
+// ID ficam todos no bloco escolhido pelos bits altos do hash, então cada
+// consulta lê uma linha só. As posições saem de 9 em 9 bits do hash
+// remisturado.
+#define ROLL_BLOCK_WORDS 8
+#define ROLL_BLOCK_SHIFT 9      // log2 dos bits de um bloco
+#define ROLL_BLOOM_MIX 0x9E3779B97F4A7C15ULL
+
+// Uma parte do arquivo, lida por uma thread. Cada linha pertence à parte
+// em que começa.
+typedef struct {
+    const char *data;
+    size_t start;
+    size_t end;
+    RollEntry *entries;
+    size_t count;
+    size_t capacity;
+    const char *error;          // mensagem do primeiro erro (NULL: nenhum)
+    size_t error_offset;
+} RollChunk;
+
+// Faixa de baldes que uma thread ordena e marca no filtro
+typedef struct {
+    VoterRoll *roll;
+    size_t start;
+    size_t end;
+} BucketRange;
+
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static uint64_t bucket_of(const VoterRoll *roll, uint64_t hash) {
+    return hash >> (64 - roll->bucket_bits);
+}
+
+static uint64_t *bloom_block(const VoterRoll *roll, uint64_t hash) {
+    return roll->bloom + (hash >> (64 - (roll->bloom_bits - ROLL_BLOCK_SHIFT))) * ROLL_BLOCK_WORDS;
+}
+
+static bool add_entry(RollChunk *chunk, uint64_t hash, size_t offset) {
+    if (chunk->count == chunk->capacity) {
+        size_t new_capacity = chunk->capacity ? chunk->capacity * 2 : ROLL_INITIAL_ENTRIES;
+        RollEntry *entries = realloc(chunk->entries, new_capacity * sizeof(RollEntry));
+        if (entries == NULL) {
+            return false;
+        }
+        chunk->entries = entries;
+        chunk->capacity = new_capacity;
+    }
+    chunk->entries[chunk->count].hash = hash;
+    chunk->entries[chunk->count].offset = offset;
+    chunk->count++;
+    return true;
+}
+
+static void chunk_error(RollChunk *chunk, const char *error, size_t offset) {
+    chunk->error = error;
+    chunk->error_offset = offset;
+}
+
+// Lê os IDs da parte, na ordem do arquivo
+static void *parse_chunk(void *arg) {
+    RollChunk *chunk = (RollChunk *)arg;
+    const char *data = chunk->data;
+    size_t pos = chunk->start;
+    char voter_id[MAX_VOTER_ID];
+
+    while (pos < chunk->end) {
+        size_t line = pos;
+        while (pos < chunk->end && is_blank(data[pos])) {
+            pos++;
+        }
+        size_t id_start = pos;
+        while (pos < chunk->end && data[pos] != '\n' && !is_blank(data[pos])) {
+            pos++;
+        }
+        size_t len = pos - id_start;
+        while (pos < chunk->end && is_blank(data[pos])) {
+            pos++;
+        }
+        bool comment = len > 0 && data[id_start] == '#';
+        if (!comment && pos < chunk->end && data[pos] != '\n') {
+            chunk_error(chunk, "mais de um VOTER_ID na linha", line);
+            return NULL;
+        }
+        while (pos < chunk->end && data[pos] != '\n') {
+            pos++;
+        }
+        pos++;
+
+        if (len == 0 || comment) {
+            continue;
+        }
+        if (len > MAX_VOTER_ID - 1) {
+            chunk_error(chunk, "VOTER_ID longo demais", line);
+            return NULL;
+        }
+        memcpy(voter_id, data + id_start, len);
+        voter_id[len] = '\0';
+        if (!add_entry(chunk, voter_hash(voter_id), id_start)) {
+            chunk_error(chunk, "sem memória", line);
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+// Ordena os baldes da faixa pelo hash (poucas entradas cada; a ordenação
+// por inserção é estável, então IDs repetidos ficam na ordem do arquivo)
+// e marca as entradas no filtro. Blocos do filtro podem ser de baldes de
+// outras threads: os bits são marcados com OR atômico.
+static void *finish_buckets(void *arg) {
+    BucketRange *range = (BucketRange *)arg;
+    VoterRoll *roll = range->roll;
+    RollEntry *entries = roll->entries;
+    for (size_t b = range->start; b < range->end; b++) {
+        for (size_t i = roll->buckets[b] + 1; i < roll->buckets[b + 1]; i++) {
+            RollEntry entry = entries[i];
+            size_t j = i;
+            while (j > roll->buckets[b] && entries[j - 1].hash > entry.hash) {
+                entries[j] = entries[j - 1];
+                j--;
+            }
+            entries[j] = entry;
+        }
+    }
+    for (size_t i = roll->buckets[range->start]; i < roll->buckets[range->end]; i++) {
+        uint64_t *block = bloom_block(roll, entries[i].hash);
+        uint64_t h = entries[i].hash * ROLL_BLOOM_MIX;
+        for (int k = 0; k < ROLL_BLOOM_HASHES; k++, h >>= ROLL_BLOCK_SHIFT) {
+            unsigned bit = h & ((1 << ROLL_BLOCK_SHIFT) - 1);
+            __atomic_fetch_or(&block[bit / 64], 1ULL << (bit % 64), __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+// Roda fn(args[i]) em count threads e espera todas
+static void run_parallel(void *(*fn)(void *), void *args, size_t arg_size, int count) {
+    pthread_t threads[ROLL_MAX_THREADS];
+    for (int i = 1; i < count; i++) {
+        if (pthread_create(&threads[i], NULL, fn, (char *)args + i * arg_size) != 0) {
+            perror("Erro ao criar thread de carga do cadastro");
+            exit(1);
+        }
+    }
+    fn(args);
+    for (int i = 1; i < count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+static int log2_ceil(uint64_t value) {
+    int bits = 0;
+    while (bits < 63 && (1ULL << bits) < value) {
+        bits++;
+    }
+    return bits;
+}
+
+VoterRoll *roll_load(const char *path, int threads) {
+    uint64_t start = monotonic_ns();
+    VoterRoll *roll = calloc(1, sizeof(VoterRoll));
+    if (roll == NULL) {
+        perror("Erro ao alocar cadastro de eleitores");
+        exit(1);
+    }
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "Erro ao abrir cadastro de eleitores %s: %m\n", path);
+        exit(1);
+    }
+    roll->size = st.st_size;
+    if (roll->size > 0) {
+        void *map = mmap(NULL, roll->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "Erro ao mapear cadastro de eleitores %s: %m\n", path);
+            exit(1);
+        }
+        madvise(map, roll->size, MADV_SEQUENTIAL);
+        roll->data = map;
+    }
+    close(fd);
+
+    // Partes de pelo menos 1 MB, cada uma começando numa linha nova
+    if (threads > ROLL_MAX_THREADS) {
+        threads = ROLL_MAX_THREADS;
+    }
+    while (threads > 1 && roll->size / threads < (1 << 20)) {
+        threads--;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    RollChunk chunks[ROLL_MAX_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+    for (int i = 0; i < threads; i++) {
+        size_t pos = roll->size / threads * i;
+        while (i > 0 && pos < roll->size && roll->data[pos - 1] != '\n') {
+            pos++;
+        }
+        chunks[i].data = roll->data;
+        chunks[i].start = pos;
+        if (i > 0) {
+            chunks[i - 1].end = pos;
+        }
+    }
+    chunks[threads - 1].end = roll->size;
+    run_parallel(parse_chunk, chunks, sizeof(RollChunk), threads);
+
+    size_t total = 0;
+    for (int i = 0; i < threads; i++) {
+        if (chunks[i].error != NULL) {
+            size_t line = 1;
+            for (size_t pos = 0; pos < chunks[i].error_offset; pos++) {
+                line += roll->data[pos] == '\n';
+            }
+            fprintf(stderr, "Cadastro de eleitores %s, linha %zu: %s\n", path, line, chunks[i].error);
+            exit(1);
+        }
+        total += chunks[i].count;
+    }
+    if (total > UINT32_MAX) {
+        fprintf(stderr, "Cadastro de eleitores %s: mais de %u IDs\n", path, UINT32_MAX);
+        exit(1);
+    }
+
+    // Diretório com ~4 entradas por balde e filtro com
+    // ROLL_BLOOM_BITS_PER_ID bits por ID (potências de 2)
+    roll->count = total;
+    roll->bucket_bits = log2_ceil(total / 4 + 1);
+    if (roll->bucket_bits < 1) {
+        roll->bucket_bits = 1;
+    }
+    roll->bloom_bits = log2_ceil(total * ROLL_BLOOM_BITS_PER_ID);
+    if (roll->bloom_bits < ROLL_BLOCK_SHIFT + 1) {
+        roll->bloom_bits = ROLL_BLOCK_SHIFT + 1;
+    }
+    size_t num_buckets = (size_t)1 << roll->bucket_bits;
+    roll->entries = malloc((total ? total : 1) * sizeof(RollEntry));
+    roll->buckets = calloc(num_buckets + 1, sizeof(uint32_t));
+    roll->bloom = aligned_alloc(64, ((size_t)1 << roll->bloom_bits) / 8);
+    if (roll->entries == NULL || roll->buckets == NULL || roll->bloom == NULL) {
+        perror("Erro ao alocar cadastro de eleitores");
+        exit(1);
+    }
+    memset(roll->bloom, 0, ((size_t)1 << roll->bloom_bits) / 8);
+
+    // Distribui as entradas pelos baldes (contagem, soma de prefixos e
+    // cópia), na ordem do arquivo
+    for (int i = 0; i < threads; i++) {
+        for (size_t j = 0; j < chunks[i].count; j++) {
+            roll->buckets[bucket_of(roll, chunks[i].entries[j].hash) + 1]++;
+        }
+    }
+    for (size_t b = 0; b < num_buckets; b++) {
+        roll->buckets[b + 1] += roll->buckets[b];
+    }
+    for (int i = 0; i < threads; i++) {
+        for (size_t j = 0; j < chunks[i].count; j++) {
+            uint64_t b = bucket_of(roll, chunks[i].entries[j].hash);
+            roll->entries[roll->buckets[b]++] = chunks[i].entries[j];
+        }
+        free(chunks[i].entries);
+    }
+    // Cada buckets[b] avançou até o início do balde seguinte
+    memmove(roll->buckets + 1, roll->buckets, num_buckets * sizeof(uint32_t));
+    roll->buckets[0] = 0;
+
+    BucketRange ranges[ROLL_MAX_THREADS];
+    for (int i = 0; i < threads; i++) {
+        ranges[i].roll = roll;
+        ranges[i].start = num_buckets / threads * i;
+        ranges[i].end = i == threads - 1 ? num_buckets : num_buckets / threads * (i + 1);
+    }
+    run_parallel(finish_buckets, ranges, sizeof(BucketRange), threads);
+
+    roll->threads = threads;
+    roll->load_ms = (monotonic_ns() - start) / 1e6;
+    return roll;
+}
+
+void roll_free(VoterRoll *roll) {
+    if (roll == NULL) {
+        return;
+    }
+    if (roll->data != NULL) {
+        munmap((void *)roll->data, roll->size);
+    }
+    free(roll->entries);
+    free(roll->buckets);
+    free(roll->bloom);
+    free(roll);
+}
+
+// O ID do arquivo em offset é exatamente voter_id
+static bool id_matches(const VoterRoll *roll, uint64_t offset, const char *voter_id, size_t len) {
+    return offset + len <= roll->size && memcmp(roll->data + offset, voter_id, len) == 0 &&
+           (offset + len == roll->size || roll->data[offset + len] == '\n' ||
+            is_blank(roll->data[offset + len]));
+}
+
+RollLookup roll_lookup(const VoterRoll *roll, const char *voter_id, uint64_t hash) {
+    const uint64_t *block = bloom_block(roll, hash);
+    uint64_t h = hash * ROLL_BLOOM_MIX;
+    for (int k = 0; k < ROLL_BLOOM_HASHES; k++, h >>= ROLL_BLOCK_SHIFT) {
+        unsigned bit = h & ((1 << ROLL_BLOCK_SHIFT) - 1);
+        if (((block[bit / 64] >> (bit % 64)) & 1) == 0) {
+            return ROLL_BLOOM_REJECT;
+        }
+    }
+
+    // Primeira entrada do balde com esse hash
+    uint64_t bucket = bucket_of(roll, hash);
+    size_t lo = roll->buckets[bucket];
+    size_t hi = roll->buckets[bucket + 1];
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (roll->entries[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    size_t len = strlen(voter_id);
+    for (size_t i = lo; i < roll->count && roll->entries[i].hash == hash; i++) {
+        if (id_matches(roll, roll->entries[i].offset, voter_id, len)) {
+            return ROLL_ELIGIBLE;
+        }
+    }
+    return ROLL_INDEX_REJECT;
+}
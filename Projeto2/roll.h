@@ -0,0 +1,61 @@
+#ifndef ROLL_H
+#define ROLL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Cadastro de eleitores: os VOTER_IDs que podem votar, lidos de um arquivo
+// (um por linha; linhas vazias e iniciadas por # são ignoradas) e
+// imutáveis depois da carga, então as consultas não usam lock. Um filtro
+// de Bloom na frente recusa quase todos os IDs fora do cadastro sem tocar
+// no índice; os que passam são procurados no índice ordenado pelo hash.
+
+// Bits do filtro por ID, no mínimo (com ROLL_BLOOM_HASHES funções: ~1% de
+// falsos positivos)
+#define ROLL_BLOOM_BITS_PER_ID 10
+#define ROLL_BLOOM_HASHES 7
+
+// Entrada do índice: hash do VOTER_ID e onde ele está no arquivo mapeado
+typedef struct {
+    uint64_t hash;
+    uint64_t offset;
+} RollEntry;
+
+typedef struct VoterRoll {
+    const char *data;           // arquivo mapeado (só leitura)
+    size_t size;
+    RollEntry *entries;         // ordenadas pelo hash
+    size_t count;
+
+    // Diretório pelos bits altos do hash: as entradas do balde b estão em
+    // [buckets[b], buckets[b + 1])
+    uint32_t *buckets;
+    int bucket_bits;
+
+    uint64_t *bloom;
+    int bloom_bits;             // log2 do tamanho do filtro em bits
+
+    int threads;                // threads usadas na carga
+    double load_ms;             // tempo de carga
+} VoterRoll;
+
+typedef enum {
+    ROLL_ELIGIBLE,
+    ROLL_BLOOM_REJECT,          // recusado pelo filtro, sem tocar no índice
+    ROLL_INDEX_REJECT,          // passou pelo filtro (falso positivo), não está no índice
+    ROLL_RESULTS
+} RollLookup;
+
+// Carrega o cadastro de path em até threads threads: o arquivo é dividido
+// em partes lidas em paralelo, e os baldes do índice são ordenados e
+// marcados no filtro em paralelo. Erros de leitura ou IDs inválidos
+// encerram o processo.
+VoterRoll *roll_load(const char *path, int threads);
+
+void roll_free(VoterRoll *roll);
+
+// Procura o VOTER_ID (hash = voter_hash(voter_id)). Sem locks.
+RollLookup roll_lookup(const VoterRoll *roll, const char *voter_id, uint64_t hash);
+
+#endif
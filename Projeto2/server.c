@@ -2,420 +2,919 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
 #include <pthread.h>
 #include <stdarg.h>
 #include <time.h>
+#include <getopt.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include "server.h"
 #include "protocol.h"
+#include "event_loop.h"
+#include "connection.h"
+#include "binary_protocol.h"
+#include "election.h"
+#include "cluster.h"
+#include "metrics.h"
+#include "roll.h"
+#include "uring.h"
+#ifdef WITH_MPI
+#include "mpi_tally.h"
+#endif
 
-// Inicializa o servidor
-void init_server(ElectionServer *server) {
-    server->num_options = 0;
-    server->num_voters = 0;
-    server->election_closed = false;
-    pthread_mutex_init(&server->mutex, NULL);
+#define DEFAULT_COMMIT_WINDOW_US 1000
+#define DEFAULT_CHECKPOINT_INTERVAL_S 60
+#define DEFAULT_WATCH_INTERVAL_MS 100
+#define DEFAULT_ELECTION "principal"
+#define DEFAULT_QUEUE_DEPTH 128
+#define DEFAULT_CLUSTER_TTL_MS 50
+#define DEFAULT_HANDSHAKE_TIMEOUT_S 10
+#define DEFAULT_IDLE_TIMEOUT_S 300
+
+// Modo thread: ticks entre o aviso de prazo vencido e o fechamento forçado
+// de um cliente que não lê a resposta
+#define TIMEOUT_GRACE_TICKS 10
+
+// Inicializa o servidor e abre as eleições. Sem --election há uma única
+// eleição, com opcoes.txt e os arquivos direto em logs/ (o log é o do
+// servidor); cada eleição nomeada grava em logs/<nome>/. Com outro
+// log_dir (server_mpi), o mesmo vale dentro dele.
+void init_server(ElectionServer *server, const ServerConfig *config) {
+    server->log = &server->logger;
+    server->num_shards = config->sharded ? config->num_loops : 0;
+    server->io_uring = false;
+    atomic_init(&server->handoffs, 0);
+    server->pool = NULL;
+    server->cluster = NULL;
+    server->handshake_timeout_ns = config->handshake_timeout_s * 1000000000ULL;
+    server->idle_timeout_ns = config->idle_timeout_s * 1000000000ULL;
+    server->session_timeout_ns = config->session_timeout_s * 1000000000ULL;
+    server->roll = NULL;
     
-    // Abre arquivo de log
-    server->log_file = fopen("logs/eleicao.log", "a");
-    if (server->log_file == NULL) {
+    // Abre arquivo de log e inicia a thread de escrita
+    char log_path[128];
+    snprintf(log_path, sizeof(log_path), "%s/eleicao.log", config->log_dir);
+    if (mkdir(config->log_dir, 0755) < 0 && errno != EEXIST) {
+        perror("Erro ao criar diretório de logs");
+        exit(1);
+    }
+    if (logger_init(&server->logger, log_path, config->log_capacity,
+                    config->log_policy, config->log_level) < 0) {
         perror("Erro ao abrir arquivo de log");
         exit(1);
     }
     
-    write_log(server, "=== Servidor iniciado ===");
-}
-
-// Carrega opções de votação do arquivo
-void load_options(ElectionServer *server, const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
-        fprintf(stderr, "Erro: não foi possível abrir %s\n", filename);
+    LOG_INFO(server, "=== Servidor iniciado ===");
+    
+    // O cadastro é lido antes de abrir as eleições: a recuperação do
+    // journal não depende dele, mas nenhum HELLO é aceito sem ele
+    if (config->roll_path != NULL) {
+        VoterRoll *roll = roll_load(config->roll_path, (int)sysconf(_SC_NPROCESSORS_ONLN));
+        size_t index_bytes = roll->count * sizeof(RollEntry) +
+                             (((size_t)1 << roll->bucket_bits) + 1) * sizeof(uint32_t);
+        LOG_INFO(server, "Cadastro de eleitores %s: %zu IDs em %.0f ms (%d threads; índice %.1f MB, "
+                 "filtro %.1f MB)", config->roll_path, roll->count, roll->load_ms, roll->threads,
+                 index_bytes / 1048576.0, ((size_t)1 << roll->bloom_bits) / 8 / 1048576.0);
+        server->roll = roll;
+    }
+    
+    if (config->cluster_nodes != NULL) {
+        server->cluster = cluster_create(server, config->cluster_nodes, config->node_id,
+                                         config->cluster_ttl_ms);
+    }
+    
+    ElectionSpec default_spec = {DEFAULT_ELECTION, "opcoes.txt"};
+    const ElectionSpec *specs = config->num_elections > 0 ? config->elections : &default_spec;
+    server->num_elections = config->num_elections > 0 ? config->num_elections : 1;
+    server->elections = calloc(server->num_elections, sizeof(Election *));
+    if (server->elections == NULL) {
+        perror("Erro ao alocar eleições");
         exit(1);
     }
     
-    char line[MAX_OPTION_NAME];
-    while (fgets(line, sizeof(line), file) && server->num_options < MAX_OPTIONS) {
-        // Remove newline
-        line[strcspn(line, "\n")] = 0;
+    // Cada eleição traz suas próprias threads (journal, checkpoint, WATCH)
+    server->max_response = MAX_BUFFER;
+    for (int i = 0; i < server->num_elections; i++) {
+        Election *election;
+        if (config->num_elections == 0) {
+            election = election_open(&specs[i], i, config->log_dir, server->log, config, server->cluster);
+        } else {
+            char dir[128];
+            snprintf(dir, sizeof(dir), "%s/%s", config->log_dir, specs[i].name);
+            election = election_open(&specs[i], i, dir, NULL, config, server->cluster);
+        }
+        server->elections[i] = election;
         
-        if (strlen(line) > 0) {
-            strncpy(server->options[server->num_options].name, line, MAX_OPTION_NAME - 1);
-            server->options[server->num_options].votes = 0;
-            server->num_options++;
+        // Maior resposta: WATCH (confirmação seguida do placar)
+        size_t max_response = strlen(RESP_WATCHING) + 1 + election->responses.max_len;
+        // Resposta do FTALLY entre nós: um contador decimal por opção
+        if (server->cluster != NULL && 64 + 21 * (size_t)election->num_options > max_response) {
+            max_response = 64 + 21 * (size_t)election->num_options;
         }
+        if (max_response > server->max_response) {
+            server->max_response = max_response;
+        }
+        LOG_INFO(server, "Eleição %s aberta (%d opções)", election->name, election->num_options);
     }
     
-    fclose(file);
-    write_log(server, "Carregadas %d opções de votação", server->num_options);
-    
-    if (server->num_options < 3) {
-        fprintf(stderr, "Erro: é necessário ter pelo menos 3 opções de votação\n");
-        exit(1);
+    if (server->cluster != NULL) {
+        cluster_start(server->cluster);
+    }
+}
+
+// Eleição pelo nome; nome vazio ou NULL é a eleição padrão
+Election *find_election(ElectionServer *server, const char *name) {
+    if (name == NULL || name[0] == '\0') {
+        return server->elections[0];
     }
+    for (int i = 0; i < server->num_elections; i++) {
+        if (strcmp(server->elections[i]->name, name) == 0) {
+            return server->elections[i];
+        }
+    }
+    return NULL;
 }
 
-// Escreve no log com timestamp
+// Escreve no log com timestamp. Apenas enfileira a mensagem; a thread do
+// logger formata o timestamp e grava em lote.
 void write_log(ElectionServer *server, const char *format, ...) {
-    time_t now;
-    time(&now);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
-    
-    pthread_mutex_lock(&server->mutex);
-    
-    fprintf(server->log_file, "[%s] ", timestamp);
-    
     va_list args;
     va_start(args, format);
-    vfprintf(server->log_file, format, args);
+    logger_vlog(server->log, format, args);
     va_end(args);
+}
+
+// Custo das rodadas de agregação dos totais do cluster
+static void dump_aggregate(ElectionServer *server, const char *name, AggregateStats *stats) {
+    uint64_t rounds = atomic_load(&stats->rounds);
+    if (rounds == 0) {
+        return;
+    }
+    write_log(server, "Agregação %s: %llu rodadas, média=%.1f us, máx=%.1f us", name,
+              (unsigned long long)rounds, atomic_load(&stats->total_ns) / 1000.0 / rounds,
+              atomic_load(&stats->max_ns) / 1000.0);
+}
+
+// Registra no log os histogramas de latência de todas as threads
+void dump_latency(ElectionServer *server) {
+    Histogram merged[STAT_COMMANDS];
+    latency_collect(merged);
     
-    fprintf(server->log_file, "\n");
-    fflush(server->log_file);
+    write_log(server, "=== Latência por comando (recv até send, em us) ===");
+    for (int i = 0; i < STAT_COMMANDS; i++) {
+        uint64_t count = atomic_load(&merged[i].total);
+        if (count == 0) {
+            continue;
+        }
+        write_log(server, "%-5s n=%llu média=%.1f p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f máx=%.1f",
+                 latency_command_name(i), (unsigned long long)count,
+                 atomic_load(&merged[i].sum) / 1000.0 / count,
+                 histogram_percentile(&merged[i], 50) / 1000.0,
+                 histogram_percentile(&merged[i], 90) / 1000.0,
+                 histogram_percentile(&merged[i], 99) / 1000.0,
+                 histogram_percentile(&merged[i], 99.9) / 1000.0,
+                 atomic_load(&merged[i].max) / 1000.0);
+    }
+    
+    for (int i = 0; i < server->num_elections; i++) {
+        VoterTable *voters = &server->elections[i]->voters;
+        size_t count = voter_table_count(voters);
+        size_t bytes = voter_table_memory(voters);
+        write_log(server, "Votantes %s: %zu cadastrados, %.1f MB (%.1f bytes por votante)",
+                  server->elections[i]->name, count, bytes / 1048576.0,
+                  count ? (double)bytes / count : 0.0);
+    }
     
-    pthread_mutex_unlock(&server->mutex);
+    for (int i = 0; i < server->num_elections; i++) {
+        Journal *journal = &server->elections[i]->journal;
+        if (!journal->enabled) {
+            continue;
+        }
+        uint64_t records = atomic_load(&journal->records);
+        uint64_t syncs = atomic_load(&journal->syncs);
+        write_log(server, "Journal %s: %llu registros em %llu fsyncs (%.1f por fsync)",
+                  server->elections[i]->name, (unsigned long long)records, (unsigned long long)syncs,
+                  syncs ? (double)records / syncs : 0.0);
+    }
+    
+    if (server->num_shards > 0) {
+        write_log(server, "Conexões transferidas entre shards: %llu",
+                  (unsigned long long)atomic_load(&server->handoffs));
+    }
+    
+    if (server->pool != NULL) {
+        WorkerPoolStats stats;
+        worker_pool_stats(server->pool, &stats);
+        write_log(server, "Pool: %d/%d workers ocupados, fila %zu/%zu (máx %zu), %llu conexões "
+                  "atendidas, %llu recusadas com ERR BUSY", stats.busy, stats.num_workers,
+                  stats.queued, stats.capacity, stats.max_queued,
+                  (unsigned long long)stats.accepted, (unsigned long long)stats.rejected);
+    }
+    
+    if (server->cluster != NULL) {
+        dump_aggregate(server, "TCP (FTALLY)", &server->cluster->tcp_stats);
+        dump_aggregate(server, "MPI (Iallreduce)", &server->cluster->mpi_stats);
+    }
 }
 
-// Busca votante pelo ID
-int find_voter(ElectionServer *server, const char *voter_id) {
-    for (int i = 0; i < server->num_voters; i++) {
-        if (strcmp(server->voters[i].voter_id, voter_id) == 0) {
-            return i;
+// Thread dedicada a sinais: SIGUSR1 grava os histogramas de latência,
+// SIGINT/SIGTERM gravam os histogramas, esvaziam o log e encerram.
+static void *signal_thread(void *arg) {
+    ElectionServer *server = (ElectionServer *)arg;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    
+    while (1) {
+        int sig;
+        if (sigwait(&set, &sig) != 0) {
+            continue;
+        }
+        
+        dump_latency(server);
+        if (sig == SIGUSR1) {
+            continue;
         }
+        
+        LOG_INFO(server, "Sinal %d recebido, encerrando servidor", sig);
+#ifdef WITH_MPI
+        mpi_tally_shutdown();
+#endif
+        // Workers, loops e as threads das eleições continuam rodando até o
+        // exit: os logs e journals param de gravar, mas as filas ficam
+        for (int i = 0; i < server->num_elections; i++) {
+            election_shutdown(server->elections[i]);
+        }
+        logger_stop(&server->logger);
+        exit(0);
     }
-    return -1;
+    return NULL;
 }
 
-// Adiciona novo votante
-int add_voter(ElectionServer *server, const char *voter_id) {
-    if (server->num_voters >= MAX_CLIENTS) {
-        return -1;
+// HELLO recusado: a sessão anterior termina, senão o próximo VOTE sairia
+// com o VOTER_ID antigo. O LSN retido é esperado como numa troca de eleição.
+static void session_reset(Session *session) {
+    if (session->election != NULL) {
+        journal_wait(&session->election->journal, session->durable_lsn);
+        session->durable_lsn = 0;
     }
-    
-    int index = server->num_voters;
-    strncpy(server->voters[index].voter_id, voter_id, MAX_VOTER_ID - 1);
-    server->voters[index].has_voted = false;
-    server->voters[index].voted_option[0] = '\0';
-    server->num_voters++;
-    
-    return index;
+    session->election = NULL;
+    session->watching = false;
+    session->authenticated = false;
+    session->voter_id[0] = '\0';
+    session->voter_hash = 0;
 }
 
-// Registra voto
-bool record_vote(ElectionServer *server, const char *voter_id, int option_index) {
-    pthread_mutex_lock(&server->mutex);
+// HELLO: escolhe a eleição, identifica a sessão e cadastra o votante
+// (comum aos protocolos de texto e binário). Se a eleição não existe ou o
+// VOTER_ID está fora do cadastro, a conexão fica sem sessão.
+HelloResult session_hello(ElectionServer *server, Session *session, const char *voter_id,
+                          const char *election_name) {
+    Election *election = find_election(server, election_name);
+    if (election == NULL) {
+        LOG_INFO(server, "HELLO de %s para eleição desconhecida: %s", voter_id, election_name);
+        session_reset(session);
+        return HELLO_UNKNOWN_ELECTION;
+    }
     
-    int voter_index = find_voter(server, voter_id);
-    if (voter_index == -1) {
-        if (server->num_voters >= MAX_CLIENTS) {
-            pthread_mutex_unlock(&server->mutex);
-            return false;
+    // Cadastro imutável: sem lock, e o filtro recusa quase todos os IDs
+    // desconhecidos sem tocar no índice. ADMIN não precisa estar nele.
+    uint64_t hash = voter_hash(voter_id);
+    if (server->roll != NULL && strcmp(voter_id, "ADMIN") != 0) {
+        RollLookup lookup = roll_lookup(server->roll, voter_id, hash);
+        if (lookup != ROLL_ELIGIBLE) {
+            METRIC_ADD(roll_rejects[lookup], 1);
+            LOG_INFO(server, "HELLO de %s recusado: fora do cadastro de eleitores", voter_id);
+            session_reset(session);
+            return HELLO_NOT_ELIGIBLE;
         }
-        voter_index = server->num_voters;
-        strncpy(server->voters[voter_index].voter_id, voter_id, MAX_VOTER_ID - 1);
-        server->voters[voter_index].has_voted = false;
-        server->voters[voter_index].voted_option[0] = '\0';
-        server->num_voters++;
     }
     
-    if (server->voters[voter_index].has_voted) {
-        pthread_mutex_unlock(&server->mutex);
-        return false;
+    if (session->election != election && session->election != NULL) {
+        // O LSN retido é do journal da eleição anterior: espera ele chegar
+        // ao disco antes de trocar (só numa troca de eleição na mesma
+        // conexão, no máximo uma janela de group commit)
+        journal_wait(&session->election->journal, session->durable_lsn);
+        session->durable_lsn = 0;
+        session->watching = false;
     }
+    session->election = election;
     
-    if (option_index < 0 || option_index >= server->num_options) {
-        pthread_mutex_unlock(&server->mutex);
-        return false;
+    strncpy(session->voter_id, voter_id, MAX_VOTER_ID - 1);
+    session->voter_id[MAX_VOTER_ID - 1] = '\0';
+    session->voter_hash = hash;
+    
+    // No modo cluster o votante só é cadastrado no nó dono
+    if ((election->cluster == NULL || cluster_owns(election->cluster, session->voter_hash)) &&
+        voter_table_register(&election->voters, session->voter_id, session->voter_hash) < 0) {
+        LOG_ERROR(election, "Sem memória para cadastrar votante %s", session->voter_id);
     }
     
-    server->voters[voter_index].has_voted = true;
-    strncpy(server->voters[voter_index].voted_option, 
-            server->options[option_index].name, MAX_OPTION_NAME - 1);
-    server->options[option_index].votes++;
+    session->authenticated = true;
+    LOG_INFO(election, "Cliente autenticado: %s", session->voter_id);
+    return HELLO_OK;
+}
+
+static VoteResult cast_vote(Session *session, int option_index) {
+    Election *election = session->election;
+    LOG_TRACE(election, "Cliente autenticado, verificando eleição");
     
-    char option_name[MAX_OPTION_NAME];
-    strncpy(option_name, server->options[option_index].name, MAX_OPTION_NAME - 1);
-    int total_votes = server->options[option_index].votes;
+    // Verificação rápida: record_vote confere de novo dentro da barreira
+    // do encerramento
+    bool closed = atomic_load(&election->closing);
     
-    pthread_mutex_unlock(&server->mutex);
+    LOG_TRACE(election, "Eleição fechada? %d", closed);
     
-    write_log(server, "Voto registrado: %s -> %s (total: %d votos)", voter_id, option_name, total_votes);
-    return true;
+    if (closed) {
+        return VOTE_CLOSED;
+    }
+    
+    // Votante de outro nó do cluster: o dono verifica e grava o voto
+    if (election->cluster != NULL && !cluster_owns(election->cluster, session->voter_hash)) {
+        return cluster_forward_vote(election->cluster, election, session->voter_id, option_index);
+    }
+    
+    LOG_TRACE(election, "Chamando record_vote");
+    
+    // Registra o voto (inclui a verificação de voto duplicado)
+    uint64_t lsn;
+    VoteResult result = record_vote(election, session->voter_id, session->voter_hash, option_index, &lsn);
+    if (lsn > session->durable_lsn) {
+        session->durable_lsn = lsn;
+    }
+    
+    LOG_DEBUG(election, "Já votou? %d", result == VOTE_DUPLICATE);
+    LOG_DEBUG(election, "Voto registrado? %d", result == VOTE_RECORDED);
+    
+    return result;
 }
 
-// Obtém placar atual
-void get_score(ElectionServer *server, char *buffer, bool final) {
-    pthread_mutex_lock(&server->mutex);
-    
-    if (final) {
-        sprintf(buffer, "%s %d", RESP_CLOSED, server->num_options);
+// VOTE de uma sessão autenticada (comum aos protocolos de texto e binário)
+VoteResult session_vote(Session *session, int option_index) {
+    VoteResult result = cast_vote(session, option_index);
+    METRIC_ADD(votes[result], 1);
+    return result;
+}
+
+// Resposta de texto de um VOTE (terminada em \n)
+void format_vote_response(Election *election, VoteResult result, int option_index, char *response) {
+    if (result == VOTE_RECORDED) {
+        sprintf(response, "%s %s\n", RESP_OK_VOTED, election->options[option_index].name);
+    } else if (result == VOTE_DUPLICATE) {
+        sprintf(response, "%s\n", RESP_ERR_DUPLICATE);
+    } else if (result == VOTE_CLOSED) {
+        sprintf(response, "%s\n", RESP_ERR_CLOSED);
+    } else if (result == VOTE_UNAVAILABLE) {
+        sprintf(response, "%s\n", RESP_ERR_UNAVAILABLE);
     } else {
-        sprintf(buffer, "%s %d", RESP_SCORE, server->num_options);
+        sprintf(response, "%s\n", RESP_ERR_INVALID);
     }
+}
+
+// Processa um comando do protocolo e escreve a resposta (terminada em \n).
+// Compartilhado entre o modo thread-por-conexão e o modo event loop.
+SessionAction process_command(ElectionServer *server, Session *session, char *command, char *response) {
+    response[0] = '\0';
+    session->last_command = STAT_NONE;
+    
+    // Remove newline
+    command[strcspn(command, "\n\r")] = 0;
+    
+    LOG_INFO(server, "Recebido de %s: %s", 
+             session->authenticated ? session->voter_id : "não autenticado", command);
     
-    for (int i = 0; i < server->num_options; i++) {
-        char temp[256];
-        sprintf(temp, "|%s:%d", server->options[i].name, server->options[i].votes);
-        strcat(buffer, temp);
+    // Conexão de outro nó: só comandos entre nós
+    if (session->peer && server->cluster != NULL) {
+        METRIC_ADD(commands[METRIC_PEER], 1);
+        return cluster_peer_command(server->cluster, session, command, response);
     }
     
-    pthread_mutex_unlock(&server->mutex);
+    // HELLO <VOTER_ID> [ELEICAO]
+    if (strncmp(command, CMD_HELLO, strlen(CMD_HELLO)) == 0) {
+        session->last_command = STAT_HELLO;
+        METRIC_ADD(commands[METRIC_HELLO], 1);
+        char voter_id[MAX_VOTER_ID] = {0};
+        char election_name[MAX_ELECTION_NAME] = {0};
+        sscanf(command, "HELLO %63s %31s", voter_id, election_name);
+        
+        HelloResult result = session_hello(server, session, voter_id, election_name);
+        if (result != HELLO_OK) {
+            sprintf(response, "%s\n", result == HELLO_NOT_ELIGIBLE ? RESP_ERR_NOT_ELIGIBLE
+                                                                   : RESP_ERR_UNKNOWN_ELECTION);
+            return SESSION_CONTINUE;
+        }
+        sprintf(response, "%s %s\n", RESP_WELCOME, session->voter_id);
+    }
+    // LIST
+    else if (strcmp(command, CMD_LIST) == 0) {
+        session->last_command = STAT_LIST;
+        METRIC_ADD(commands[METRIC_LIST], 1);
+        if (!session->authenticated) {
+            sprintf(response, "ERR NOT_AUTHENTICATED\n");
+            return SESSION_CONTINUE;
+        }
+        
+        // Resposta montada uma vez ao abrir a eleição
+        size_t len = response_cache_options(&session->election->responses, false, response);
+        response[len] = '\0';
+        
+        LOG_DEBUG(server, "Lista enviada (%zu bytes)", strlen(response));
+    }
+    // VOTE <OPTION>
+    else if (strncmp(command, CMD_VOTE, strlen(CMD_VOTE)) == 0) {
+        session->last_command = STAT_VOTE;
+        METRIC_ADD(commands[METRIC_VOTE], 1);
+        LOG_TRACE(server, "Processando comando VOTE");
+        
+        if (!session->authenticated) {
+            sprintf(response, "ERR NOT_AUTHENTICATED\n");
+            return SESSION_CONTINUE;
+        }
+        
+        int option_num = 0;
+        sscanf(command, "VOTE %d", &option_num);
+        int option_index = option_num - 1;
+        
+        LOG_DEBUG(server, "Opção escolhida: %d (index %d)", option_num, option_index);
+        
+        VoteResult result = session_vote(session, option_index);
+        format_vote_response(session->election, result, option_index, response);
+        
+        LOG_DEBUG(server, "Enviando resposta: %s", response);
+    }
+    // SCORE
+    else if (strcmp(command, CMD_SCORE) == 0) {
+        session->last_command = STAT_SCORE;
+        METRIC_ADD(commands[METRIC_SCORE], 1);
+        if (!session->authenticated) {
+            sprintf(response, "ERR NOT_AUTHENTICATED\n");
+            return SESSION_CONTINUE;
+        }
+        
+        size_t len = get_score(session->election, response, false);
+        response[len] = '\0';
+    }
+    // WATCH / UNWATCH
+    else if (strcmp(command, CMD_WATCH) == 0 || strcmp(command, CMD_UNWATCH) == 0) {
+        METRIC_ADD(commands[METRIC_WATCH], 1);
+        if (!session->authenticated) {
+            sprintf(response, "ERR NOT_AUTHENTICATED\n");
+            return SESSION_CONTINUE;
+        }
+        
+        // A confirmação vem com o placar atual; as mudanças seguintes são
+        // enviadas pelo dono da conexão, sem pedido
+        session->watching = strcmp(command, CMD_WATCH) == 0;
+        if (session->watching) {
+            size_t len = sprintf(response, "%s\n", RESP_WATCHING);
+            len += get_score(session->election, response + len, false);
+            response[len] = '\0';
+        } else {
+            sprintf(response, "%s\n", RESP_UNWATCHED);
+        }
+        LOG_INFO(server, "Cliente %s %s o placar", session->voter_id,
+                 session->watching ? "assinou" : "cancelou a assinatura do");
+    }
+    // ADMIN STATS
+    else if (strcmp(command, CMD_ADMIN_STATS) == 0) {
+        METRIC_ADD(commands[METRIC_ADMIN], 1);
+        if (!session->authenticated || strcmp(session->voter_id, "ADMIN") != 0) {
+            sprintf(response, "ERR NOT_AUTHORIZED\n");
+            return SESSION_CONTINUE;
+        }
+        metrics_format_line(response, MAX_BUFFER);
+    }
+    // ADMIN EXPORT
+    else if (strcmp(command, CMD_ADMIN_EXPORT) == 0) {
+        METRIC_ADD(commands[METRIC_ADMIN], 1);
+        if (!session->authenticated || strcmp(session->voter_id, "ADMIN") != 0) {
+            sprintf(response, "ERR NOT_AUTHORIZED\n");
+            return SESSION_CONTINUE;
+        }
+        
+        // Só o retrato é tirado aqui; a gravação segue numa thread própria
+        if (export_election(session->election) < 0) {
+            LOG_ERROR(server, "Sem memória para exportar a eleição %s", session->election->name);
+            sprintf(response, "ERR NO_MEMORY\n");
+            return SESSION_CONTINUE;
+        }
+        sprintf(response, "%s %s\n", RESP_OK_EXPORTING, session->election->export_base);
+        LOG_INFO(server, "Exportação da eleição %s iniciada", session->election->name);
+    }
+    // ADMIN CLOSE
+    else if (strncmp(command, CMD_ADMIN_CLOSE, strlen(CMD_ADMIN_CLOSE)) == 0) {
+        METRIC_ADD(commands[METRIC_ADMIN], 1);
+        LOG_INFO(server, "Comando ADMIN CLOSE reconhecido");
+        
+        if (!session->authenticated || strcmp(session->voter_id, "ADMIN") != 0) {
+            LOG_INFO(server, "Acesso negado: authenticated=%d, voter_id=%s", 
+                     session->authenticated, session->voter_id);
+            sprintf(response, "ERR NOT_AUTHORIZED\n");
+            return SESSION_CONTINUE;
+        }
+        
+        LOG_INFO(server, "Encerrando eleição %s...", session->election->name);
+        if (server->cluster == NULL) {
+            close_election(session->election);
+        } else if (!cluster_close(server->cluster, session->election)) {
+            // Encerrada, mas o resultado somado ficou sem algum nó
+            sprintf(response, "%s\n", RESP_ERR_UNAVAILABLE);
+            return SESSION_CONTINUE;
+        }
+        sprintf(response, "OK ELECTION_CLOSED\n");
+        LOG_DEBUG(server, "Resposta enviada: OK ELECTION_CLOSED");
+    }
+    // BYE
+    else if (strcmp(command, CMD_BYE) == 0) {
+        METRIC_ADD(commands[METRIC_BYE], 1);
+        sprintf(response, "%s\n", RESP_BYE);
+        LOG_INFO(server, "Cliente %s encerrou sessão", session->voter_id);
+        return SESSION_CLOSE;
+    }
+    else {
+        METRIC_ADD(commands[METRIC_UNKNOWN], 1);
+        sprintf(response, "ERR UNKNOWN_COMMAND\n");
+    }
+    
+    return SESSION_CONTINUE;
 }
 
-// Encerra eleição
-void close_election(ElectionServer *server) {
-    pthread_mutex_lock(&server->mutex);
-    server->election_closed = true;
-    pthread_mutex_unlock(&server->mutex);
-    
-    write_log(server, "Eleição encerrada por comando administrativo");
-    save_final_results(server);
+// Escreve um quadro BIN_ERROR e retorna seu tamanho
+static size_t binary_error(uint8_t *response, uint8_t code) {
+    bin_put_header(response, BIN_ERROR, 0, 1);
+    response[BIN_HEADER_SIZE] = code;
+    return BIN_HEADER_SIZE + 1;
 }
 
-// Salva resultados finais
-void save_final_results(ElectionServer *server) {
-    FILE *file = fopen("logs/resultado_final.txt", "w");
-    if (file == NULL) {
-        return;
+static MetricCommand binary_metric(uint8_t type) {
+    switch (type) {
+        case BIN_HELLO: return METRIC_HELLO;
+        case BIN_LIST: return METRIC_LIST;
+        case BIN_VOTE: return METRIC_VOTE;
+        case BIN_SCORE: return METRIC_SCORE;
+        case BIN_WATCH: return METRIC_WATCH;
+        case BIN_BYE: return METRIC_BYE;
+        default: return METRIC_UNKNOWN;
     }
+}
+
+// Processa um quadro do protocolo binário (cabeçalho + payload completos)
+// e escreve o quadro de resposta em response (até server->max_response bytes).
+SessionAction process_binary_frame(ElectionServer *server, Session *session, const uint8_t *frame,
+                                   size_t frame_len, uint8_t *response, size_t *response_len) {
+    uint8_t type = frame[0];
+    const uint8_t *payload = frame + BIN_HEADER_SIZE;
+    size_t payload_len = frame_len - BIN_HEADER_SIZE;
+    uint8_t *out = response + BIN_HEADER_SIZE;
     
-    pthread_mutex_lock(&server->mutex);
+    session->last_command = STAT_NONE;
+    METRIC_ADD(commands[binary_metric(type)], 1);
     
-    fprintf(file, "===========================================\n");
-    fprintf(file, "    RESULTADO FINAL DA VOTAÇÃO\n");
-    fprintf(file, "===========================================\n\n");
+    if (type == BIN_HELLO) {
+        session->last_command = STAT_HELLO;
+        // O nome da eleição, opcional, ocupa o resto do payload
+        if (payload_len < 9 || payload_len > 9 + MAX_ELECTION_NAME - 1 || payload[0] != BIN_VERSION) {
+            *response_len = binary_error(response, BIN_ERR_BAD_FRAME);
+            return SESSION_CLOSE;
+        }
+        uint64_t numeric_id = bin_get_u64(payload + 1);
+        char voter_id[MAX_VOTER_ID];
+        snprintf(voter_id, sizeof(voter_id), "%llu", (unsigned long long)numeric_id);
+        char election_name[MAX_ELECTION_NAME];
+        memcpy(election_name, payload + 9, payload_len - 9);
+        election_name[payload_len - 9] = '\0';
+        
+        LOG_INFO(server, "Recebido de %s: HELLO %s %s", 
+                 session->authenticated ? session->voter_id : "não autenticado", voter_id, election_name);
+        HelloResult result = session_hello(server, session, voter_id, election_name);
+        if (result != HELLO_OK) {
+            *response_len = binary_error(response, result == HELLO_NOT_ELIGIBLE ? BIN_ERR_NOT_ELIGIBLE
+                                                                                : BIN_ERR_UNKNOWN_ELECTION);
+            return SESSION_CONTINUE;
+        }
+        
+        bin_put_u64(out, numeric_id);
+        bin_put_header(response, BIN_WELCOME, 0, 8);
+        *response_len = BIN_HEADER_SIZE + 8;
+        return SESSION_CONTINUE;
+    }
     
-    time_t now;
-    time(&now);
-    fprintf(file, "Data: %s\n", ctime(&now));
+    if (type == BIN_BYE) {
+        LOG_INFO(server, "Recebido de %s: BYE", 
+                 session->authenticated ? session->voter_id : "não autenticado");
+        LOG_INFO(server, "Cliente %s encerrou sessão", session->voter_id);
+        bin_put_header(response, BIN_BYE_RESP, 0, 0);
+        *response_len = BIN_HEADER_SIZE;
+        return SESSION_CLOSE;
+    }
     
-    int total_votes = 0;
-    for (int i = 0; i < server->num_options; i++) {
-        total_votes += server->options[i].votes;
+    if (type != BIN_LIST && type != BIN_VOTE && type != BIN_SCORE && type != BIN_WATCH) {
+        *response_len = binary_error(response, BIN_ERR_UNKNOWN_COMMAND);
+        return SESSION_CONTINUE;
     }
     
-    fprintf(file, "Total de votos: %d\n", total_votes);
-    fprintf(file, "Total de votantes registrados: %d\n\n", server->num_voters);
+    session->last_command = type == BIN_LIST ? STAT_LIST : type == BIN_VOTE ? STAT_VOTE :
+                            type == BIN_SCORE ? STAT_SCORE : STAT_NONE;
+    if (!session->authenticated) {
+        *response_len = binary_error(response, BIN_ERR_NOT_AUTHENTICATED);
+        return SESSION_CONTINUE;
+    }
     
-    fprintf(file, "-------------------------------------------\n");
-    fprintf(file, "Opção                              Votos  %%\n");
-    fprintf(file, "-------------------------------------------\n");
+    if (type == BIN_LIST) {
+        LOG_INFO(server, "Recebido de %s: LIST", session->voter_id);
+        *response_len = response_cache_options(&session->election->responses, true, response);
+    } else if (type == BIN_VOTE) {
+        uint64_t option_index;
+        if (bin_get_varint(payload, payload_len, &option_index) == 0) {
+            *response_len = binary_error(response, BIN_ERR_BAD_FRAME);
+            return SESSION_CONTINUE;
+        }
+        LOG_INFO(server, "Recebido de %s: VOTE %llu", session->voter_id,
+                 (unsigned long long)option_index + 1);
+        
+        int index = option_index < (uint64_t)session->election->num_options ? (int)option_index : -1;
+        VoteResult result = session_vote(session, index);
+        
+        if (result == VOTE_RECORDED) {
+            size_t len = bin_put_varint(out, option_index);
+            bin_put_header(response, BIN_VOTED, 0, (uint16_t)len);
+            *response_len = BIN_HEADER_SIZE + len;
+        } else if (result == VOTE_DUPLICATE) {
+            *response_len = binary_error(response, BIN_ERR_DUPLICATE);
+        } else if (result == VOTE_CLOSED) {
+            *response_len = binary_error(response, BIN_ERR_CLOSED);
+        } else if (result == VOTE_UNAVAILABLE) {
+            *response_len = binary_error(response, BIN_ERR_UNAVAILABLE);
+        } else {
+            *response_len = binary_error(response, BIN_ERR_INVALID_OPTION);
+        }
+    } else if (type == BIN_WATCH) {
+        session->watching = payload_len > 0 && payload[0] != 0;
+        LOG_INFO(server, "Recebido de %s: %s", session->voter_id, session->watching ? CMD_WATCH : CMD_UNWATCH);
+        
+        // Como no texto, a confirmação vem com o placar atual
+        out[0] = session->watching;
+        bin_put_header(response, BIN_WATCH_RESP, 0, 1);
+        *response_len = BIN_HEADER_SIZE + 1;
+        if (session->watching) {
+            *response_len += get_score(session->election, response + *response_len, true);
+        }
+    } else {
+        LOG_INFO(server, "Recebido de %s: SCORE", session->voter_id);
+        *response_len = get_score(session->election, response, true);
+    }
     
-    for (int i = 0; i < server->num_options; i++) {
-        double percentage = total_votes > 0 ? 
-            (server->options[i].votes * 100.0 / total_votes) : 0.0;
-        fprintf(file, "%-35s %5d %6.2f%%\n", 
-                server->options[i].name, 
-                server->options[i].votes,
-                percentage);
+    return SESSION_CONTINUE;
+}
+
+// Envia todas as respostas pendentes (socket bloqueante). Retorna false
+// se a conexão caiu.
+static bool send_pending(Connection *conn) {
+    // Votos só são confirmados depois de gravados no journal
+    if (conn->session.election != NULL) {
+        journal_wait(&conn->session.election->journal, conn->session.durable_lsn);
     }
     
-    fprintf(file, "-------------------------------------------\n");
+    while (conn->out_sent < conn->out_len) {
+        ssize_t sent = send(conn->fd, conn->out + conn->out_sent,
+                            conn->out_len - conn->out_sent, MSG_NOSIGNAL);
+        METRIC_ADD(io_syscalls, 1);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        conn->out_sent += sent;
+        METRIC_ADD(bytes_out, sent);
+    }
+    connection_record_latencies(conn);
+    connection_compact_output(conn);
+    return true;
+}
+
+// Liga, desliga ou troca de eleição o aviso de atualizações do placar
+// depois de WATCH/UNWATCH/HELLO (modo thread-por-conexão)
+static void update_watch(ElectionServer *server, Connection *conn) {
+    Election *election = conn->session.watching ? conn->session.election : NULL;
+    if (election == conn->watch_election) {
+        return;
+    }
+    if (conn->watch_election != NULL) {
+        watch_remove_notify(&conn->watch_election->watch, conn->watch_fd);
+        watch_unsubscribe(&conn->watch_election->watch);
+        close(conn->watch_fd);
+        conn->watch_fd = -1;
+        conn->watch_election = NULL;
+    }
+    if (election == NULL) {
+        return;
+    }
     
-    pthread_mutex_unlock(&server->mutex);
+    conn->watch_fd = eventfd(0, EFD_NONBLOCK);
+    if (conn->watch_fd < 0 || watch_add_notify(&election->watch, conn->watch_fd) < 0) {
+        LOG_ERROR(server, "Sem recursos para o WATCH de %s", conn->session.voter_id);
+        if (conn->watch_fd >= 0) {
+            close(conn->watch_fd);
+            conn->watch_fd = -1;
+        }
+        conn->session.watching = false;
+        return;
+    }
+    // A resposta do WATCH já trouxe o placar atual
+    conn->watch_seq = watch_seq(&election->watch);
+    conn->watch_election = election;
+    watch_subscribe(&election->watch);
+}
+
+// Envia a última atualização do placar, se ainda não foi enviada. Retorna
+// false se a conexão caiu.
+static bool push_update(Connection *conn) {
+    uint64_t value;
+    METRIC_ADD(io_syscalls, 1);
+    if (read(conn->watch_fd, &value, sizeof(value)) < 0) {
+        return true;
+    }
+    WatchUpdate *update = watch_acquire(&conn->watch_election->watch);
+    if (update == NULL) {
+        return true;
+    }
     
-    fclose(file);
-    write_log(server, "Resultado final salvo em logs/resultado_final.txt");
+    bool ok = true;
+    if (update->seq > conn->watch_seq) {
+        size_t len;
+        const char *data = watch_update_data(update, conn->mode == PROTOCOL_BINARY, &len);
+        conn->watch_seq = update->seq;
+        ok = connection_append_output(conn, data, len) && send_pending(conn);
+    }
+    watch_release(update);
+    return ok;
+}
+
+// Roda de timers do modo thread. As conexões vivem nas pilhas das suas
+// threads; a roda e os timers embutidos nelas só mudam com o lock.
+static TimerWheel thread_timers;
+static pthread_mutex_t thread_timers_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool thread_timers_enabled;
+
+// Já despejada, a conexão fica com o timer do prazo extra
+static void arm_thread_timer(Connection *conn) {
+    pthread_mutex_lock(&thread_timers_lock);
+    if (atomic_load(&conn->timed_out) == TIMEOUT_NONE) {
+        connection_arm_timer(&thread_timers, conn);
+    }
+    pthread_mutex_unlock(&thread_timers_lock);
+}
+
+// Timer vencido (com o lock). A thread da conexão está presa no recv: o
+// SHUT_RD a acorda para enviar o ERR TIMEOUT; se depois do prazo extra ela
+// ainda não terminou (cliente que não lê), o SHUT_RDWR solta o send.
+static void expire_thread_connection(TimerEntry *entry, void *arg) {
+    uint64_t now = *(uint64_t *)arg;
+    Connection *conn = timer_connection(entry);
+    if (atomic_load(&conn->timed_out) != TIMEOUT_NONE) {
+        shutdown(conn->fd, SHUT_RDWR);
+        return;
+    }
+    TimeoutReason reason = connection_timer_expired(&thread_timers, conn, now);
+    if (reason == TIMEOUT_NONE) {
+        return;
+    }
+    atomic_store(&conn->timed_out, reason);
+    METRIC_ADD(evictions[reason], 1);
+    shutdown(conn->fd, SHUT_RD);
+    timer_wheel_schedule(&thread_timers, &conn->timer, thread_timers.now + TIMEOUT_GRACE_TICKS);
+}
+
+static void *timer_thread(void *arg) {
+    (void)arg;
+    struct timespec tick = {0, TIMER_TICK_NS};
+    while (1) {
+        nanosleep(&tick, NULL);
+        pthread_mutex_lock(&thread_timers_lock);
+        uint64_t now = monotonic_ns();
+        timer_wheel_advance(&thread_timers, now / TIMER_TICK_NS, expire_thread_connection, &now);
+        pthread_mutex_unlock(&thread_timers_lock);
+    }
+    return NULL;
+}
+
+// Liga a roda do modo thread, se algum prazo foi configurado
+static void start_thread_timers(ElectionServer *server) {
+    if (server->handshake_timeout_ns == 0 && server->idle_timeout_ns == 0 &&
+        server->session_timeout_ns == 0) {
+        return;
+    }
+    timer_wheel_init(&thread_timers, monotonic_ns() / TIMER_TICK_NS);
+    pthread_t thread_id;
+    if (pthread_create(&thread_id, NULL, timer_thread, NULL) != 0) {
+        perror("Erro ao criar thread dos prazos");
+        exit(1);
+    }
+    pthread_detach(thread_id);
+    thread_timers_enabled = true;
 }
 
-// Manipula conexão do cliente
+// Manipula conexão do cliente (modo thread-por-conexão). Cada recv pode
+// trazer vários comandos (pipelining) ou só parte de um; as respostas de
+// todos os comandos completos saem num único send.
 void *handle_client(void *arg) {
     ClientData *client_data = (ClientData *)arg;
-    int client_socket = client_data->socket;
     ElectionServer *server = client_data->server;
-    char buffer[MAX_BUFFER];
-    char voter_id[MAX_VOTER_ID] = {0};
-    bool authenticated = false;
+    Connection conn;
+    connection_init(&conn, client_data->socket);
+    conn.session.peer = client_data->peer;
     
-    write_log(server, "Nova conexão estabelecida (socket %d)", client_socket);
+    LOG_INFO(server, "Nova conexão estabelecida (socket %d)", conn.fd);
+    if (thread_timers_enabled && connection_update_deadline(server, &conn)) {
+        arm_thread_timer(&conn);
+    }
     
-    while (1) {
-        memset(buffer, 0, MAX_BUFFER);
-        int bytes_read = recv(client_socket, buffer, MAX_BUFFER - 1, 0);
+    while (!conn.closing) {
+        // Assinantes esperam também o aviso de nova atualização do placar
+        if (conn.watch_election != NULL) {
+            struct pollfd fds[2] = {{conn.fd, POLLIN, 0}, {conn.watch_fd, POLLIN, 0}};
+            METRIC_ADD(io_syscalls, 1);
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            if ((fds[1].revents & POLLIN) && !push_update(&conn)) {
+                break;
+            }
+            if (fds[0].revents == 0) {
+                continue;
+            }
+        }
         
+        int bytes_read = recv(conn.fd, conn.in + conn.in_len, connection_input_space(&conn), 0);
+        METRIC_ADD(io_syscalls, 1);
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
         if (bytes_read <= 0) {
-            write_log(server, "Cliente %s desconectado (socket %d)", 
-                     authenticated ? voter_id : "não autenticado", client_socket);
+            if (atomic_load(&conn.timed_out) == TIMEOUT_NONE) {
+                LOG_INFO(server, "Cliente %s desconectado (socket %d)", 
+                         conn.session.authenticated ? conn.session.voter_id : "não autenticado", conn.fd);
+            }
             break;
         }
         
-        // Remove newline
-        buffer[strcspn(buffer, "\n\r")] = 0;
-        
-        write_log(server, "Recebido de %s: %s", 
-                 authenticated ? voter_id : "não autenticado", buffer);
+        conn.last_recv = monotonic_ns();
+        conn.in_len += bytes_read;
+        METRIC_ADD(bytes_in, bytes_read);
         
-        // HELLO <VOTER_ID>
-        if (strncmp(buffer, CMD_HELLO, strlen(CMD_HELLO)) == 0) {
-            sscanf(buffer, "HELLO %s", voter_id);
-            
-            pthread_mutex_lock(&server->mutex);
-            int voter_index = find_voter(server, voter_id);
-            if (voter_index == -1) {
-                add_voter(server, voter_id);
-            }
-            pthread_mutex_unlock(&server->mutex);
-            
-            authenticated = true;
-            sprintf(buffer, "%s %s\n", RESP_WELCOME, voter_id);
-            send(client_socket, buffer, strlen(buffer), 0);
-            write_log(server, "Cliente autenticado: %s", voter_id);
-        }
-        // LIST
-        else if (strcmp(buffer, CMD_LIST) == 0) {
-            if (!authenticated) {
-                sprintf(buffer, "ERR NOT_AUTHENTICATED\n");
-                send(client_socket, buffer, strlen(buffer), 0);
-                continue;
+        // Repete enquanto o limite de saída deixar comandos no buffer
+        do {
+            connection_process_input(server, &conn);
+            if (!send_pending(&conn)) {
+                conn.closing = true;
+                break;
             }
-            
-            pthread_mutex_lock(&server->mutex);
-            sprintf(buffer, "%s %d", RESP_OPTIONS, server->num_options);
-            for (int i = 0; i < server->num_options; i++) {
-                char temp[256];
-                sprintf(temp, "|%s", server->options[i].name);
-                strcat(buffer, temp);
-            }
-            strcat(buffer, "\n");
-            pthread_mutex_unlock(&server->mutex);
-            
-            int sent = send(client_socket, buffer, strlen(buffer), 0);
-            write_log(server, "Lista enviada (%d bytes)", sent);
-        }
-        // VOTE <OPTION>
-        else if (strncmp(buffer, CMD_VOTE, strlen(CMD_VOTE)) == 0) {
-            write_log(server, "Processando comando VOTE");
-            
-            if (!authenticated) {
-                sprintf(buffer, "ERR NOT_AUTHENTICATED\n");
-                send(client_socket, buffer, strlen(buffer), 0);
-                continue;
-            }
-            
-            write_log(server, "Cliente autenticado, verificando eleição");
-            
-            pthread_mutex_lock(&server->mutex);
-            bool closed = server->election_closed;
-            pthread_mutex_unlock(&server->mutex);
-            
-            write_log(server, "Eleição fechada? %d", closed);
-            
-            if (closed) {
-                sprintf(buffer, "%s\n", RESP_ERR_CLOSED);
-                send(client_socket, buffer, strlen(buffer), 0);
-                continue;
-            }
-            
-            int option_num;
-            sscanf(buffer, "VOTE %d", &option_num);
-            int option_index = option_num - 1;
-            
-            write_log(server, "Opção escolhida: %d (index %d)", option_num, option_index);
-            
-            // Verifica se já votou
-            pthread_mutex_lock(&server->mutex);
-            int voter_index = find_voter(server, voter_id);
-            bool has_voted = (voter_index != -1 && server->voters[voter_index].has_voted);
-            pthread_mutex_unlock(&server->mutex);
-            
-            write_log(server, "Já votou? %d", has_voted);
-            
-            if (has_voted) {
-                sprintf(buffer, "%s\n", RESP_ERR_DUPLICATE);
-                send(client_socket, buffer, strlen(buffer), 0);
-                continue;
-            }
-            
-            write_log(server, "Chamando record_vote");
-            
-            // Registra o voto
-            bool vote_recorded = record_vote(server, voter_id, option_index);
-            
-            write_log(server, "Voto registrado? %d", vote_recorded);
-            
-            if (vote_recorded) {
-                pthread_mutex_lock(&server->mutex);
-                char option_name[MAX_OPTION_NAME];
-                strncpy(option_name, server->options[option_index].name, MAX_OPTION_NAME - 1);
-                option_name[MAX_OPTION_NAME - 1] = '\0';
-                pthread_mutex_unlock(&server->mutex);
-                
-                sprintf(buffer, "%s %s\n", RESP_OK_VOTED, option_name);
-            } else {
-                sprintf(buffer, "%s\n", RESP_ERR_INVALID);
-            }
-            
-            write_log(server, "Enviando resposta: %s", buffer);
-            int sent = send(client_socket, buffer, strlen(buffer), 0);
-            write_log(server, "Resposta enviada (%d bytes)", sent);
-        }
-        // SCORE
-        else if (strcmp(buffer, CMD_SCORE) == 0) {
-            if (!authenticated) {
-                sprintf(buffer, "ERR NOT_AUTHENTICATED\n");
-                send(client_socket, buffer, strlen(buffer), 0);
-                continue;
-            }
-            
-            pthread_mutex_lock(&server->mutex);
-            bool closed = server->election_closed;
-            pthread_mutex_unlock(&server->mutex);
-            
-            get_score(server, buffer, closed);
-            strcat(buffer, "\n");
-            send(client_socket, buffer, strlen(buffer), 0);
-        }
-        // ADMIN CLOSE
-        else if (strncmp(buffer, CMD_ADMIN_CLOSE, strlen(CMD_ADMIN_CLOSE)) == 0) {
-            write_log(server, "Comando ADMIN CLOSE reconhecido");
-            
-            if (!authenticated || strcmp(voter_id, "ADMIN") != 0) {
-                write_log(server, "Acesso negado: authenticated=%d, voter_id=%s", authenticated, voter_id);
-                sprintf(buffer, "ERR NOT_AUTHORIZED\n");
-                send(client_socket, buffer, strlen(buffer), 0);
-                continue;
-            }
-            
-            write_log(server, "Encerrando eleição...");
-            close_election(server);
-            sprintf(buffer, "OK ELECTION_CLOSED\n");
-            send(client_socket, buffer, strlen(buffer), 0);
-            write_log(server, "Resposta enviada: OK ELECTION_CLOSED");
-        }
-        // BYE
-        else if (strcmp(buffer, CMD_BYE) == 0) {
-            sprintf(buffer, "%s\n", RESP_BYE);
-            send(client_socket, buffer, strlen(buffer), 0);
-            write_log(server, "Cliente %s encerrou sessão", voter_id);
-            break;
+            update_watch(server, &conn);
+        } while (!conn.closing && connection_has_command(&conn));
+        
+        if (thread_timers_enabled && connection_update_deadline(server, &conn)) {
+            arm_thread_timer(&conn);
         }
-        else {
-            sprintf(buffer, "ERR UNKNOWN_COMMAND\n");
-            send(client_socket, buffer, strlen(buffer), 0);
+    }
+    
+    TimeoutReason reason = atomic_load(&conn.timed_out);
+    if (reason != TIMEOUT_NONE) {
+        LOG_INFO(server, "Conexão de %s fechada por prazo vencido (%s, socket %d)",
+                 conn.session.authenticated ? conn.session.voter_id : "não autenticado",
+                 timeout_reason_name(reason), conn.fd);
+        if (connection_append_timeout(&conn)) {
+            send_pending(&conn);
         }
     }
+    if (thread_timers_enabled) {
+        pthread_mutex_lock(&thread_timers_lock);
+        timer_wheel_cancel(&thread_timers, &conn.timer);
+        pthread_mutex_unlock(&thread_timers_lock);
+    }
     
-    close(client_socket);
+    conn.session.watching = false;
+    update_watch(server, &conn);
+    close(conn.fd);
+    connection_free(&conn);
     free(client_data);
     return NULL;
 }
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Uso: %s <porta>\n", argv[0]);
-        exit(1);
-    }
-    
-    int port = atoi(argv[1]);
-    
-    ElectionServer server;
-    init_server(&server);
-    load_options(&server, "opcoes.txt");
-    
-    // Cria socket
+// Cria o socket de escuta TCP na porta indicada. Com reuse_port vários
+// sockets escutam a mesma porta e o kernel reparte as conexões entre eles.
+int create_listen_socket(int port, int backlog, bool reuse_port) {
     int server_socket = socket(AF_INET, SOCK_STREAM, 0);
     if (server_socket == -1) {
         perror("Erro ao criar socket");
@@ -425,9 +924,14 @@ int main(int argc, char *argv[]) {
     // Permite reutilizar porta
     int opt = 1;
     setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (reuse_port && setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("Erro no SO_REUSEPORT");
+        exit(1);
+    }
     
     // Configura endereço
     struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
     server_addr.sin_port = htons(port);
@@ -439,45 +943,406 @@ int main(int argc, char *argv[]) {
     }
     
     // Listen
-    if (listen(server_socket, 20) < 0) {
+    if (listen(server_socket, backlog) < 0) {
         perror("Erro no listen");
         exit(1);
     }
     
-    printf("Servidor de votação iniciado na porta %d\n", port);
-    printf("Aguardando conexões...\n");
-    write_log(&server, "Servidor aguardando conexões na porta %d", port);
-    
-    // Loop principal
+    return server_socket;
+}
+
+// Recusa uma conexão que não pode ser atendida agora: responde ERR BUSY e
+// fecha. O protocolo da conexão só é conhecido se o primeiro byte já
+// chegou; sem ele a recusa vai em texto.
+static void reject_busy(ElectionServer *server, int client_socket) {
+    unsigned char first;
+    if (recv(client_socket, &first, 1, MSG_PEEK | MSG_DONTWAIT) == 1 && first >= 0x80) {
+        uint8_t frame[BIN_HEADER_SIZE + 1];
+        bin_put_header(frame, BIN_ERROR, 0, 1);
+        frame[BIN_HEADER_SIZE] = BIN_ERR_BUSY;
+        send(client_socket, frame, sizeof(frame), MSG_NOSIGNAL | MSG_DONTWAIT);
+    } else {
+        send(client_socket, RESP_ERR_BUSY "\n", strlen(RESP_ERR_BUSY) + 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+    }
+    close(client_socket);
+    METRIC_ADD(connections_busy, 1);
+    LOG_DEBUG(server, "Conexão recusada com ERR BUSY (socket %d)", client_socket);
+}
+
+// Loop principal do modo thread: uma thread por conexão ou, com pool, uma
+// fila limitada de conexões esperando um worker
+static void accept_loop(ElectionServer *server, int server_socket) {
     while (1) {
         struct sockaddr_in client_addr;
         socklen_t client_len = sizeof(client_addr);
         
         int client_socket = accept(server_socket, (struct sockaddr *)&client_addr, &client_len);
+        METRIC_ADD(io_syscalls, 1);
         if (client_socket < 0) {
             perror("Erro no accept");
             continue;
         }
         
-        // Cria thread para cliente
         ClientData *client_data = malloc(sizeof(ClientData));
+        if (client_data == NULL) {
+            reject_busy(server, client_socket);
+            continue;
+        }
         client_data->socket = client_socket;
-        client_data->server = &server;
+        client_data->server = server;
+        client_data->peer = false;
         
+        if (server->pool != NULL) {
+            if (!worker_pool_submit(server->pool, client_data)) {
+                reject_busy(server, client_socket);
+                free(client_data);
+            }
+            continue;
+        }
+        
+        // Cria thread para cliente
         pthread_t thread_id;
         if (pthread_create(&thread_id, NULL, handle_client, client_data) != 0) {
             perror("Erro ao criar thread");
-            close(client_socket);
+            reject_busy(server, client_socket);
             free(client_data);
             continue;
         }
         
         pthread_detach(thread_id);
     }
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Uso: %s [opções] <porta>\n", prog);
+    fprintf(stderr, "  --event-loop     Usa epoll não bloqueante em vez de uma thread por conexão\n");
+    fprintf(stderr, "  --loops <n>      Número de event loops (padrão: um por núcleo)\n");
+    fprintf(stderr, "  --shards         Event loops com socket SO_REUSEPORT próprio, cada um dono de\n");
+    fprintf(stderr, "                   uma partição dos votantes (implica --event-loop)\n");
+    fprintf(stderr, "  --io-uring       Event loops sobre io_uring em vez de epoll, se o kernel suportar\n");
+    fprintf(stderr, "                   (implica --event-loop; sem suporte, ou com --shards, usa epoll)\n");
+    fprintf(stderr, "  --workers <n>    Modo thread com pool fixo de n workers (padrão: uma thread por conexão)\n");
+    fprintf(stderr, "  --queue-depth <n> Conexões esperando um worker antes do ERR BUSY (padrão: %d)\n",
+            DEFAULT_QUEUE_DEPTH);
+    fprintf(stderr, "  --log-buffer <n> Capacidade do buffer de log em mensagens (padrão: %d)\n", LOG_DEFAULT_CAPACITY);
+    fprintf(stderr, "  --log-full <p>   Política com buffer de log cheio: drop, block ou count (padrão)\n");
+    fprintf(stderr, "  --log-level <n>  Nível de log: error, info (padrão), debug ou trace\n");
+    fprintf(stderr, "  --score-interval <ms> Intervalo mínimo entre reconstruções do placar (padrão: 0)\n");
+    fprintf(stderr, "  --commit-window <us>  Janela do group commit do journal (padrão: %d)\n", DEFAULT_COMMIT_WINDOW_US);
+    fprintf(stderr, "  --no-journal     Não grava votos em disco (perdidos se o processo cair)\n");
+    fprintf(stderr, "  --checkpoint-interval <s> Intervalo entre checkpoints, 0 desliga (padrão: %d)\n",
+            DEFAULT_CHECKPOINT_INTERVAL_S);
+    fprintf(stderr, "  --watch-interval <ms> Intervalo mínimo entre atualizações do WATCH (padrão: %d)\n",
+            DEFAULT_WATCH_INTERVAL_MS);
+    fprintf(stderr, "  --handshake-timeout <s> Prazo para o HELLO, 0 desliga (padrão: %d)\n",
+            DEFAULT_HANDSHAKE_TIMEOUT_S);
+    fprintf(stderr, "  --idle-timeout <s> Prazo sem comandos (exceto com WATCH), 0 desliga (padrão: %d)\n",
+            DEFAULT_IDLE_TIMEOUT_S);
+    fprintf(stderr, "  --session-timeout <s> Duração máxima de uma conexão, 0 desliga (padrão: 0)\n");
+    fprintf(stderr, "  --roll <arquivo> Cadastro de eleitores, um VOTER_ID por linha: só eles fazem HELLO\n");
+    fprintf(stderr, "  --metrics-port <p> Serve as métricas (Prometheus) em 127.0.0.1:p\n");
+    fprintf(stderr, "  --cluster <host:porta,...> Portas de peers de todos os nós (a mesma lista em todos)\n");
+    fprintf(stderr, "  --node <i>       Índice deste nó na lista do --cluster (padrão: 0)\n");
+    fprintf(stderr, "  --cluster-ttl <ms> Validade dos totais dos outros nós no SCORE (padrão: %d)\n",
+            DEFAULT_CLUSTER_TTL_MS);
+#ifdef WITH_MPI
+    fprintf(stderr, "  --mpi-interval <ms> Intervalo entre reduções MPI dos totais (padrão: %d)\n",
+            DEFAULT_MPI_INTERVAL_MS);
+#endif
+    fprintf(stderr, "  --election <nome>=<arquivo> Abre uma eleição com as opções do arquivo (repetível;\n");
+    fprintf(stderr, "                   a primeira é a padrão). Sem ela: uma eleição com opcoes.txt\n");
+}
+
+// Acrescenta a eleição "nome=arquivo" à configuração
+static void add_election(ServerConfig *config, char *arg) {
+    char *separator = strchr(arg, '=');
+    size_t name_len = separator ? (size_t)(separator - arg) : 0;
+    if (name_len == 0 || name_len >= MAX_ELECTION_NAME || separator[1] == '\0' ||
+        strspn(arg, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-") != name_len) {
+        fprintf(stderr, "Eleição inválida: %s (use nome=arquivo; nome com letras, dígitos, _ ou -, "
+                "até %d caracteres)\n", arg, MAX_ELECTION_NAME - 1);
+        exit(1);
+    }
+    *separator = '\0';
+    for (int i = 0; i < config->num_elections; i++) {
+        if (strcmp(config->elections[i].name, arg) == 0) {
+            fprintf(stderr, "Eleição repetida: %s\n", arg);
+            exit(1);
+        }
+    }
+    
+    ElectionSpec *elections = realloc(config->elections, (config->num_elections + 1) * sizeof(ElectionSpec));
+    if (elections == NULL) {
+        perror("Erro ao alocar eleições");
+        exit(1);
+    }
+    config->elections = elections;
+    snprintf(elections[config->num_elections].name, MAX_ELECTION_NAME, "%s", arg);
+    elections[config->num_elections].options_path = separator + 1;
+    config->num_elections++;
+}
+
+// Lê as opções de linha de comando
+static void parse_args(int argc, char *argv[], ServerConfig *config) {
+    static struct option long_options[] = {
+        {"event-loop", no_argument, NULL, 'e'},
+        {"loops", required_argument, NULL, 'l'},
+        {"shards", no_argument, NULL, 'S'},
+        {"workers", required_argument, NULL, 'p'},
+        {"queue-depth", required_argument, NULL, 'q'},
+        {"log-buffer", required_argument, NULL, 'b'},
+        {"log-full", required_argument, NULL, 'f'},
+        {"log-level", required_argument, NULL, 'v'},
+        {"score-interval", required_argument, NULL, 's'},
+        {"commit-window", required_argument, NULL, 'w'},
+        {"no-journal", no_argument, NULL, 'n'},
+        {"checkpoint-interval", required_argument, NULL, 'c'},
+        {"watch-interval", required_argument, NULL, 'W'},
+        {"election", required_argument, NULL, 'E'},
+        {"metrics-port", required_argument, NULL, 'P'},
+        {"handshake-timeout", required_argument, NULL, 'H'},
+        {"idle-timeout", required_argument, NULL, 'I'},
+        {"session-timeout", required_argument, NULL, 'D'},
+        {"roll", required_argument, NULL, 'R'},
+        {"io-uring", no_argument, NULL, 'U'},
+        {"cluster", required_argument, NULL, 'C'},
+        {"node", required_argument, NULL, 'N'},
+        {"cluster-ttl", required_argument, NULL, 'T'},
+#ifdef WITH_MPI
+        {"mpi-interval", required_argument, NULL, 'M'},
+#endif
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    
+    memset(config, 0, sizeof(*config));
+    config->num_loops = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    config->log_capacity = LOG_DEFAULT_CAPACITY;
+    config->log_policy = LOG_FULL_COUNT;
+    config->log_level = LOG_LEVEL_INFO;
+    config->journal = true;
+    config->commit_window_us = DEFAULT_COMMIT_WINDOW_US;
+    config->checkpoint_interval_s = DEFAULT_CHECKPOINT_INTERVAL_S;
+    config->watch_interval_ms = DEFAULT_WATCH_INTERVAL_MS;
+    config->queue_depth = DEFAULT_QUEUE_DEPTH;
+    config->cluster_ttl_ms = DEFAULT_CLUSTER_TTL_MS;
+    config->handshake_timeout_s = DEFAULT_HANDSHAKE_TIMEOUT_S;
+    config->idle_timeout_s = DEFAULT_IDLE_TIMEOUT_S;
+    config->log_dir = "logs";
+#ifdef WITH_MPI
+    config->mpi_interval_ms = DEFAULT_MPI_INTERVAL_MS;
+#endif
+    
+    int c;
+    while ((c = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'e':
+                config->event_loop = true;
+                break;
+            case 'l':
+                config->num_loops = atoi(optarg);
+                break;
+            case 'S':
+                config->event_loop = true;
+                config->sharded = true;
+                break;
+            case 'U':
+                config->event_loop = true;
+                config->io_uring = true;
+                break;
+            case 'p':
+                config->num_workers = atoi(optarg);
+                break;
+            case 'q':
+                config->queue_depth = strtoul(optarg, NULL, 10);
+                break;
+            case 'b':
+                config->log_capacity = strtoul(optarg, NULL, 10);
+                break;
+            case 'f':
+                if (logger_parse_policy(optarg, &config->log_policy) < 0) {
+                    fprintf(stderr, "Política de log inválida: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'v':
+                if (logger_parse_level(optarg, &config->log_level) < 0) {
+                    fprintf(stderr, "Nível de log inválido: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 's':
+                config->score_interval_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'w':
+                config->commit_window_us = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                config->journal = false;
+                break;
+            case 'c':
+                config->checkpoint_interval_s = strtoul(optarg, NULL, 10);
+                break;
+            case 'W':
+                config->watch_interval_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'E':
+                add_election(config, optarg);
+                break;
+            case 'P':
+                config->metrics_port = atoi(optarg);
+                break;
+            case 'H':
+                config->handshake_timeout_s = strtoul(optarg, NULL, 10);
+                break;
+            case 'I':
+                config->idle_timeout_s = strtoul(optarg, NULL, 10);
+                break;
+            case 'D':
+                config->session_timeout_s = strtoul(optarg, NULL, 10);
+                break;
+            case 'R':
+                config->roll_path = optarg;
+                break;
+            case 'C':
+                config->cluster_nodes = optarg;
+                break;
+            case 'N':
+                config->node_id = atoi(optarg);
+                break;
+            case 'T':
+                config->cluster_ttl_ms = strtoul(optarg, NULL, 10);
+                break;
+#ifdef WITH_MPI
+            case 'M':
+                config->mpi_interval_ms = strtoul(optarg, NULL, 10);
+                break;
+#endif
+            default:
+                print_usage(argv[0]);
+                exit(1);
+        }
+    }
     
-    close(server_socket);
-    fclose(server.log_file);
-    pthread_mutex_destroy(&server.mutex);
+    if (optind != argc - 1) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+    
+    config->port = atoi(argv[optind]);
+    if (config->num_loops < 1) {
+        config->num_loops = 1;
+    }
+    if (config->num_workers < 0 || config->queue_depth < 1) {
+        fprintf(stderr, "Pool inválido: --workers >= 0 e --queue-depth >= 1\n");
+        exit(1);
+    }
+    // Encaminhar um VOTE ou somar o SCORE espera os outros nós na thread
+    // que atende o comando: num event loop isso pararia o loop inteiro
+    if (config->cluster_nodes != NULL && config->event_loop) {
+        fprintf(stderr, "--cluster usa o modo thread: não combina com --event-loop, --shards ou --io-uring\n");
+        exit(1);
+    }
+    // Cada shard precisa de pelo menos um stripe da tabela de votantes
+    if (config->sharded && config->num_loops > VOTER_TABLE_STRIPES) {
+        config->num_loops = VOTER_TABLE_STRIPES;
+    }
+#ifdef WITH_MPI
+    if (config->mpi_interval_ms < 1) {
+        config->mpi_interval_ms = 1;
+    }
+#endif
+}
+
+int main(int argc, char *argv[]) {
+    // Sinais são tratados só pela signal_thread: bloqueia antes de criar
+    // qualquer thread (inclusive as da biblioteca MPI) para que todas
+    // herdem a máscara
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    
+    ServerConfig config;
+#ifdef WITH_MPI
+    mpi_init(&argc, &argv);
+    parse_args(argc, argv, &config);
+    mpi_configure(&config);
+#else
+    parse_args(argc, argv, &config);
+#endif
+    
+    ElectionServer server;
+    init_server(&server, &config);
+#ifdef WITH_MPI
+    mpi_tally_start(&server, config.mpi_interval_ms);
+#endif
+    if (config.metrics_port > 0) {
+        metrics_start_http(&server, config.metrics_port);
+    }
+    
+    pthread_t signal_tid;
+    if (pthread_create(&signal_tid, NULL, signal_thread, &server) != 0) {
+        perror("Erro ao criar thread de sinais");
+        exit(1);
+    }
+    pthread_detach(signal_tid);
+    
+    // Modo sharded: um socket SO_REUSEPORT por loop
+    int listen_sockets[VOTER_TABLE_STRIPES];
+    int num_sockets = config.sharded ? config.num_loops : 1;
+    for (int i = 0; i < num_sockets; i++) {
+        listen_sockets[i] = create_listen_socket(config.port, SOMAXCONN, config.sharded);
+    }
+    
+    printf("Servidor de votação iniciado na porta %d\n", config.port);
+    printf("Aguardando conexões...\n");
+    LOG_INFO(&server, "Servidor aguardando conexões na porta %d", config.port);
+    
+    // io_uring só no event loop comum e com o kernel (e o build) suportando
+    if (config.io_uring && config.sharded) {
+        LOG_INFO(&server, "io_uring não é usado no modo sharded: usando epoll");
+    } else if (config.io_uring && !uring_supported()) {
+        LOG_INFO(&server, "io_uring indisponível no kernel ou no build: usando epoll");
+    } else {
+        server.io_uring = config.io_uring;
+    }
+    
+    if (config.sharded) {
+        LOG_INFO(&server, "Modo sharded: %d loops epoll com SO_REUSEPORT", config.num_loops);
+        run_event_loops(&server, listen_sockets, config.num_loops);
+    } else if (config.event_loop) {
+        LOG_INFO(&server, "Modo event loop: %d loops %s", config.num_loops,
+                 server.io_uring ? "io_uring" : "epoll");
+        run_event_loops(&server, listen_sockets, config.num_loops);
+    } else {
+        WorkerPool pool;
+        if (config.num_workers > 0) {
+            if (worker_pool_init(&pool, config.num_workers, config.queue_depth, handle_client) < 0) {
+                perror("Erro ao criar pool de workers");
+                exit(1);
+            }
+            server.pool = &pool;
+            LOG_INFO(&server, "Modo thread: pool de %d workers, fila de %zu conexões",
+                     config.num_workers, config.queue_depth);
+        }
+        start_thread_timers(&server);
+        accept_loop(&server, listen_sockets[0]);
+    }
+    
+    for (int i = 0; i < num_sockets; i++) {
+        close(listen_sockets[i]);
+    }
+    for (int i = 0; i < server.num_elections; i++) {
+        election_shutdown(server.elections[i]);
+        election_destroy(server.elections[i]);
+    }
+    free(server.elections);
+    roll_free(server.roll);
+    logger_shutdown(&server.logger);
+    free(config.elections);
     
     return 0;
 }
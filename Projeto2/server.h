@@ -3,34 +3,124 @@
 
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include "protocol.h"
+#include "voter_table.h"
+#include "tally.h"
+#include "logger.h"
+#include "latency.h"
+#include "response_cache.h"
+#include "journal.h"
+#include "watch.h"
+#include "worker_pool.h"
 
-// Estrutura para armazenar opções de votação
+// Estrutura para armazenar opções de votação. Só contém dados imutáveis
+// após election_open; os contadores ficam em Tally, em linhas de cache
+// separadas, para que votos não invalidem as linhas com os nomes.
 typedef struct {
     char name[MAX_OPTION_NAME];
-    int votes;
 } VoteOption;
 
-// Estrutura para armazenar votantes
+struct Cluster;
+struct VoterRoll;
+
+// Eleição pedida na linha de comando (--election nome=arquivo)
 typedef struct {
-    char voter_id[MAX_VOTER_ID];
-    bool has_voted;
-    char voted_option[MAX_OPTION_NAME];
-} Voter;
+    char name[MAX_ELECTION_NAME];
+    const char *options_path;
+} ElectionSpec;
 
-// Estrutura global do servidor
+// Configuração de execução do servidor (linha de comando)
 typedef struct {
-    VoteOption options[MAX_OPTIONS];
+    int port;
+    bool event_loop;
+    int num_loops;
+    bool sharded;               // um socket SO_REUSEPORT por loop, votantes particionados
+    bool io_uring;              // event loops sobre io_uring (se o kernel suportar)
+    int num_workers;            // modo thread: tamanho do pool (0: uma thread por conexão)
+    size_t queue_depth;         // conexões esperando um worker antes do ERR BUSY
+    const char *cluster_nodes;  // "host:porta,..." dos peers de todos os nós (NULL: nó único)
+    int node_id;                // índice deste nó em cluster_nodes
+    unsigned long cluster_ttl_ms;       // validade dos totais dos outros nós no SCORE
+    unsigned long mpi_interval_ms;      // server_mpi: intervalo entre reduções dos totais
+    const char *log_dir;        // log do servidor e arquivos das eleições (padrão: logs)
+    int metrics_port;           // métricas Prometheus em 127.0.0.1 (0: desligadas)
+    unsigned handshake_timeout_s;       // prazos das conexões (0: sem prazo)
+    unsigned idle_timeout_s;
+    unsigned session_timeout_s;
+    const char *roll_path;      // cadastro de eleitores (NULL: qualquer VOTER_ID)
+    size_t log_capacity;        // registros no ring buffer do log
+    LogFullPolicy log_policy;
+    int log_level;
+    unsigned long score_interval_ms;    // 0: reconstrói o placar a cada voto
+    bool journal;
+    unsigned long commit_window_us;     // janela do group commit do journal
+    unsigned checkpoint_interval_s;     // 0: sem checkpoints periódicos
+    unsigned long watch_interval_ms;    // intervalo mínimo entre atualizações do WATCH
+    ElectionSpec *elections;    // vazio: uma eleição com opcoes.txt
+    int num_elections;
+} ServerConfig;
+
+// Uma eleição: opções, votos, votantes, journal, log e resultado próprios.
+// Nada é compartilhado entre eleições, então votos em eleições diferentes
+// nunca disputam o mesmo lock ou linha de cache.
+typedef struct Election {
+    char name[MAX_ELECTION_NAME];
+    int index;                  // posição em ElectionServer.elections
+    VoteOption *options;
     int num_options;
+    uint64_t options_hash;      // identifica a lista no journal e no checkpoint
+    Tally tally;
     
-    Voter voters[MAX_CLIENTS];
-    int num_voters;
+    VoterTable voters;
     
-    bool election_closed;
+    // closing recusa votos novos; closed só vem depois que os votos em
+    // andamento (votes_inflight) terminaram, então quem vê closed vê o
+    // placar final
+    atomic_bool closing;
+    atomic_bool closed;
+    _Atomic int votes_inflight;
     
-    pthread_mutex_t mutex;
+    // Respostas de LIST/SCORE pré-serializadas
+    ResponseCache responses;
     
-    FILE *log_file;
+    Journal journal;
+    WatchHub watch;
+    Logger logger;              // só usado por eleições com log próprio
+    Logger *log;                // log da eleição (ou o do servidor)
+    struct Cluster *cluster;    // modo cluster (NULL: nó único)
+    
+    char journal_path[256];
+    char checkpoint_path[256];
+    char results_base[256];     // resultado final (.txt, .csv, .json)
+    char export_base[256];      // ADMIN EXPORT
+} Election;
+
+// Estrutura global do servidor
+typedef struct {
+    Election **elections;       // a primeira é a padrão do HELLO sem eleição
+    int num_elections;
+    size_t max_response;        // maior resposta de um comando, em bytes
+    
+    // Modo sharded: cada loop é dono dos votantes de voter_table_shard(); 0
+    // nos demais modos
+    int num_shards;
+    _Atomic uint64_t handoffs;  // conexões transferidas para o loop dono
+    
+    bool io_uring;              // event loops sobre io_uring (com suporte confirmado)
+    
+    WorkerPool *pool;           // modo thread com pool (NULL: uma thread por conexão)
+    struct Cluster *cluster;    // modo cluster (NULL: nó único)
+    
+    // Prazos das conexões em ns (0: sem prazo)
+    uint64_t handshake_timeout_ns;
+    uint64_t idle_timeout_ns;
+    uint64_t session_timeout_ns;
+    
+    struct VoterRoll *roll;     // cadastro de eleitores (NULL: qualquer VOTER_ID)
+    
+    Logger logger;
+    Logger *log;                // &logger (usado pelos macros LOG_*)
 } ElectionServer;
 
 // Estrutura para passar dados para threads de cliente
@@ -38,18 +128,104 @@ typedef struct {
     int socket;
     char voter_id[MAX_VOTER_ID];
     ElectionServer *server;
+    bool peer;              // conexão de outro nó do cluster (porta de peers)
 } ClientData;
 
+// Estado de protocolo de uma conexão (comum aos modos thread e event loop)
+typedef struct {
+    Election *election;     // escolhida no HELLO
+    char voter_id[MAX_VOTER_ID];
+    uint64_t voter_hash;    // calculado no HELLO
+    bool authenticated;
+    CommandStat last_command;   // histograma do último comando processado
+    uint64_t durable_lsn;   // respostas só saem com o journal da eleição em disco até aqui
+    bool watching;          // assinou o placar com WATCH
+    bool peer;              // aceita os comandos entre nós do cluster
+} Session;
+
+// Resultado de session_hello
+typedef enum {
+    HELLO_OK,
+    HELLO_UNKNOWN_ELECTION,
+    HELLO_NOT_ELIGIBLE  // VOTER_ID fora do cadastro de eleitores
+} HelloResult;
+
+// Resultado de record_vote
+typedef enum {
+    VOTE_RECORDED,
+    VOTE_DUPLICATE,
+    VOTE_INVALID_OPTION,
+    VOTE_CLOSED,
+    VOTE_REJECTED,      // sem memória para cadastrar o votante
+    VOTE_UNAVAILABLE    // nó dono do votante não respondeu (modo cluster)
+} VoteResult;
+
+// Prazo vencido de uma conexão
+typedef enum {
+    TIMEOUT_NONE,
+    TIMEOUT_HANDSHAKE,  // sem HELLO desde a conexão
+    TIMEOUT_IDLE,       // sem comandos (assinantes do WATCH não contam)
+    TIMEOUT_SESSION,    // duração total da conexão
+    TIMEOUT_REASONS
+} TimeoutReason;
+
+// Resultado do processamento de um comando
+typedef enum {
+    SESSION_CONTINUE,
+    SESSION_CLOSE
+} SessionAction;
+
+// Log por nível: owner é qualquer estrutura com um campo Logger *log
+// (ElectionServer ou Election). logger_log só é chamado se o nível estiver
+// habilitado em tempo de execução; níveis acima de LOG_COMPILE_LEVEL viram
+// código morto, que o compilador remove mas ainda confere (os argumentos
+// continuam contando como usados).
+#define LOG_AT(owner, lvl, ...) \
+    do { \
+        if ((lvl) <= (owner)->log->level) { \
+            logger_log((owner)->log, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_OFF(owner, ...) \
+    do { \
+        if (0) { \
+            logger_log((owner)->log, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_ERROR(owner, ...) LOG_AT(owner, LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(owner, ...) LOG_AT(owner, LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(owner, ...) LOG_OFF(owner, __VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(owner, ...) LOG_AT(owner, LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(owner, ...) LOG_OFF(owner, __VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_TRACE
+#define LOG_TRACE(owner, ...) LOG_AT(owner, LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+#define LOG_TRACE(owner, ...) LOG_OFF(owner, __VA_ARGS__)
+#endif
+
 // Funções principais
-void init_server(ElectionServer *server);
-void load_options(ElectionServer *server, const char *filename);
+void init_server(ElectionServer *server, const ServerConfig *config);
 void write_log(ElectionServer *server, const char *format, ...);
 void *handle_client(void *arg);
-int find_voter(ElectionServer *server, const char *voter_id);
-int add_voter(ElectionServer *server, const char *voter_id);
-bool record_vote(ElectionServer *server, const char *voter_id, int option_index);
-void get_score(ElectionServer *server, char *buffer, bool final);
-void close_election(ElectionServer *server);
-void save_final_results(ElectionServer *server);
+SessionAction process_command(ElectionServer *server, Session *session, char *command, char *response);
+SessionAction process_binary_frame(ElectionServer *server, Session *session, const uint8_t *frame,
+                                   size_t frame_len, uint8_t *response, size_t *response_len);
+HelloResult session_hello(ElectionServer *server, Session *session, const char *voter_id, const char *election_name);
+VoteResult session_vote(Session *session, int option_index);
+void format_vote_response(Election *election, VoteResult result, int option_index, char *response);
+Election *find_election(ElectionServer *server, const char *name);
+int create_listen_socket(int port, int backlog, bool reuse_port);
+void dump_latency(ElectionServer *server);
 
 #endif
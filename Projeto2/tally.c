@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "tally.h"
+
+#define CACHE_LINE 64
+
+static _Atomic unsigned int next_shard;
+static __thread int thread_shard = -1;
+
+static inline TallyShard *shard_at(Tally *tally, int i) {
+    return (TallyShard *)(tally->shards + (size_t)i * tally->stride);
+}
+
+// Shard fixo da thread atual, distribuído em round-robin
+static inline int current_shard(void) {
+    if (thread_shard < 0) {
+        thread_shard = atomic_fetch_add_explicit(&next_shard, 1, memory_order_relaxed) % TALLY_SHARDS;
+    }
+    return thread_shard;
+}
+
+int tally_init(Tally *tally, int num_options) {
+    size_t bytes = sizeof(TallyShard) + (size_t)num_options * sizeof(_Atomic uint64_t);
+
+    tally->num_options = num_options;
+    tally->stride = (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    tally->shards = aligned_alloc(CACHE_LINE, tally->stride * TALLY_SHARDS);
+    if (tally->shards == NULL) {
+        return -1;
+    }
+    atomic_init(&tally->freezers, 0);
+
+    for (int i = 0; i < TALLY_SHARDS; i++) {
+        TallyShard *shard = shard_at(tally, i);
+        atomic_init(&shard->begin, 0);
+        atomic_init(&shard->end, 0);
+        for (int j = 0; j < num_options; j++) {
+            atomic_init(&shard->counts[j], 0);
+        }
+    }
+    return 0;
+}
+
+void tally_destroy(Tally *tally) {
+    free(tally->shards);
+    tally->shards = NULL;
+}
+
+void tally_add(Tally *tally, int option_index, uint64_t n) {
+    TallyShard *shard = shard_at(tally, current_shard());
+
+    // Um leitor que não conseguiu retrato exato segura os incrementos novos
+    while (atomic_load_explicit(&tally->freezers, memory_order_relaxed) > 0) {
+        sched_yield();
+    }
+    atomic_fetch_add_explicit(&shard->begin, 1, memory_order_relaxed);
+    // Quem observar o novo contador também observa begin incrementado
+    atomic_thread_fence(memory_order_release);
+    atomic_fetch_add_explicit(&shard->counts[option_index], n, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->end, 1, memory_order_release);
+}
+
+// Leitura em três fases: end de todos os shards, contadores, begin de
+// todos os shards. Se begin == end lido antes em todos os shards, nenhum
+// incremento estava em andamento entre a primeira e a última fase, então
+// os contadores correspondem a um mesmo instante.
+static bool try_snapshot(Tally *tally, uint64_t *counts, uint64_t *version) {
+    uint64_t ends[TALLY_SHARDS];
+    uint64_t total_end = 0;
+    for (int i = 0; i < TALLY_SHARDS; i++) {
+        ends[i] = atomic_load_explicit(&shard_at(tally, i)->end, memory_order_acquire);
+        total_end += ends[i];
+    }
+
+    memset(counts, 0, (size_t)tally->num_options * sizeof(uint64_t));
+    for (int i = 0; i < TALLY_SHARDS; i++) {
+        TallyShard *shard = shard_at(tally, i);
+        for (int j = 0; j < tally->num_options; j++) {
+            counts[j] += atomic_load_explicit(&shard->counts[j], memory_order_relaxed);
+        }
+    }
+    if (version != NULL) {
+        *version = total_end;
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+    for (int i = 0; i < TALLY_SHARDS; i++) {
+        if (atomic_load_explicit(&shard_at(tally, i)->begin, memory_order_relaxed) != ends[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void tally_snapshot(Tally *tally, uint64_t *counts, uint64_t *version) {
+    for (int attempt = 0; attempt < TALLY_SNAPSHOT_RETRIES; attempt++) {
+        if (try_snapshot(tally, counts, version)) {
+            return;
+        }
+    }
+
+    // Carga contínua: segura os incrementos novos; os que já passaram da
+    // barreira terminam e a próxima leitura sai exata
+    atomic_fetch_add(&tally->freezers, 1);
+    while (!try_snapshot(tally, counts, version)) {
+        sched_yield();
+    }
+    atomic_fetch_sub(&tally->freezers, 1);
+}
+
+uint64_t tally_version(Tally *tally) {
+    uint64_t total = 0;
+    for (int i = 0; i < TALLY_SHARDS; i++) {
+        total += atomic_load_explicit(&shard_at(tally, i)->end, memory_order_acquire);
+    }
+    return total;
+}
@@ -0,0 +1,47 @@
+#ifndef TALLY_H
+#define TALLY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Número de shards de contadores (potência de 2). Cada thread escreve
+// sempre no mesmo shard, escolhido na primeira vez que vota.
+#define TALLY_SHARDS 64
+
+// Tentativas de leitura consistente antes de segurar os escritores
+#define TALLY_SNAPSHOT_RETRIES 16
+
+// Shard de contadores: ocupa linhas de cache próprias, de modo que
+// threads em shards diferentes nunca escrevem na mesma linha.
+// begin/end funcionam como um seqlock com vários escritores.
+typedef struct {
+    _Atomic uint64_t begin;     // incrementos iniciados
+    _Atomic uint64_t end;       // incrementos concluídos
+    _Atomic uint64_t counts[];  // um contador por opção
+} TallyShard;
+
+typedef struct {
+    int num_options;
+    size_t stride;              // bytes por shard, múltiplo de 64
+    unsigned char *shards;
+    _Atomic int freezers;       // leitores segurando os escritores
+} Tally;
+
+int tally_init(Tally *tally, int num_options);
+void tally_destroy(Tally *tally);
+
+// Soma n votos na opção, no shard da thread atual (sem locks)
+void tally_add(Tally *tally, int option_index, uint64_t n);
+
+// Copia os totais por opção para counts, num retrato exato de um instante
+// (nenhum incremento em andamento). Se as TALLY_SNAPSHOT_RETRIES tentativas
+// sem lock falham, segura os novos incrementos até conseguir.
+// *version recebe o número total de incrementos refletidos (pode ser NULL).
+void tally_snapshot(Tally *tally, uint64_t *counts, uint64_t *version);
+
+// Número de incrementos concluídos; muda sempre que algum total muda
+uint64_t tally_version(Tally *tally);
+
+#endif
@@ -0,0 +1,98 @@
+#include <string.h>
+#include "timer_wheel.h"
+
+void timer_wheel_init(TimerWheel *wheel, uint64_t now) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now;
+}
+
+// Posição pelo tempo até o vencimento: o nível é o menor que o alcança
+static void place(TimerWheel *wheel, TimerEntry *entry) {
+    uint64_t expires = entry->expires;
+    uint64_t delta = expires - wheel->now;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    // Além do alcance do último nível: volta a esse nível a cada volta
+    uint64_t max_delta = (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    if (delta > max_delta) {
+        expires = wheel->now + max_delta;
+    }
+
+    TimerEntry **slot = &wheel->slots[level][(expires >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)];
+    entry->slot = slot;
+    entry->prev = NULL;
+    entry->next = *slot;
+    if (*slot != NULL) {
+        (*slot)->prev = entry;
+    }
+    *slot = entry;
+    entry->pending = true;
+    wheel->count++;
+}
+
+static void unlink_entry(TimerWheel *wheel, TimerEntry *entry) {
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        *entry->slot = entry->next;
+    }
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    }
+    entry->pending = false;
+    wheel->count--;
+}
+
+void timer_wheel_schedule(TimerWheel *wheel, TimerEntry *entry, uint64_t expires) {
+    if (entry->pending) {
+        unlink_entry(wheel, entry);
+    }
+    entry->expires = expires > wheel->now ? expires : wheel->now + 1;
+    place(wheel, entry);
+}
+
+void timer_wheel_cancel(TimerWheel *wheel, TimerEntry *entry) {
+    if (entry->pending) {
+        unlink_entry(wheel, entry);
+    }
+}
+
+// Redistribui uma posição de um nível superior pelos níveis de baixo
+static void cascade(TimerWheel *wheel, int level) {
+    TimerEntry **slot = &wheel->slots[level][(wheel->now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)];
+    TimerEntry *entry = *slot;
+    *slot = NULL;
+    while (entry != NULL) {
+        TimerEntry *next = entry->next;
+        wheel->count--;
+        place(wheel, entry);
+        entry = next;
+    }
+}
+
+void timer_wheel_advance(TimerWheel *wheel, uint64_t now, TimerExpireFn expire, void *arg) {
+    while (wheel->now < now) {
+        wheel->now++;
+
+        // Na virada de cada nível, desce a posição seguinte do nível de cima
+        for (int level = 1; level < WHEEL_LEVELS; level++) {
+            if ((wheel->now & ((1ULL << (WHEEL_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            cascade(wheel, level);
+        }
+
+        TimerEntry **slot = &wheel->slots[0][wheel->now & (WHEEL_SLOTS - 1)];
+        TimerEntry *entry = *slot;
+        *slot = NULL;
+        while (entry != NULL) {
+            TimerEntry *next = entry->next;
+            entry->pending = false;
+            wheel->count--;
+            expire(entry, arg);
+            entry = next;
+        }
+    }
+}
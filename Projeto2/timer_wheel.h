@@ -0,0 +1,45 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Roda de timers hierárquica: 4 níveis de 64 posições, o nível n com
+// posições de 64^n ticks. Agendar e cancelar são O(1); cada tick esvazia
+// uma posição do nível 0 e, a cada 64 ticks, redistribui uma posição do
+// nível de cima. Prazos além de 64^4 ticks ficam circulando no último nível
+// até entrarem no alcance. Sem locks: a roda é de quem a avança.
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+
+// Timer embutido no objeto que ele controla
+typedef struct TimerEntry {
+    uint64_t expires;           // tick do vencimento
+    bool pending;               // está na roda
+    struct TimerEntry **slot;   // lista onde está (para cancelar em O(1))
+    struct TimerEntry *prev;
+    struct TimerEntry *next;
+} TimerEntry;
+
+typedef struct {
+    uint64_t now;               // último tick processado
+    TimerEntry *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    size_t count;
+} TimerWheel;
+
+// Chamada para cada timer vencido, já fora da roda (pode reagendá-lo)
+typedef void (*TimerExpireFn)(TimerEntry *entry, void *arg);
+
+void timer_wheel_init(TimerWheel *wheel, uint64_t now);
+
+// Agenda (ou reagenda) o timer. Prazos já passados vencem no próximo tick.
+void timer_wheel_schedule(TimerWheel *wheel, TimerEntry *entry, uint64_t expires);
+
+void timer_wheel_cancel(TimerWheel *wheel, TimerEntry *entry);
+
+// Processa os ticks até now, chamando expire para cada timer vencido
+void timer_wheel_advance(TimerWheel *wheel, uint64_t now, TimerExpireFn expire, void *arg);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// io_uring direto sobre as syscalls (sem liburing), só com o que o event
+// loop usa: filas de submissão e de conclusão e um anel de buffers
+// registrado no kernel, de onde o recv multishot tira onde gravar. Cada
+// anel é de uma thread só. Compilado com WITH_IO_URING (o Makefile liga se
+// os headers do kernel têm o recv multishot).
+
+// O kernel e o build têm tudo o que o event loop usa (accept e recv
+// multishot, anel de buffers, cancelamento por fd)?
+bool uring_supported(void);
+
+#ifdef WITH_IO_URING
+#include <linux/io_uring.h>
+
+typedef struct Uring {
+    int fd;
+
+    // Fila de submissão: sqe_tail é local até uring_submit publicá-la
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    struct io_uring_sqe *sqes;
+    unsigned sqe_tail;
+    unsigned submitted;
+
+    // Fila de conclusão
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_map;
+    size_t sq_map_len;
+    void *cq_map;
+    size_t cq_map_len;
+    size_t sqes_len;
+
+    // Anel de buffers do recv multishot (grupo 0)
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_len;
+    char *buffers;
+    unsigned buf_count;
+    unsigned buf_size;
+    uint16_t buf_tail;
+} Uring;
+
+// Cria o anel com entries posições de submissão (e 4x de conclusão). Retorna
+// -1 com errno.
+int uring_init(Uring *ring, unsigned entries);
+void uring_free(Uring *ring);
+
+// Registra count buffers de size bytes (count potência de 2) para o recv
+// multishot. Retorna -1 com errno.
+int uring_setup_buffers(Uring *ring, unsigned count, unsigned size);
+
+// Próxima posição de submissão, zerada. Com a fila cheia submete o que já
+// está nela antes.
+struct io_uring_sqe *uring_get_sqe(Uring *ring);
+
+// Submete o que estiver na fila e espera pelo menos wait conclusões (uma
+// única io_uring_enter). Retorna -1 com errno.
+int uring_submit_and_wait(Uring *ring, unsigned wait);
+
+// Próxima conclusão (NULL se não há) e a liberação dela
+static inline struct io_uring_cqe *uring_peek(Uring *ring) {
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+static inline void uring_cqe_seen(Uring *ring) {
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+// Buffer bid do anel (da conclusão de um recv) e a devolução dele ao kernel
+static inline char *uring_buffer(Uring *ring, unsigned bid) {
+    return ring->buffers + (size_t)bid * ring->buf_size;
+}
+void uring_recycle(Uring *ring, unsigned bid);
+
+// Preparação das operações (user_data identifica a conclusão)
+void uring_prep_accept_multishot(struct io_uring_sqe *sqe, int fd, uint64_t user_data);
+void uring_prep_recv_multishot(struct io_uring_sqe *sqe, int fd, uint64_t user_data);
+void uring_prep_send(struct io_uring_sqe *sqe, int fd, const void *data, size_t len, uint64_t user_data);
+void uring_prep_poll_multishot(struct io_uring_sqe *sqe, int fd, uint64_t user_data);
+void uring_prep_cancel(struct io_uring_sqe *sqe, uint64_t target, uint64_t user_data);
+void uring_prep_cancel_fd(struct io_uring_sqe *sqe, int fd, uint64_t user_data);
+#endif
+
+#endif
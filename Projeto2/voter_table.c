@@ -0,0 +1,410 @@
+#include <stdlib.h>
+#include <string.h>
+#include "voter_table.h"
+#include "metrics.h"
+#include "latency.h"
+
+#define INITIAL_SLOTS 64
+#define INITIAL_IDS 1024
+// Cresce quando a ocupação passa de 70%
+#define MAX_LOAD_NUM 7
+#define MAX_LOAD_DEN 10
+
+// FNV-1a seguido do finalizador do splitmix64 para espalhar os bits
+// altos, que escolhem o stripe
+uint64_t voter_hash(const char *voter_id) {
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)voter_id; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h ? h : 1;
+}
+
+static inline uint32_t slot_tag(uint64_t hash) {
+    uint32_t tag = (uint32_t)hash;
+    return tag ? tag : 1;
+}
+
+static VoterStripe *stripe_for(VoterTable *table, uint64_t hash) {
+    return &table->stripes[hash >> (64 - VOTER_TABLE_STRIPE_BITS)];
+}
+
+void voter_table_init(VoterTable *table) {
+    for (int i = 0; i < VOTER_TABLE_STRIPES; i++) {
+        VoterStripe *stripe = &table->stripes[i];
+        pthread_mutex_init(&stripe->lock, NULL);
+        stripe->slots = NULL;
+        stripe->capacity = 0;
+        stripe->ids = NULL;
+        stripe->ids_len = 0;
+        stripe->ids_capacity = 0;
+        stripe->voted = NULL;
+        stripe->choices = NULL;
+        stripe->wide_choices = NULL;
+        stripe->count = 0;
+        stripe->voters_capacity = 0;
+    }
+}
+
+void voter_table_destroy(VoterTable *table) {
+    for (int i = 0; i < VOTER_TABLE_STRIPES; i++) {
+        VoterStripe *stripe = &table->stripes[i];
+        free(stripe->slots);
+        free(stripe->ids);
+        free(stripe->voted);
+        free(stripe->choices);
+        free(stripe->wide_choices);
+        pthread_mutex_destroy(&stripe->lock);
+    }
+}
+
+// Índice do votante cuja entrada começa em offset
+static inline uint32_t entry_index(const VoterStripe *stripe, uint32_t offset) {
+    uint32_t index;
+    memcpy(&index, stripe->ids + offset, sizeof(index));
+    return index;
+}
+
+// Procura o votante no stripe (lock já adquirido). Retorna o slot
+// encontrado ou o slot vazio onde ele seria inserido.
+static VoterSlot *probe(VoterStripe *stripe, const char *voter_id, uint64_t hash) {
+    size_t mask = stripe->capacity - 1;
+    uint32_t tag = slot_tag(hash);
+    size_t i = tag & mask;
+
+    while (1) {
+        VoterSlot *slot = &stripe->slots[i];
+        if (slot->tag == 0) {
+            return slot;
+        }
+        if (slot->tag == tag &&
+            strcmp(stripe->ids + slot->offset + VOTER_ENTRY_HEADER, voter_id) == 0) {
+            return slot;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+static bool grow_slots(VoterStripe *stripe) {
+    size_t new_capacity = stripe->capacity ? stripe->capacity * 2 : INITIAL_SLOTS;
+    VoterSlot *new_slots = calloc(new_capacity, sizeof(VoterSlot));
+    if (new_slots == NULL) {
+        return false;
+    }
+
+    // A tag guardada no slot evita recalcular o hash a partir do VOTER_ID
+    size_t mask = new_capacity - 1;
+    for (size_t i = 0; i < stripe->capacity; i++) {
+        VoterSlot *old = &stripe->slots[i];
+        if (old->tag == 0) {
+            continue;
+        }
+        size_t j = old->tag & mask;
+        while (new_slots[j].tag != 0) {
+            j = (j + 1) & mask;
+        }
+        new_slots[j] = *old;
+    }
+
+    free(stripe->slots);
+    stripe->slots = new_slots;
+    stripe->capacity = new_capacity;
+    return true;
+}
+
+// Aumenta os arrays paralelos dos votantes para new_capacity (múltiplo de
+// 64). Todos os arrays novos são alocados antes de trocar algum: sem
+// memória, o stripe fica exatamente como estava.
+static bool grow_voters(VoterStripe *stripe, size_t new_capacity) {
+    size_t old_capacity = stripe->voters_capacity;
+    uint8_t *choices = malloc(new_capacity);
+    uint64_t *voted = malloc(new_capacity / 64 * sizeof(uint64_t));
+    uint32_t *wide = stripe->wide_choices != NULL ? malloc(new_capacity * sizeof(uint32_t)) : NULL;
+    if (choices == NULL || voted == NULL || (stripe->wide_choices != NULL && wide == NULL)) {
+        free(choices);
+        free(voted);
+        free(wide);
+        return false;
+    }
+
+    if (old_capacity > 0) {
+        memcpy(choices, stripe->choices, old_capacity);
+        memcpy(voted, stripe->voted, old_capacity / 64 * sizeof(uint64_t));
+    }
+    memset(voted + old_capacity / 64, 0, (new_capacity - old_capacity) / 64 * sizeof(uint64_t));
+    if (wide != NULL) {
+        memcpy(wide, stripe->wide_choices, old_capacity * sizeof(uint32_t));
+    }
+
+    free(stripe->choices);
+    free(stripe->voted);
+    free(stripe->wide_choices);
+    stripe->choices = choices;
+    stripe->voted = voted;
+    stripe->wide_choices = wide;
+    stripe->voters_capacity = new_capacity;
+    return true;
+}
+
+// Acrescenta a entrada [index][VOTER_ID\0] ao fim de ids. Retorna o
+// deslocamento ou -1 sem memória.
+static int64_t append_entry(VoterStripe *stripe, const char *voter_id, uint32_t index) {
+    size_t len = strnlen(voter_id, MAX_VOTER_ID - 1);
+    size_t size = VOTER_ENTRY_HEADER + len + 1;
+    if (stripe->ids_len + size > stripe->ids_capacity) {
+        size_t new_capacity = stripe->ids_capacity ? stripe->ids_capacity * 2 : INITIAL_IDS;
+        while (new_capacity < stripe->ids_len + size) {
+            new_capacity *= 2;
+        }
+        // Deslocamentos de 32 bits
+        if (new_capacity > UINT32_MAX) {
+            return -1;
+        }
+        char *ids = realloc(stripe->ids, new_capacity);
+        if (ids == NULL) {
+            return -1;
+        }
+        stripe->ids = ids;
+        stripe->ids_capacity = new_capacity;
+    }
+
+    char *entry = stripe->ids + stripe->ids_len;
+    memcpy(entry, &index, sizeof(index));
+    memcpy(entry + VOTER_ENTRY_HEADER, voter_id, len);
+    entry[VOTER_ENTRY_HEADER + len] = '\0';
+    int64_t offset = (int64_t)stripe->ids_len;
+    stripe->ids_len += size;
+    return offset;
+}
+
+// Busca ou cria o votante (lock já adquirido). Retorna o índice no stripe
+// ou -1 sem memória; *created indica inserção.
+static int64_t lookup_or_insert(VoterStripe *stripe, const char *voter_id,
+                                uint64_t hash, bool *created) {
+    *created = false;
+
+    if ((stripe->count + 1) * MAX_LOAD_DEN > stripe->capacity * MAX_LOAD_NUM) {
+        if (!grow_slots(stripe)) {
+            return -1;
+        }
+    }
+
+    VoterSlot *slot = probe(stripe, voter_id, hash);
+    if (slot->tag != 0) {
+        return entry_index(stripe, slot->offset);
+    }
+
+    if (stripe->count == stripe->voters_capacity &&
+        !grow_voters(stripe, stripe->voters_capacity ? stripe->voters_capacity * 2 : INITIAL_SLOTS)) {
+        return -1;
+    }
+    size_t index = stripe->count;
+    int64_t offset = append_entry(stripe, voter_id, (uint32_t)index);
+    if (offset < 0) {
+        return -1;
+    }
+    // O bit de voto da posição nova já está zerado (grow_voters)
+    stripe->choices[index] = 0;
+
+    slot->tag = slot_tag(hash);
+    slot->offset = (uint32_t)offset;
+    stripe->count++;
+    *created = true;
+    return (int64_t)index;
+}
+
+// Marca o voto do votante index (lock já adquirido). false sem memória
+// para uma opção >= VOTER_WIDE_CHOICE.
+static bool set_choice(VoterStripe *stripe, size_t index, uint32_t option_index) {
+    if (option_index >= VOTER_WIDE_CHOICE) {
+        if (stripe->wide_choices == NULL) {
+            stripe->wide_choices = malloc(stripe->voters_capacity * sizeof(uint32_t));
+            if (stripe->wide_choices == NULL) {
+                return false;
+            }
+        }
+        stripe->wide_choices[index] = option_index;
+        stripe->choices[index] = VOTER_WIDE_CHOICE;
+    } else {
+        stripe->choices[index] = (uint8_t)option_index;
+    }
+    stripe->voted[index / 64] |= 1ULL << (index % 64);
+    return true;
+}
+
+// Adquire o lock do stripe. Só o caminho ocupado (trylock falhou) mede a
+// espera, então o caso sem disputa não paga o relógio.
+static void lock_stripe(VoterStripe *stripe) {
+    if (pthread_mutex_trylock(&stripe->lock) == 0) {
+        return;
+    }
+    uint64_t start = monotonic_ns();
+    pthread_mutex_lock(&stripe->lock);
+    METRIC_ADD(lock_waits, 1);
+    METRIC_ADD(lock_wait_ns, monotonic_ns() - start);
+}
+
+int voter_table_register(VoterTable *table, const char *voter_id, uint64_t hash) {
+    VoterStripe *stripe = stripe_for(table, hash);
+    bool created;
+
+    lock_stripe(stripe);
+    int64_t index = lookup_or_insert(stripe, voter_id, hash, &created);
+    pthread_mutex_unlock(&stripe->lock);
+
+    if (index < 0) {
+        return -1;
+    }
+    return created ? 1 : 0;
+}
+
+bool voter_table_has_voted(VoterTable *table, const char *voter_id, uint64_t hash) {
+    VoterStripe *stripe = stripe_for(table, hash);
+    bool has_voted = false;
+
+    lock_stripe(stripe);
+    if (stripe->capacity > 0) {
+        VoterSlot *slot = probe(stripe, voter_id, hash);
+        if (slot->tag != 0) {
+            has_voted = voter_stripe_voted(stripe, entry_index(stripe, slot->offset));
+        }
+    }
+    pthread_mutex_unlock(&stripe->lock);
+
+    return has_voted;
+}
+
+VoterMarkResult voter_table_mark_voted(VoterTable *table, const char *voter_id, uint64_t hash,
+                                       uint32_t option_index, VoterMarkCommit commit, void *ctx) {
+    VoterStripe *stripe = stripe_for(table, hash);
+    VoterMarkResult result;
+    bool created;
+
+    lock_stripe(stripe);
+    int64_t index = lookup_or_insert(stripe, voter_id, hash, &created);
+    if (index < 0) {
+        result = VOTER_NO_MEMORY;
+    } else if (voter_stripe_voted(stripe, index)) {
+        result = VOTER_DUPLICATE;
+    } else if (!set_choice(stripe, index, option_index)) {
+        result = VOTER_NO_MEMORY;
+    } else if (commit != NULL && !commit(ctx)) {
+        stripe->voted[index / 64] &= ~(1ULL << (index % 64));
+        result = VOTER_UNCOMMITTED;
+    } else {
+        result = VOTER_MARKED;
+    }
+    pthread_mutex_unlock(&stripe->lock);
+
+    return result;
+}
+
+size_t voter_table_count(VoterTable *table) {
+    size_t total = 0;
+    for (int i = 0; i < VOTER_TABLE_STRIPES; i++) {
+        VoterStripe *stripe = &table->stripes[i];
+        pthread_mutex_lock(&stripe->lock);
+        total += stripe->count;
+        pthread_mutex_unlock(&stripe->lock);
+    }
+    return total;
+}
+
+size_t voter_table_memory(VoterTable *table) {
+    size_t total = 0;
+    for (int i = 0; i < VOTER_TABLE_STRIPES; i++) {
+        VoterStripe *stripe = &table->stripes[i];
+        pthread_mutex_lock(&stripe->lock);
+        total += stripe->capacity * sizeof(VoterSlot) + stripe->ids_capacity +
+                 stripe->voters_capacity * sizeof(uint8_t) + stripe->voters_capacity / 8;
+        if (stripe->wide_choices != NULL) {
+            total += stripe->voters_capacity * sizeof(uint32_t);
+        }
+        pthread_mutex_unlock(&stripe->lock);
+    }
+    return total;
+}
+
+// Garante espaço na lista para count votantes e ids_len bytes de VOTER_IDs
+static int reserve_list(VoterList *list, size_t count, size_t ids_len) {
+    if (count > list->capacity) {
+        size_t new_capacity = list->capacity ? list->capacity * 2 : INITIAL_SLOTS;
+        while (new_capacity < count) {
+            new_capacity *= 2;
+        }
+        uint64_t *voted = realloc(list->voted, new_capacity / 64 * sizeof(uint64_t));
+        if (voted == NULL) {
+            return -1;
+        }
+        memset(voted + list->capacity / 64, 0, (new_capacity - list->capacity) / 64 * sizeof(uint64_t));
+        list->voted = voted;
+        list->capacity = new_capacity;
+    }
+    if (ids_len > list->ids_capacity) {
+        size_t new_capacity = list->ids_capacity ? list->ids_capacity * 2 : INITIAL_IDS;
+        while (new_capacity < ids_len) {
+            new_capacity *= 2;
+        }
+        char *ids = realloc(list->ids, new_capacity);
+        if (ids == NULL) {
+            return -1;
+        }
+        list->ids = ids;
+        list->ids_capacity = new_capacity;
+    }
+    return 0;
+}
+
+int voter_table_copy_stripe(VoterTable *table, int index, VoterList *list) {
+    VoterStripe *stripe = &table->stripes[index];
+    while (1) {
+        pthread_mutex_lock(&stripe->lock);
+        size_t count = stripe->count;
+        size_t ids_len = stripe->ids_len - count * VOTER_ENTRY_HEADER;
+        if (list->count + count <= list->capacity && list->ids_len + ids_len <= list->ids_capacity) {
+            const char *id = voter_stripe_first_id(stripe);
+            for (size_t i = 0; i < count; i++) {
+                size_t len = strlen(id) + 1;
+                memcpy(list->ids + list->ids_len, id, len);
+                list->ids_len += len;
+                if (voter_stripe_voted(stripe, i)) {
+                    size_t bit = list->count + i;
+                    list->voted[bit / 64] |= 1ULL << (bit % 64);
+                }
+                id += len + VOTER_ENTRY_HEADER;
+            }
+            pthread_mutex_unlock(&stripe->lock);
+            list->count += count;
+            return 0;
+        }
+        pthread_mutex_unlock(&stripe->lock);
+
+        if (reserve_list(list, list->count + count, list->ids_len + ids_len) < 0) {
+            return -1;
+        }
+    }
+}
+
+void voter_list_free(VoterList *list) {
+    free(list->ids);
+    free(list->voted);
+    memset(list, 0, sizeof(*list));
+}
+
+void voter_table_lock_all(VoterTable *table) {
+    for (int i = 0; i < VOTER_TABLE_STRIPES; i++) {
+        pthread_mutex_lock(&table->stripes[i].lock);
+    }
+}
+
+void voter_table_unlock_all(VoterTable *table) {
+    for (int i = VOTER_TABLE_STRIPES - 1; i >= 0; i--) {
+        pthread_mutex_unlock(&table->stripes[i].lock);
+    }
+}
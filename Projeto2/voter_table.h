@@ -0,0 +1,135 @@
+#ifndef VOTER_TABLE_H
+#define VOTER_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include "protocol.h"
+
+// Número de stripes (potência de 2). Cada stripe é uma tabela de
+// endereçamento aberto independente, com seu próprio lock e crescimento.
+#define VOTER_TABLE_STRIPE_BITS 6
+#define VOTER_TABLE_STRIPES (1 << VOTER_TABLE_STRIPE_BITS)
+
+// Slot da tabela hash (8 bytes): os 32 bits baixos do hash (0 = vazio),
+// que também dão a posição, e onde está o votante em ids
+typedef struct {
+    uint32_t tag;
+    uint32_t offset;
+} VoterSlot;
+
+// Cada votante ocupa em ids o seu índice (u32) seguido do VOTER_ID com
+// '\0': a busca acha o índice na mesma linha de cache do VOTER_ID
+#define VOTER_ENTRY_HEADER sizeof(uint32_t)
+
+// Opções a partir deste índice ficam em wide_choices (o byte guarda só a marca)
+#define VOTER_WIDE_CHOICE UINT8_MAX
+
+// Votantes de um stripe em arrays paralelos (structure of arrays), na
+// ordem de cadastro: cerca de len(VOTER_ID) + 6 bytes por votante, contra
+// 72 de um struct com o VOTER_ID em tamanho fixo.
+typedef struct {
+    pthread_mutex_t lock;
+    VoterSlot *slots;
+    size_t capacity;        // potência de 2
+
+    char *ids;              // entradas [índice][VOTER_ID\0], uma após a outra
+    size_t ids_len;
+    size_t ids_capacity;
+    uint64_t *voted;        // bitmap: votante já votou
+    uint8_t *choices;       // índice da opção votada (válido se votou)
+    uint32_t *wide_choices; // opções >= VOTER_WIDE_CHOICE (NULL até a primeira)
+    size_t count;
+    size_t voters_capacity; // múltiplo de 64 (palavras inteiras do bitmap)
+} __attribute__((aligned(64))) VoterStripe;
+
+// Percorre os VOTER_IDs do stripe na ordem dos índices (lock já adquirido):
+// for (id = voter_stripe_first_id(s), i = 0; i < s->count; id = voter_stripe_next_id(id), i++)
+static inline const char *voter_stripe_first_id(const VoterStripe *stripe) {
+    return stripe->count > 0 ? stripe->ids + VOTER_ENTRY_HEADER : NULL;
+}
+
+static inline const char *voter_stripe_next_id(const char *id) {
+    return id + strlen(id) + 1 + VOTER_ENTRY_HEADER;
+}
+
+static inline bool voter_stripe_voted(const VoterStripe *stripe, size_t i) {
+    return (stripe->voted[i / 64] >> (i % 64)) & 1;
+}
+
+static inline uint32_t voter_stripe_choice(const VoterStripe *stripe, size_t i) {
+    return stripe->choices[i] == VOTER_WIDE_CHOICE ? stripe->wide_choices[i] : stripe->choices[i];
+}
+
+// Cópia compacta dos votantes de vários stripes (exportação): os VOTER_IDs
+// um após o outro, terminados em '\0', e o bitmap de quem votou
+typedef struct {
+    char *ids;
+    size_t ids_len;
+    size_t ids_capacity;
+    uint64_t *voted;
+    size_t count;
+    size_t capacity;        // múltiplo de 64
+} VoterList;
+
+typedef struct {
+    VoterStripe stripes[VOTER_TABLE_STRIPES];
+} VoterTable;
+
+typedef enum {
+    VOTER_MARKED,       // voto aceito e votante marcado
+    VOTER_DUPLICATE,    // votante já havia votado
+    VOTER_NO_MEMORY,
+    VOTER_UNCOMMITTED   // commit recusou: marcação desfeita
+} VoterMarkResult;
+
+// Chamado sob o lock do stripe logo depois da marcação (gravar o voto no
+// journal): quem trava todos os stripes nunca vê um voto marcado e ainda
+// não gravado. false desfaz a marcação.
+typedef bool (*VoterMarkCommit)(void *ctx);
+
+// Hash de um VOTER_ID (nunca 0). Calculado uma vez por sessão no HELLO.
+uint64_t voter_hash(const char *voter_id);
+
+// Shard dono do votante quando os stripes são repartidos entre num_shards
+// (até VOTER_TABLE_STRIPES) donos: cada stripe pertence a um único shard
+static inline int voter_table_shard(uint64_t hash, int num_shards) {
+    return (int)((hash >> (64 - VOTER_TABLE_STRIPE_BITS)) % (unsigned)num_shards);
+}
+
+void voter_table_init(VoterTable *table);
+void voter_table_destroy(VoterTable *table);
+
+// Cadastra o votante se ainda não existir. Retorna -1 sem memória,
+// 1 se foi criado e 0 se já existia.
+int voter_table_register(VoterTable *table, const char *voter_id, uint64_t hash);
+
+// Consulta se o votante já votou (false se não estiver cadastrado)
+bool voter_table_has_voted(VoterTable *table, const char *voter_id, uint64_t hash);
+
+// Verifica duplicidade e marca o voto atomicamente (sob o lock do stripe),
+// cadastrando o votante se necessário. commit pode ser NULL.
+VoterMarkResult voter_table_mark_voted(VoterTable *table, const char *voter_id, uint64_t hash,
+                                       uint32_t option_index, VoterMarkCommit commit, void *ctx);
+
+// Total de votantes cadastrados
+size_t voter_table_count(VoterTable *table);
+
+// Memória ocupada pelos votantes e pelos slots, em bytes
+size_t voter_table_memory(VoterTable *table);
+
+// Acrescenta os votantes do stripe index à lista. O lock fica preso só
+// durante a cópia; sem espaço, a lista cresce fora do lock e a cópia é
+// refeita. Retorna -1 sem memória.
+int voter_table_copy_stripe(VoterTable *table, int index, VoterList *list);
+
+void voter_list_free(VoterList *list);
+
+// Trava/destrava todos os stripes (retrato consistente da tabela inteira,
+// usado pelo checkpoint). Sempre na ordem dos stripes.
+void voter_table_lock_all(VoterTable *table);
+void voter_table_unlock_all(VoterTable *table);
+
+#endif
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "watch.h"
+#include "binary_protocol.h"
+
+int watch_init(WatchHub *hub, ResponseCache *responses, Tally *tally, atomic_bool *closed,
+               uint64_t interval_ns) {
+    memset(hub, 0, sizeof(*hub));
+    hub->counts = malloc(tally->num_options * sizeof(uint64_t));
+    if (hub->counts == NULL) {
+        return -1;
+    }
+    hub->responses = responses;
+    hub->tally = tally;
+    hub->closed = closed;
+    // Intervalo 0 faria a thread girar sem parar: no mínimo 1 ms
+    hub->interval_ns = interval_ns > 0 ? interval_ns : 1000000;
+    pthread_mutex_init(&hub->lock, NULL);
+
+    // Espera do intervalo no relógio monotônico
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&hub->wake, &attr);
+    pthread_condattr_destroy(&attr);
+    return 0;
+}
+
+void watch_release(WatchUpdate *update) {
+    if (update != NULL && atomic_fetch_sub_explicit(&update->refs, 1, memory_order_acq_rel) == 1) {
+        free(update);
+    }
+}
+
+WatchUpdate *watch_acquire(WatchHub *hub) {
+    pthread_mutex_lock(&hub->lock);
+    WatchUpdate *update = hub->current;
+    if (update != NULL) {
+        atomic_fetch_add_explicit(&update->refs, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&hub->lock);
+    return update;
+}
+
+// Serializa e publica o placar se ele mudou desde a última publicação
+// (chamado só pela thread de publicação)
+static void publish(WatchHub *hub, uint64_t *last_version, bool *last_final) {
+    if (atomic_load_explicit(&hub->watchers, memory_order_relaxed) == 0) {
+        return;
+    }
+    bool final = atomic_load(hub->closed);
+    uint64_t version = hub->source != NULL ? hub->source(hub->source_ctx, hub->counts)
+                                           : tally_version(hub->tally);
+    if (version == *last_version && final == *last_final) {
+        return;
+    }
+
+    size_t max_len = hub->responses->max_len;
+    WatchUpdate *update = malloc(sizeof(WatchUpdate) + 2 * max_len);
+    if (update == NULL) {
+        return;
+    }
+    update->text = update->data;
+    update->binary = (uint8_t *)update->data + max_len;
+    if (hub->source != NULL) {
+        *last_version = version;
+    } else {
+        tally_snapshot(hub->tally, hub->counts, last_version);
+    }
+    *last_final = final;
+    response_cache_format_score(hub->responses, hub->counts, final, BIN_FLAG_PUSH, update->text,
+                                &update->text_len, update->binary, &update->binary_len);
+    atomic_init(&update->refs, 1);      // referência do hub
+    update->final = final;
+    update->seq = watch_seq(hub) + 1;
+
+    uint64_t one = 1;
+    pthread_mutex_lock(&hub->lock);
+    WatchUpdate *old = hub->current;
+    hub->current = update;
+    atomic_store_explicit(&hub->published, update->seq, memory_order_release);
+    for (int i = 0; i < hub->num_notify; i++) {
+        if (write(hub->notify_fds[i], &one, sizeof(one)) < 0) {
+            // eventfd já sinalizado: o dono vai acordar de qualquer forma
+        }
+    }
+    pthread_mutex_unlock(&hub->lock);
+
+    watch_release(old);
+}
+
+static void *publisher_thread(void *arg) {
+    WatchHub *hub = (WatchHub *)arg;
+    // Quem assina já recebe o placar atual na resposta do WATCH: só
+    // mudanças a partir daqui são publicadas
+    uint64_t last_version = tally_version(hub->tally);
+    bool last_final = atomic_load(hub->closed);
+
+    pthread_mutex_lock(&hub->lock);
+    while (hub->running) {
+        if (!hub->kicked) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            uint64_t ns = deadline.tv_nsec + hub->interval_ns;
+            deadline.tv_sec += ns / 1000000000ULL;
+            deadline.tv_nsec = ns % 1000000000ULL;
+            pthread_cond_timedwait(&hub->wake, &hub->lock, &deadline);
+        }
+        hub->kicked = false;
+        if (!hub->running) {
+            break;
+        }
+        pthread_mutex_unlock(&hub->lock);
+        publish(hub, &last_version, &last_final);
+        pthread_mutex_lock(&hub->lock);
+    }
+    pthread_mutex_unlock(&hub->lock);
+    return NULL;
+}
+
+void watch_set_source(WatchHub *hub, WatchSourceFn source, void *ctx) {
+    hub->source = source;
+    hub->source_ctx = ctx;
+}
+
+int watch_start(WatchHub *hub) {
+    hub->running = true;
+    if (pthread_create(&hub->publisher, NULL, publisher_thread, hub) != 0) {
+        hub->running = false;
+        return -1;
+    }
+    return 0;
+}
+
+void watch_kick(WatchHub *hub) {
+    pthread_mutex_lock(&hub->lock);
+    hub->kicked = true;
+    pthread_cond_signal(&hub->wake);
+    pthread_mutex_unlock(&hub->lock);
+}
+
+int watch_add_notify(WatchHub *hub, int fd) {
+    pthread_mutex_lock(&hub->lock);
+    if (hub->num_notify == hub->notify_cap) {
+        int new_cap = hub->notify_cap ? hub->notify_cap * 2 : 64;
+        int *new_fds = realloc(hub->notify_fds, new_cap * sizeof(int));
+        if (new_fds == NULL) {
+            pthread_mutex_unlock(&hub->lock);
+            return -1;
+        }
+        hub->notify_fds = new_fds;
+        hub->notify_cap = new_cap;
+    }
+    hub->notify_fds[hub->num_notify++] = fd;
+    pthread_mutex_unlock(&hub->lock);
+    return 0;
+}
+
+void watch_remove_notify(WatchHub *hub, int fd) {
+    pthread_mutex_lock(&hub->lock);
+    for (int i = 0; i < hub->num_notify; i++) {
+        if (hub->notify_fds[i] == fd) {
+            hub->notify_fds[i] = hub->notify_fds[--hub->num_notify];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&hub->lock);
+}
+
+void watch_subscribe(WatchHub *hub) {
+    atomic_fetch_add_explicit(&hub->watchers, 1, memory_order_relaxed);
+}
+
+void watch_unsubscribe(WatchHub *hub) {
+    atomic_fetch_sub_explicit(&hub->watchers, 1, memory_order_relaxed);
+}
+
+void watch_shutdown(WatchHub *hub) {
+    pthread_mutex_lock(&hub->lock);
+    bool was_running = hub->running;
+    hub->running = false;
+    pthread_cond_signal(&hub->wake);
+    pthread_mutex_unlock(&hub->lock);
+
+    if (was_running) {
+        pthread_join(hub->publisher, NULL);
+    }
+    watch_release(hub->current);
+    hub->current = NULL;
+    free(hub->notify_fds);
+    hub->notify_fds = NULL;
+    hub->num_notify = 0;
+    free(hub->counts);
+    hub->counts = NULL;
+}
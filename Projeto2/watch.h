@@ -0,0 +1,98 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "protocol.h"
+#include "tally.h"
+#include "response_cache.h"
+
+// Assinaturas de placar (WATCH). Uma thread publica no máximo uma
+// atualização por intervalo, só quando os votos ou o estado final mudaram:
+// o placar é serializado uma vez e o mesmo buffer vai para todos os
+// assinantes. Quem envia é o dono de cada conexão (event loop ou thread),
+// avisado por um eventfd.
+
+// Atualização publicada. Imutável depois de publicada; liberada quando o
+// último leitor chama watch_release.
+typedef struct {
+    _Atomic unsigned refs;
+    uint64_t seq;               // cresce a cada publicação
+    bool final;
+    size_t text_len;
+    size_t binary_len;
+    char *text;                 // "SCORE ...\n" ou "CLOSED FINAL ...\n"
+    uint8_t *binary;            // BIN_SCORE_RESP com BIN_FLAG_PUSH
+    char data[];                // espaço de text e binary
+} WatchUpdate;
+
+// Fonte alternativa dos totais (modo cluster): preenche counts e retorna
+// uma versão que muda sempre que algum total muda
+typedef uint64_t (*WatchSourceFn)(void *ctx, uint64_t *counts);
+
+typedef struct {
+    ResponseCache *responses;
+    Tally *tally;
+    WatchSourceFn source;       // NULL: totais lidos de tally
+    void *source_ctx;
+    atomic_bool *closed;
+    uint64_t interval_ns;
+    uint64_t *counts;           // placar lido pela thread de publicação
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        // watch_kick publica antes do fim do intervalo
+    bool kicked;
+    bool running;
+    WatchUpdate *current;
+    int *notify_fds;            // eventfds avisados a cada publicação
+    int num_notify;
+    int notify_cap;
+
+    _Atomic size_t watchers;    // sem assinantes não há o que publicar
+    _Atomic uint64_t published;
+
+    pthread_t publisher;
+} WatchHub;
+
+// Retorna -1 sem memória
+int watch_init(WatchHub *hub, ResponseCache *responses, Tally *tally, atomic_bool *closed,
+               uint64_t interval_ns);
+
+// Troca a origem dos totais publicados (antes de watch_start)
+void watch_set_source(WatchHub *hub, WatchSourceFn source, void *ctx);
+
+// Inicia a thread de publicação
+int watch_start(WatchHub *hub);
+
+// Publica imediatamente se algo mudou (fim da eleição)
+void watch_kick(WatchHub *hub);
+
+// Registra/remove um eventfd avisado a cada publicação
+int watch_add_notify(WatchHub *hub, int fd);
+void watch_remove_notify(WatchHub *hub, int fd);
+
+// Conta um assinante a mais ou a menos
+void watch_subscribe(WatchHub *hub);
+void watch_unsubscribe(WatchHub *hub);
+
+// Última atualização publicada com uma referência (NULL se nenhuma ainda)
+WatchUpdate *watch_acquire(WatchHub *hub);
+void watch_release(WatchUpdate *update);
+
+// Bytes da atualização no protocolo da conexão
+static inline const char *watch_update_data(const WatchUpdate *update, bool binary, size_t *len) {
+    *len = binary ? update->binary_len : update->text_len;
+    return binary ? (const char *)update->binary : update->text;
+}
+
+// Número da última publicação (0 se nenhuma)
+static inline uint64_t watch_seq(WatchHub *hub) {
+    return atomic_load_explicit(&hub->published, memory_order_acquire);
+}
+
+void watch_shutdown(WatchHub *hub);
+
+#endif
@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include <string.h>
+#include "worker_pool.h"
+
+static void *worker_thread(void *arg) {
+    WorkerPool *pool = (WorkerPool *)arg;
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->count == 0) {
+            pthread_cond_wait(&pool->not_empty, &pool->lock);
+        }
+        void *item = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+        atomic_fetch_add_explicit(&pool->busy, 1, memory_order_relaxed);
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->handler(item);
+        atomic_fetch_sub_explicit(&pool->busy, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+int worker_pool_init(WorkerPool *pool, int num_workers, size_t queue_depth, WorkerFn handler) {
+    memset(pool, 0, sizeof(*pool));
+    pool->handler = handler;
+    pool->capacity = queue_depth > 0 ? queue_depth : 1;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->not_empty, NULL);
+
+    pool->queue = malloc(pool->capacity * sizeof(void *));
+    pool->threads = malloc(num_workers * sizeof(pthread_t));
+    if (pool->queue == NULL || pool->threads == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_thread, pool) != 0) {
+            return -1;
+        }
+        pthread_detach(pool->threads[i]);
+        pool->num_workers++;
+    }
+    return 0;
+}
+
+bool worker_pool_submit(WorkerPool *pool, void *item) {
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count == pool->capacity) {
+        pthread_mutex_unlock(&pool->lock);
+        atomic_fetch_add_explicit(&pool->rejected, 1, memory_order_relaxed);
+        return false;
+    }
+    pool->queue[(pool->head + pool->count) % pool->capacity] = item;
+    pool->count++;
+    if (pool->count > atomic_load_explicit(&pool->max_queued, memory_order_relaxed)) {
+        atomic_store_explicit(&pool->max_queued, pool->count, memory_order_relaxed);
+    }
+    pthread_cond_signal(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+
+    atomic_fetch_add_explicit(&pool->accepted, 1, memory_order_relaxed);
+    return true;
+}
+
+void worker_pool_stats(WorkerPool *pool, WorkerPoolStats *stats) {
+    pthread_mutex_lock(&pool->lock);
+    stats->queued = pool->count;
+    pthread_mutex_unlock(&pool->lock);
+
+    stats->num_workers = pool->num_workers;
+    stats->capacity = pool->capacity;
+    stats->busy = atomic_load_explicit(&pool->busy, memory_order_relaxed);
+    stats->max_queued = atomic_load_explicit(&pool->max_queued, memory_order_relaxed);
+    stats->accepted = atomic_load_explicit(&pool->accepted, memory_order_relaxed);
+    stats->rejected = atomic_load_explicit(&pool->rejected, memory_order_relaxed);
+}
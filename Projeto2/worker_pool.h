@@ -0,0 +1,54 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Função executada por um worker para cada item da fila
+typedef void *(*WorkerFn)(void *item);
+
+// Pool fixo de workers alimentado por uma fila limitada. Quem enfileira
+// nunca espera: com a fila cheia o item é recusado e a decisão do que
+// fazer com ele fica com quem chamou.
+typedef struct {
+    WorkerFn handler;
+    pthread_t *threads;
+    int num_workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    void **queue;               // buffer circular de capacity itens
+    size_t capacity;
+    size_t head;
+    size_t count;
+
+    // Métricas (lidas sem o lock)
+    _Atomic size_t max_queued;
+    _Atomic int busy;
+    _Atomic uint64_t accepted;
+    _Atomic uint64_t rejected;
+} WorkerPool;
+
+typedef struct {
+    int num_workers;
+    int busy;                   // workers atendendo um item
+    size_t capacity;
+    size_t queued;              // itens esperando um worker
+    size_t max_queued;          // maior fila observada
+    uint64_t accepted;
+    uint64_t rejected;          // recusados com a fila cheia
+} WorkerPoolStats;
+
+// Cria num_workers threads que chamam handler para cada item enfileirado
+int worker_pool_init(WorkerPool *pool, int num_workers, size_t queue_depth, WorkerFn handler);
+
+// Enfileira o item sem bloquear. Retorna false (e conta a recusa) se a
+// fila estiver cheia.
+bool worker_pool_submit(WorkerPool *pool, void *item);
+
+void worker_pool_stats(WorkerPool *pool, WorkerPoolStats *stats);
+
+#endif